@@ -5,9 +5,13 @@
 
 #include "commandlineparser.h"
 #include "logger.h"
+#include <cstdint>
 #include <getopt.h>
 #include <stdexcept>
 
+// Largest virtual epoch in seconds whose nanoseconds fit in the system clock
+#define VIRTUAL_EPOCH_MAX (INT64_MAX / 1000000000LL)
+
 parameters params;
 
 /*!
@@ -22,6 +26,8 @@ bool parseCommandLineArguments(int argc, char *argv[])
     static struct option long_options[] =
     {
         {"asc",               required_argument, 0, 'a'},
+        {"bus",               required_argument, 0, 'B'},
+        {"bus-load",          required_argument, 0, 'b'},
         {"cfg",               required_argument, 0, 'c'},
         {"dbc",               required_argument, 0, 'd'},
         {"filterExclude",     required_argument, 0, 'f'},
@@ -29,21 +35,30 @@ bool parseCommandLineArguments(int argc, char *argv[])
         {"help",              no_argument,       0, 'h'},
         {"ignoreDirections",  no_argument,       0, 'I'},
         {"interface",         required_argument, 0, 'i'},
+        {"kernel-filter",     no_argument,       0, 'k'},
+        {"lock-memory",       no_argument,       0, 'L'},
         {"metrics",           required_argument, 0, 'm'},
         {"metricsSeparator",  required_argument, 0, 'M'},
         {"native",            no_argument,       0, 'n'},
+        {"reader-thread",     required_argument, 0, 'E'},
+        {"route",             required_argument, 0, 'R'},
         {"run-time",          required_argument, 0, 'r'},
+        {"sender-thread",     required_argument, 0, 'S'},
         {"suppress-defaults", no_argument,       0, 's'},
         {"no-send-time",      no_argument,       0, 't'},
         {"utc",               no_argument,       0, 'u'},
         {"verbosity",         required_argument, 0, 'v'},
+        {"virtual-time",      optional_argument, 0, 'V'},
         {0, 0, 0, 0}
     };
 
     // Initialize defaults
+    params.busLoad = 0;
     params.filterExclude = false;
     params.ignoreDirections = false;
     params.interface = "can0";
+    params.kernelFilter = false;
+    params.lockMemory = false;
     params.metrics = "";
     params.metricsSeparator = 0;
     params.native = false;
@@ -52,12 +67,14 @@ bool parseCommandLineArguments(int argc, char *argv[])
     params.sendTime = true;
     params.utcTime = false;
     params.verbosity = LOG_INFO;
+    params.virtualTime = false;
+    params.virtualEpoch = 0;
 
     while (1) {
         // Current option index.
         int option_index = 0;
 
-        int c = getopt_long(argc, argv, "a:c:d:f:F:m:M:Ii:hmnr:stuv:",
+        int c = getopt_long(argc, argv, "a:B:b:c:d:E:f:F:m:M:Ii:hkLmnR:r:S:stuv:V::",
                         long_options, &option_index);
         // Detect the end of the options.
         if (c == -1) {
@@ -68,12 +85,33 @@ bool parseCommandLineArguments(int argc, char *argv[])
             case 'a':
                 params.asc = optarg;
                 break;
+            case 'B':
+                params.buses.push_back(optarg);
+                break;
+            case 'b':
+                try {
+                    params.busLoad = std::stoi(optarg, 0);
+                }
+                catch (const std::invalid_argument &) {
+                    params.busLoad = -1;
+                }
+                catch (const std::out_of_range &) {
+                    params.busLoad = -1;
+                }
+                if (params.busLoad < 0 || params.busLoad > 100) {
+                    LOG(LOG_ERR, "error=1 Invalid value for busLoad.\n");
+                    return false;
+                }
+                break;
             case 'c':
                 params.cfg = optarg;
                 break;
             case 'd':
                 params.dbc = optarg;
                 break;
+            case 'E':
+                params.readerThread = optarg;
+                break;
             case 'f':
                 params.filterExclude = true;
                 params.filters = optarg;
@@ -91,6 +129,12 @@ bool parseCommandLineArguments(int argc, char *argv[])
             case 'I':
                 params.ignoreDirections = true;
                 break;
+            case 'k':
+                params.kernelFilter = true;
+                break;
+            case 'L':
+                params.lockMemory = true;
+                break;
             case 'm':
                 params.metrics = optarg;
                 break;
@@ -100,6 +144,9 @@ bool parseCommandLineArguments(int argc, char *argv[])
             case 'n':
                 params.native = true;
                 break;
+            case 'R':
+                params.routes.push_back(optarg);
+                break;
             case 'r':
                 try {
                     params.runTime = std::stoi(optarg, 0);
@@ -109,6 +156,9 @@ bool parseCommandLineArguments(int argc, char *argv[])
                     return false;
                 }
                 break;
+            case 'S':
+                params.senderThread = optarg;
+                break;
             case 's':
                 params.suppressDefaults = true;
                 break;
@@ -127,6 +177,25 @@ bool parseCommandLineArguments(int argc, char *argv[])
                     return false;
                 }
                 break;
+            case 'V':
+                params.virtualTime = true;
+                if (optarg) {
+                    try {
+                        params.virtualEpoch = std::stoll(optarg, 0);
+                    }
+                    catch (const std::invalid_argument &) {
+                        params.virtualEpoch = -1;
+                    }
+                    catch (const std::out_of_range &) {
+                        params.virtualEpoch = -1;
+                    }
+                    // Virtual calendar time is kept in nanoseconds
+                    if (params.virtualEpoch < 0 || params.virtualEpoch > VIRTUAL_EPOCH_MAX) {
+                        LOG(LOG_ERR, "error=1 Invalid value for virtual-time.\n");
+                        return false;
+                    }
+                }
+                break;
             default:
                 return false;
         }
@@ -11,19 +11,28 @@
 
 struct parameters {
     std::string asc;
+    std::vector<std::string> buses;
+    int busLoad;
     std::string cfg;
     std::string dbc;
     std::string interface;
+    bool kernelFilter;
+    bool lockMemory;
     std::string metrics;
     char metricsSeparator;
     bool native;
+    std::vector<std::string> routes;
+    std::string readerThread;
     int runTime;
+    std::string senderThread;
     bool suppressDefaults;
     bool ignoreDirections;
     bool sendTime;
     bool utcTime;
     bool filterExclude;
     int verbosity;
+    bool virtualTime;
+    long long virtualEpoch;
     std::string command;
     std::string filters;
     std::vector<std::string> commandParameters;
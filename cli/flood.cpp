@@ -4,14 +4,12 @@
 */
 
 #include "flood.h"
+#include "canfd.h"
 #include "stringtools.h"
 #include <algorithm>
 #include <stdlib.h>
 #include <unistd.h>
 
-// Previously calculated CAN frame size standard
-#define FRAME_SIZE 33
-
 const char *CANSimulatorFloodException::what() const throw()
 {
     return "CANSimulatorFloodException";
@@ -50,12 +48,14 @@ CANSimulatorFloodMode::CANSimulatorFloodMode(CANSimulatorCore *canSimulator, std
     m_burstEnabled(false),
     m_burstLen(0),
     m_burstWaitTime(0),
-    m_metrics(NULL)
+    m_metrics(NULL),
+    m_queued(0)
 {
     if (!canSimulator) {
         throw CANSimulatorFloodException();
     }
     m_bitrate = m_canSimulator->getCANBitrate();
+    m_dataBitrate = m_canSimulator->getCANDataBitrate();
     initTimer();
 
     // Read commandline inputs
@@ -109,6 +109,7 @@ void CANSimulatorFloodMode::checkBurstSleep()
         }
         m_burstWaitTime += m_burstDelay;        // Set time to sleep
         m_waitTime += m_burstDelay;             // Set flood timer up to date
+        flushMessages();
         nanoSleep(m_burstWaitTime - difference);
         m_burstWaitTime += m_burstLen;          // Set new bursting time
     }
@@ -179,7 +180,10 @@ bool CANSimulatorFloodMode::floodSignal()
 
     // Force send messages even if the randomly chosen signal value
     // happens to be the same as it previously was
-    bool sent = m_canSimulator->sendCANMessage(var, true);
+    bool sent = m_canSimulator->queueCANMessage(var, true);
+    if (sent) {
+        ++m_queued;
+    }
     if (m_metrics) {
         m_metrics->updateBurstData(false);
     }
@@ -187,10 +191,28 @@ bool CANSimulatorFloodMode::floodSignal()
     // Use congestion rate to calculate the delay between message sending
     // or use basic delay between messages
     m_waitTime += (getUseRate()) ? calculateDelay(var) : m_useInterval;
+    // Messages which are already late are sent together when there is time to wait
+    auto elapsed = std::chrono::high_resolution_clock::now() - m_start;
+    if (m_queued >= CAN_SEND_BATCH_SIZE ||
+        (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() < m_waitTime) {
+        sent = flushMessages() && sent;
+    }
     waitUntil(m_start, m_waitTime);
     return sent;
 }
 
+/*!
+ * \brief CANSimulatorFloodMode::flushMessages
+ * Send queued flood messages in a single batch
+ * \return true if all queued messages were sent, false otherwise
+ */
+bool CANSimulatorFloodMode::flushMessages()
+{
+    std::size_t queued = m_queued;
+    m_queued = 0;
+    return m_canSimulator->flushCANMessages() == queued;
+}
+
 /*!
  * \brief CANSimulatorFloodMode::setRate
  * Set congestion rate value and enable rate calculation
@@ -319,10 +341,10 @@ int CANSimulatorFloodMode::calculateDelay(const std::string &key)
 {
     if (m_bitrate > 0) {
         if (const CANMessage *message = m_canSimulator->getMessage(key)) {
-            int messageBits = FRAME_SIZE +                                               // Previously calculated CAN frame size
-                (message->getDlc() * 8) +                                                // CAN message size
-                ((message->getId() & CAN_EFF_FLAG) ? CAN_EFF_ID_BITS : CAN_SFF_ID_BITS); // Check if standard or extended CAN ID
-            m_useInterval = (messageBits * m_rateFactor);
+            // CAN (FD) frame size as bits of nominal bitrate
+            canFrameBits bits = canFrameBitCount(message->getId() & CAN_EFF_FLAG, message->getDlc(),
+                                                 message->isCANFD(), message->getBitRateSwitch());
+            m_useInterval = (canFrameNominalBits(bits, m_bitrate, m_dataBitrate) * m_rateFactor);
             return m_useInterval;
         }
     }
@@ -406,10 +428,12 @@ float CANSimulatorFloodMode::getWaitTime() const
  * \brief CANSimulatorFloodMode::forceBitrate
  * Force CAN bitrate to a new bitrate, used for testing only
  * \param bitrate: new bitrate
+ * \param dataBitrate: new CAN FD data bitrate
  */
-void CANSimulatorFloodMode::forceBitrate(int bitrate)
+void CANSimulatorFloodMode::forceBitrate(int bitrate, int dataBitrate)
 {
     m_bitrate = bitrate;
+    m_dataBitrate = dataBitrate;
 }
 
 /*!
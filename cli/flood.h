@@ -42,6 +42,7 @@ public:
     int getUseInterval() const;
     // flood setup
     bool floodSignal();
+    bool flushMessages();
     bool processFloodParams(std::vector<std::string> *input);
     float getRateFactor() const;
     float getWaitTime() const;
@@ -57,11 +58,12 @@ public:
     // Metrics setup
     void initMetrics(MetricsCollector *metrics);
     // For testing only
-    void forceBitrate(int bitrate);
+    void forceBitrate(int bitrate, int dataBitrate = 0);
     bool getMessageExists(std::string name) const;
 
 private:
     int m_bitrate;
+    int m_dataBitrate;
     CANSimulatorCore *m_canSimulator;
     int m_delay;
     int m_rate;
@@ -82,6 +84,9 @@ private:
     // Message metrics
     MetricsCollector *m_metrics;
 
+    // Number of messages waiting in the send batch
+    std::size_t m_queued;
+
     // Message limiters
     std::set<std::string> m_variables;
     bool checkIncludedMessages(std::vector<std::string> includeList, std::set<std::string> source);
@@ -8,16 +8,23 @@
 #include "flood.h"
 #include "logger.h"
 #include "metrics.h"
+#include "reactor.h"
 #include "stringtools.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
 #include <inttypes.h>
 #include <signal.h>
 #include <stdexcept>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
-#include <sys/select.h>
+#include <sys/epoll.h>
 #include <unistd.h>
 #include <vector>
+#ifdef GENERATED_CODECS
+#include "framecodecs.h"
+#endif
 
 // Global CANSimulatorCore
 CANSimulatorCore *canSimulator;
@@ -28,6 +35,9 @@ MetricsCollector *metrics = NULL;
 // Main loop status
 bool running = true;
 
+// Event loop of the main loop
+Reactor *mainReactor = NULL;
+
 /*!
  * \brief printHelp
  * Print program help
@@ -39,19 +49,31 @@ void printHelp() {
   -c, --cfg=FILE                cfg file\n\
   -d, --dbc=FILE                dbc file\n\
 [options]\n\
+  -B, --bus=NAME,IF,CFG,DBC     Add bus NAME on CAN interface IF, its variables are referred to as NAME.VAR\n\
+  -b, --bus-load=NUM            Hold bus load of sent frames below NUM percent of the CAN bitrate\n\
+  -E, --reader-thread=CPU[,POL[,PRIO]]\n\
+                                Pin the reader thread to CPU (empty for any) with scheduling policy POL\n\
+                                (other, fifo or rr) and real-time priority PRIO\n\
   -f, --filterExclude=ID,ID     List of all message ID's that will be excluded from sending, each separated by ,\n\
   -F, --filterInclude=ID,ID     List of all message ID's that will only be included in sending, each separated by ,\n\
   -I, --ignoreDirections        Ignore message directions defined in configuration\n\
   -i, --interface               CAN interface name (default: can0)\n\
+  -k, --kernel-filter           Let the kernel drop frames of messages not received or filtered out\n\
+  -L, --lock-memory             Lock process memory and prefault thread stacks to avoid page faults\n\
   -m, --metrics=FILE            Metrics output file (without file extension)\n\
   -M, --metricsSeparator=CHAR   Metrics output file value separator character (default ;)\n\
   -n, --native                  Use native units instead of SI units\n\
+  -R, --route=VAR,VAR           Set received values of the first variable to the second, typically of another bus\n\
   -r, --run-time=NUM            Run only for NUM seconds, use with automatic simulation\n\
+  -S, --sender-thread=CPU[,POL[,PRIO]]\n\
+                                Pin the sender thread, which also runs simulations, like --reader-thread\n\
   -s, --suppress-defaults       Suppress reporting incoming initial default values\n\
   -t, --no-send-time            Do not send time automatically\n\
   -u, --utc                     Use UTC time for automatic time sending\n\
   -v, --verbosity=NUM           Output verbosity (0: silent, 1: output, 2: errors, 3: warnings,\n\
                                                   4: additional info, 5: debug) (default: 4)\n\
+  -V, --virtual-time[=SEC]      Run on virtual time as fast as possible without sleeping, calendar time\n\
+                                starts from SEC seconds since the Unix epoch (default: 0)\n\
 <command>\n\
   flood                         Send random messages at given intervals\n\
     [parameters]\n\
@@ -84,6 +106,9 @@ void sigHandler(int signo)
 {
     (void)signo;
     running = false;
+    if (mainReactor) {
+        mainReactor->stop();
+    }
 }
 
 /*!
@@ -106,19 +131,22 @@ void printSignalInfo(const std::string &name, bool details)
 
 /*!
  * \brief printMessageSignalInfo
- * Print signal information for all signals in a message
- * \param message: Pointer to message
+ * Print signal information for all changed signals in a received message
+ * \param snapshot: Pointer to received message snapshot
  */
-void printMessageSignalInfo(CANMessage *message)
+void printMessageSignalInfo(const MessageSnapshot *snapshot)
 {
-    if (message) {
-        std::map<std::string, CANSignal> signals = message->getSignals();
-        for (auto it = signals.begin(); it != signals.end(); ++it) {
-            if (it->second.isModified()) {
+    if (snapshot && snapshot->getMessage()) {
+        // Signal names and conversions do not change, values come from the snapshot
+        const std::map<std::string, CANSignal> &signals = snapshot->getMessage()->getSignals();
+        std::size_t index = 0;
+        for (auto it = signals.begin(); it != signals.end(); ++it, ++index) {
+            if (snapshot->isChanged(index)) {
+                Value value = snapshot->getValue(it->second);
                 if (!it->second.getVariableName().empty()) {
-                    LOG(LOG_OUT, it->second.getVariableName() + "=" + it->second.getValue().toString() + "\n");
+                    LOG(LOG_OUT, it->second.getVariableName() + "=" + value.toString() + "\n");
                 }
-                LOG(LOG_INFO, it->second.toString(false));
+                LOG(LOG_INFO, it->second.toString(value, false));
             }
         }
     }
@@ -148,23 +176,6 @@ void printSignalInfo(std::vector<std::string> &input, bool printVersions)
     }
 }
 
-/*!
- * \brief waitInput
- * Wait for input from sockets
- * \param input_set: fd_set of monitored file descriptors
- * \param nfds: number of file descriptors to monitor
- * \return True if input is available, false otherwise.
- */
-bool waitInput(fd_set &input_set, int nfds)
-{
-    // Wait 100 milliseconds for input
-    struct timeval timeout;
-    timeout.tv_sec = 0;
-    timeout.tv_usec = 100000;
-
-    return select(nfds, &input_set, NULL, NULL, &timeout) > 0;
-}
-
 /*!
  * \brief processUserInput
  * Process user input from vector of strings
@@ -192,6 +203,52 @@ void processUserInput(std::vector<std::string> &input)
     }
 }
 
+/*!
+ * \brief processInputLines
+ * Process complete lines of user input
+ * \param buffer: Read input, the last incomplete line is left in the buffer
+ */
+static void processInputLines(std::string &buffer)
+{
+    std::size_t start = 0, end;
+    while (running && (end = buffer.find('\n', start)) != std::string::npos) {
+        std::vector<std::string> userInput = split(buffer.substr(start, end - start), ' ');
+        start = end + 1;
+        processUserInput(userInput);
+    }
+    buffer.erase(0, start);
+}
+
+/*!
+ * \brief readUserInput
+ * Read stdin until no more input is available and process the complete lines
+ * \param buffer: Incomplete line of the previous read, updated with the remaining input
+ * \return False at the end of input or on error, true otherwise.
+ */
+static bool readUserInput(std::string &buffer)
+{
+    char data[1024];
+    while (running) {
+        ssize_t count = read(STDIN_FILENO, data, sizeof(data));
+        if (count > 0) {
+            buffer.append(data, count);
+            processInputLines(buffer);
+        } else if (count < 0 && errno == EINTR) {
+            continue;
+        } else if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;
+        } else {
+            // Last line may not end with a newline
+            if (!buffer.empty()) {
+                buffer += '\n';
+                processInputLines(buffer);
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
 /*!
  * \brief mainLoop
  * Main loop for monitor, prompt and simulator modes
@@ -200,43 +257,59 @@ void processUserInput(std::vector<std::string> &input)
  */
 int mainLoop(bool send)
 {
-    fd_set input_set;
+    Reactor reactor;
     int messageQueueFd = canSimulator->getMessageQueue()->getEventFd();
-    while (running) {
-        int nfds = 0;
-        // Empty the FD set
-        FD_ZERO(&input_set);
-        if (send) {
-            // Listen to stdin
-            FD_SET(STDIN_FILENO, &input_set);
-            nfds = STDIN_FILENO + 1;
+    // Listen to incoming messages
+    reactor.add(messageQueueFd, EPOLLIN, [messageQueueFd](std::uint32_t) {
+        //Print changed signals
+        uint64_t val;
+        if (read(messageQueueFd, &val, sizeof(uint64_t)) < 0) {
+            val = 0;
+        }
+        Queue<MessageSnapshot *> *messageQueue = canSimulator->getMessageQueue();
+        while (!messageQueue->empty()) {
+            MessageSnapshot *snapshot = messageQueue->pop();
+            printMessageSignalInfo(snapshot);
+            canSimulator->releaseSnapshot(snapshot);
         }
-        if (messageQueueFd >= 0) {
-            // Listen to incoming messages
-            FD_SET(messageQueueFd, &input_set);
-            nfds = ((messageQueueFd+1) > nfds) ? messageQueueFd+1 : nfds;
+    });
+    mainReactor = &reactor;
+    std::string input;
+    int stdinFlags = -1;
+    if (send) {
+        // Events are edge triggered, stdin is read without blocking until no input is left
+        stdinFlags = fcntl(STDIN_FILENO, F_GETFL);
+        if (stdinFlags >= 0 && fcntl(STDIN_FILENO, F_SETFL, stdinFlags | O_NONBLOCK) < 0) {
+            stdinFlags = -1;
         }
-        // Wait for input
-        if (waitInput(input_set, nfds) && running) {
-            // Check for data from stdin
-            if (FD_ISSET(STDIN_FILENO, &input_set)) {
-                std::string line;
-                std::getline(std::cin, line);
+        bool added = stdinFlags >= 0 && reactor.add(STDIN_FILENO, EPOLLIN, [&reactor, &input](std::uint32_t) {
+            if (!readUserInput(input)) {
+                reactor.remove(STDIN_FILENO);
+            }
+        });
+        if (!added) {
+            // Regular files and /dev/null cannot be polled, reading them does not block
+            LOG(LOG_WARN, "warning=2 Cannot poll stdin (%s), reading user input with blocking reads\n",
+                strerror(errno));
+            if (stdinFlags >= 0) {
+                fcntl(STDIN_FILENO, F_SETFL, stdinFlags);
+                stdinFlags = -1;
+            }
+            std::string line;
+            while (running && std::getline(std::cin, line)) {
                 std::vector<std::string> userInput = split(line, ' ');
                 processUserInput(userInput);
-            }
-            if (FD_ISSET(messageQueueFd, &input_set)) {
-                //Print changed signals
-                uint64_t val ;
-                read(messageQueueFd, &val, sizeof(uint64_t));
-                Queue<std::shared_ptr<CANMessage>> *messageQueue = canSimulator->getMessageQueue();
-                while (!messageQueue->empty()) {
-                    std::shared_ptr<CANMessage> message = messageQueue->pop();
-                    printMessageSignalInfo(message.get());
-                }
+                reactor.dispatch(0);
             }
         }
     }
+    while (running && reactor.dispatch() >= 0) {
+    }
+    mainReactor = NULL;
+    if (stdinFlags >= 0) {
+        // The file status flags are shared with other processes using the terminal
+        fcntl(STDIN_FILENO, F_SETFL, stdinFlags);
+    }
     return 0;
 }
 
@@ -260,6 +333,7 @@ int flooderLoop(std::vector<std::string> &input)
     while(running) {
         sent += (canFlooder->floodSignal()) ? 1 : 0;
     }
+    canFlooder->flushMessages();
     LOG(LOG_OUT, "Sent %" PRIu64 " messages\n", sent);
     delete canFlooder;
     return 0;
@@ -321,6 +395,14 @@ int main(int argc, char *argv[])
     catch (CANSimulatorCoreException&) {
         return 2;
     }
+    // Virtual time must be set before metrics collection starts
+    VirtualClock virtualClock(params.virtualEpoch * 1000000000ULL);
+    if (params.virtualTime) {
+        canSimulator->setClock(&virtualClock);
+    }
+#ifdef GENERATED_CODECS
+    canSimulator->loadCodecs(generatedFrameCodecs, GENERATED_FRAME_CODEC_COUNT);
+#endif
 
     initializeMetrics();
 
@@ -346,6 +428,54 @@ int main(int argc, char *argv[])
         }
     }
 
+    for (auto it = params.buses.begin(); it != params.buses.end(); ++it) {
+        std::vector<std::string> bus = split(*it, ',');
+        if (bus.size() != 4 || !canSimulator->addBus(bus[0], bus[2], bus[3], params.command.compare("list") ? bus[1] : "",
+                                                     params.suppressDefaults, params.ignoreDirections)) {
+            LOG(LOG_ERR, "error=1 Unable to add bus '%s'! Aborting!\n", (*it).c_str());
+            delete canSimulator;
+            return 1;
+        }
+    }
+    for (auto it = params.routes.begin(); it != params.routes.end(); ++it) {
+        std::vector<std::string> route = split(*it, ',');
+        if (route.size() != 2 || !canSimulator->addSignalRoute(route[0], route[1])) {
+            LOG(LOG_ERR, "error=1 Unable to route '%s'! Aborting!\n", (*it).c_str());
+            delete canSimulator;
+            return 1;
+        }
+    }
+
+    if (params.kernelFilter && !params.interface.empty()) {
+        // Dropped frames are only needed for unknown message metrics
+        if (!canSimulator->setKernelFilters(metrics != NULL)) {
+            LOG(LOG_WARN, "warning=2 Unable to set kernel filters\n");
+        }
+    }
+
+    threadConfig config;
+    if (!params.readerThread.empty() &&
+        (!parseThreadConfig(params.readerThread, config) || !canSimulator->setReaderThreadConfig(config))) {
+        LOG(LOG_ERR, "error=1 Invalid reader thread '%s'! Aborting!\n", params.readerThread.c_str());
+        delete canSimulator;
+        return 1;
+    }
+    if (!params.senderThread.empty() &&
+        (!parseThreadConfig(params.senderThread, config) || !canSimulator->setSenderThreadConfig(config))) {
+        LOG(LOG_ERR, "error=1 Invalid sender thread '%s'! Aborting!\n", params.senderThread.c_str());
+        delete canSimulator;
+        return 1;
+    }
+    if (params.lockMemory && !canSimulator->lockMemory()) {
+        LOG(LOG_WARN, "warning=2 Unable to lock memory, continuing without\n");
+    }
+
+    if (params.busLoad && !canSimulator->setBusLoadLimit(params.busLoad)) {
+        LOG(LOG_ERR, "error=1 Unable to limit bus load to %d%%! Aborting!\n", params.busLoad);
+        delete canSimulator;
+        return 1;
+    }
+
     int retval = 0;
     // Handle commands
     if (!params.command.compare("flood")) {
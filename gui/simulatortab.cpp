@@ -261,26 +261,31 @@ void SimulatorTab::readTableFromCAN()
 /*!
  * \brief SimulatorTab::modifyTableFromMessage
  * Modify table according to received message
- * \param message: Received CAN message
+ * \param snapshot: Received CAN message snapshot
  */
-void SimulatorTab::modifyTableFromMessage(std::shared_ptr<CANMessage> msg)
+void SimulatorTab::modifyTableFromMessage(const MessageSnapshot *snapshot)
 {
+    const CANMessage *msg = snapshot->getMessage();
     const std::map<std::string, CANSignal> &sigs = msg->getSignals();
     QVector<TableItem> &items = m_tableModel->getItems();
 
-    for (auto it = items.begin(); it != items.end(); ++it) {
-        const auto sig_it = sigs.find(it->getSignal()->getName());
-
-        if (sig_it != sigs.end()) {
-            TableItem &item = *it;
-            const std::string &sigName = sig_it->first;
-            const CANSignal &sig = sig_it->second;
-            const Value &v = sig.getValue();
+    // Only changed signals are decoded, others may belong to an inactive multiplexer page
+    std::size_t index = 0;
+    for (auto sig_it = sigs.begin(); sig_it != sigs.end(); ++sig_it, ++index) {
+        if (!snapshot->isChanged(index)) {
+            continue;
+        }
+        const std::string &sigName = sig_it->first;
+        const Value v = snapshot->getValue(sig_it->second);
 
-            bool wasChanged = m_tableModel->setDataFromCAN(item, v);
-            if (wasChanged) {
-                m_tableModel->hilightItem(item);
-                logChange(msg->getName(), sigName, v);
+        for (auto it = items.begin(); it != items.end(); ++it) {
+            if (it->getSignal()->getName() == sigName) {
+                TableItem &item = *it;
+                bool wasChanged = m_tableModel->setDataFromCAN(item, v);
+                if (wasChanged) {
+                    m_tableModel->hilightItem(item);
+                    logChange(msg->getName(), sigName, v);
+                }
             }
         }
     }
@@ -293,9 +298,11 @@ void SimulatorTab::modifyTableFromMessage(std::shared_ptr<CANMessage> msg)
 void SimulatorTab::pollCAN()
 {
     if (m_canSimulatorCore != nullptr) {
-        Queue<std::shared_ptr<CANMessage>> *messageQueue = m_canSimulatorCore->getMessageQueue();
+        Queue<MessageSnapshot *> *messageQueue = m_canSimulatorCore->getMessageQueue();
         while (!messageQueue->empty()) {
-            modifyTableFromMessage(messageQueue->pop());
+            MessageSnapshot *snapshot = messageQueue->pop();
+            modifyTableFromMessage(snapshot);
+            m_canSimulatorCore->releaseSnapshot(snapshot);
         }
     }
 }
@@ -56,7 +56,7 @@ signals:
     void logIncomingData(const LoggerTableModel::Event &event);
 
 private:
-    void modifyTableFromMessage(std::shared_ptr<CANMessage> msg);
+    void modifyTableFromMessage(const MessageSnapshot *snapshot);
     void pollCAN();
     void logChange(const std::string &msgName,
                    const std::string &sigName,
@@ -0,0 +1,188 @@
+/*!
+* \file
+* \brief admissioncontroller.cpp foo
+*/
+
+#include "admissioncontroller.h"
+#include "logger.h"
+#include <algorithm>
+
+/*!
+ * \brief arbitrationPriority
+ * Convert CAN ID to its arbitration order on the bus, smaller wins.
+ * Extended frames are ordered by their base ID first and lose to standard frames of the same base ID.
+ * \param canId: CAN ID, with CAN_EFF_FLAG for extended frames
+ * \return Arbitration order
+ */
+static std::uint32_t arbitrationPriority(std::uint32_t canId)
+{
+    if (canId & CAN_EFF_FLAG) {
+        return (((canId >> 18) & CAN_SFF_MASK) << 19) | (1 << 18) | (canId & 0x3ffff);
+    }
+    return (canId & CAN_SFF_MASK) << 19;
+}
+
+/*!
+ * \brief AdmissionController::AdmissionController
+ * Constructor, admission control is disabled until configured
+ */
+AdmissionController::AdmissionController() :
+    m_targetLoad(0),
+    m_bitrate(0),
+    m_dataBitrate(0),
+    m_bitsPerNanosecond(0),
+    m_capacity(0),
+    m_tokens(0),
+    m_lastRefill(0),
+    m_reserved(false),
+    m_reservedId(0),
+    m_reservedBits(0),
+    m_reservedUntil(0)
+{
+}
+
+/*!
+ * \brief AdmissionController::configure
+ * Set target bus utilisation
+ * \param targetLoad: Target bus load in percent of the bitrate (1-100), 0 to disable
+ * \param bitrate: Nominal bitrate of the bus
+ * \param dataBitrate: CAN FD data bitrate, or 0 if not known
+ * \return True if successful, false otherwise.
+ */
+bool AdmissionController::configure(int targetLoad, int bitrate, int dataBitrate)
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (targetLoad < 0 || targetLoad > 100) {
+        LOG(LOG_WARN, "warning=4 Invalid target bus load: %d\n", targetLoad);
+        return false;
+    }
+    if (targetLoad && bitrate <= 0) {
+        LOG(LOG_WARN, "warning=2 Bus load cannot be limited without known bitrate\n");
+        return false;
+    }
+    m_targetLoad = targetLoad;
+    m_bitrate = bitrate;
+    m_dataBitrate = dataBitrate;
+    m_bitsPerNanosecond = (bitrate * (targetLoad / 100.0)) / 1000000000.0;
+    m_capacity = std::max<double>(bitrate * (targetLoad / 100.0) * (ADMISSION_BURST_TIME / 1000000000.0),
+                                  ADMISSION_MIN_BURST_BITS);
+    m_tokens = m_capacity;
+    m_lastRefill = 0;
+    m_reserved = false;
+    return true;
+}
+
+/*!
+ * \brief AdmissionController::isEnabled
+ * Check whether bus load is limited
+ * \return True if enabled, false otherwise.
+ */
+bool AdmissionController::isEnabled() const
+{
+    return m_targetLoad > 0;
+}
+
+/*!
+ * \brief AdmissionController::getTargetLoad
+ * Get target bus utilisation
+ * \return Target bus load in percent, 0 if disabled
+ */
+int AdmissionController::getTargetLoad() const
+{
+    return m_targetLoad;
+}
+
+/*!
+ * \brief AdmissionController::refill
+ * Add bit-time elapsed since previous refill to the budget
+ * \param now: Current time in nanoseconds
+ */
+void AdmissionController::refill(std::uint64_t now)
+{
+    if (m_lastRefill && now > m_lastRefill) {
+        m_tokens = std::min(m_capacity, m_tokens + (now - m_lastRefill) * m_bitsPerNanosecond);
+    }
+    if (now > m_lastRefill) {
+        m_lastRefill = now;
+    }
+}
+
+/*!
+ * \brief AdmissionController::admit
+ * Check whether frame may be sent and consume its bit-time from the budget
+ * \param canId: CAN ID of the frame
+ * \param bits: Number of bits of the frame
+ * \param now: Current time in nanoseconds
+ * \return True if frame may be sent, false otherwise.
+ */
+bool AdmissionController::admit(std::uint32_t canId, const canFrameBits &bits, std::uint64_t now)
+{
+    if (!isEnabled()) {
+        return true;
+    }
+    std::lock_guard<std::mutex> guard(m_mutex);
+    refill(now);
+    double frameBits = canFrameNominalBits(bits, m_bitrate, m_dataBitrate);
+    if (m_reserved && now > m_reservedUntil) {
+        // Reserving frame was not retried
+        m_reserved = false;
+    }
+    std::uint32_t priority = arbitrationPriority(canId);
+    bool blocked = m_reserved && priority > arbitrationPriority(m_reservedId);
+    if (!blocked && m_tokens >= frameBits) {
+        m_tokens -= frameBits;
+        if (m_reserved && canId == m_reservedId) {
+            m_reserved = false;
+        }
+        return true;
+    }
+    if (!m_reserved || priority < arbitrationPriority(m_reservedId)) {
+        m_reserved = true;
+        m_reservedId = canId;
+        m_reservedBits = frameBits;
+    }
+    if (m_reservedId == canId) {
+        double missing = std::max(0.0, m_reservedBits - m_tokens);
+        m_reservedUntil = now + (std::uint64_t)(missing / m_bitsPerNanosecond) + ADMISSION_RESERVATION_HOLD;
+    }
+    return false;
+}
+
+/*!
+ * \brief AdmissionController::isReserved
+ * Check whether the budget is reserved for a frame
+ * \param canId: CAN ID of the frame
+ * \return True if the next budget is reserved for the CAN ID, false otherwise.
+ */
+bool AdmissionController::isReserved(std::uint32_t canId)
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return m_reserved && m_reservedId == canId;
+}
+
+/*!
+ * \brief AdmissionController::getRetryTime
+ * Get time when the budget covers the reserving frame
+ * \return Time in nanoseconds, ADMISSION_NEVER if nothing is reserved
+ */
+std::uint64_t AdmissionController::getRetryTime()
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (!m_reserved) {
+        return ADMISSION_NEVER;
+    }
+    double missing = std::max(0.0, m_reservedBits - m_tokens);
+    return m_lastRefill + (std::uint64_t)(missing / m_bitsPerNanosecond) + 1;
+}
+
+/*!
+ * \brief AdmissionController::reset
+ * Refill the budget and drop reservation
+ */
+void AdmissionController::reset()
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_tokens = m_capacity;
+    m_lastRefill = 0;
+    m_reserved = false;
+}
@@ -0,0 +1,60 @@
+/*!
+* \file
+* \brief admissioncontroller.h foo
+*/
+
+#ifndef ADMISSIONCONTROLLER_H
+#define ADMISSIONCONTROLLER_H
+
+#include "canfd.h"
+#include <cstdint>
+#include <mutex>
+
+// Budget accumulated while idle, as time of sending at the target load, in nanoseconds
+#define ADMISSION_BURST_TIME 10000000ULL
+// Budget always covers at least one maximum length frame, in bits
+#define ADMISSION_MIN_BURST_BITS 1024
+// Time a rejected frame keeps its reservation after the budget covers it, in nanoseconds
+#define ADMISSION_RESERVATION_HOLD 10000000ULL
+// Shortest wait before retrying frames held back, in nanoseconds
+#define ADMISSION_RETRY_INTERVAL 1000000ULL
+// Retry time when nothing is reserved
+#define ADMISSION_NEVER UINT64_MAX
+
+/*!
+ * Transmit admission controller holding the bus load below a target utilisation.
+ * A token bucket is filled with bit-time at the target share of the bitrate, and
+ * each sent frame consumes its length in nominal bits. When the budget is
+ * exhausted, the lowest rejected CAN ID reserves the next budget so that frames
+ * of lower priority cannot starve it. Times are CLOCK_MONOTONIC nanoseconds.
+ */
+class AdmissionController
+{
+public:
+    AdmissionController();
+    bool configure(int targetLoad, int bitrate, int dataBitrate = 0);
+    bool isEnabled() const;
+    int getTargetLoad() const;
+    bool admit(std::uint32_t canId, const canFrameBits &bits, std::uint64_t now);
+    bool isReserved(std::uint32_t canId);
+    std::uint64_t getRetryTime();
+    void reset();
+
+private:
+    std::mutex m_mutex;
+    int m_targetLoad;
+    int m_bitrate;
+    int m_dataBitrate;
+    double m_bitsPerNanosecond;
+    double m_capacity;
+    double m_tokens;
+    std::uint64_t m_lastRefill;
+    bool m_reserved;
+    std::uint32_t m_reservedId;
+    double m_reservedBits;
+    std::uint64_t m_reservedUntil;
+
+    void refill(std::uint64_t now);
+};
+
+#endif // ADMISSIONCONTROLLER_H
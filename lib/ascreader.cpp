@@ -6,12 +6,6 @@
 #include "ascreader.h"
 #include "logger.h"
 #include "stringtools.h"
-#include <cmath>
-#include <cstring>
-#include <fstream>
-#include <iomanip>
-#include <sstream>
-#include <unistd.h>
 #include <utility>
 
 const char *ASCReaderException::what() const throw()
@@ -21,81 +15,128 @@ const char *ASCReaderException::what() const throw()
 
 /*!
  * \brief ASCReader::ASCReader
- * Constructor
+ * Constructor, checks the headers of the log and its previous files without reading frames
+ * \param fileName: ASC file
+ * \param prefetch: Number of frames parsed ahead when streaming
  */
-ASCReader::ASCReader(const std::string &fileName) :
-    m_absoluteTimestamps(false),
+ASCReader::ASCReader(const std::string &fileName, std::size_t prefetch) :
     m_fileName(fileName),
-    m_hexId(false),
-    m_oldTimestamp(0)
+    m_frameQueueLoaded(false),
+    m_prefetch(prefetch)
 {
-    if (!parseASC(m_fileName)) {
+    if (!findLogFiles(m_fileName)) {
         throw ASCReaderException();
     }
 }
 
 /*!
- * \brief ASCReader::parseASC
- * Parse ASC file and fill CAN frame queue
- * \param fileName: Filename of file to parse
+ * \brief ASCReader::~ASCReader
+ * Destructor
+ */
+ASCReader::~ASCReader()
+{
+    stopStreaming();
+}
+
+/*!
+ * \brief ASCReader::findLogFiles
+ * Add ASC file to the files to parse, after its previous files of a continuous log
+ * \param fileName: Filename of file to check
  * \return True if successful, false otherwise.
  */
-bool ASCReader::parseASC(const std::string &fileName)
+bool ASCReader::findLogFiles(const std::string &fileName)
 {
-    std::string line;
-    std::ifstream file(fileName);
+    ASCTokenizer file(fileName);
+    ascFormat format = {};
 
-    if (!file.is_open()) {
+    if (!file.isOpen()) {
         LOG(LOG_ERR, "error=1 Unable to open ASC file.\n");
         return false;
     }
     // Parse ASC file header
-    if (!parseHeader(file)) {
+    if (!parseHeader(file, format)) {
         return false;
     }
-    // Check for continuous log and if found parse previous files recursively
-    if (!parseContinuousLogHeader(file)) {
+    // Check for continuous log and if found check previous files recursively
+    std::string previousLog;
+    if (!parseContinuousLogHeader(file, previousLog)) {
         return false;
     }
+    if (!previousLog.empty()) {
+        // Find separator between path and filename to get path of the original ASC file
+        std::size_t separatorPosition = m_fileName.find_last_of("/");
+        if ((separatorPosition == std::string::npos && !findLogFiles(previousLog)) ||
+            (separatorPosition != std::string::npos && !findLogFiles(m_fileName.substr(0, separatorPosition) + "/" + previousLog))) {
+            LOG(LOG_ERR, "Previous log file '%s' could not be found.\n", (m_fileName.substr(0, separatorPosition) + "/" + previousLog).c_str());
+            return false;
+        }
+    }
+    m_files.push_back(fileName);
+    return true;
+}
 
-    // Parse messages
-    while (std::getline(file, line)) {
-        // Parse input line for message
-        parseMessage(line);
+/*!
+ * \brief ASCReader::parseLog
+ * Parse frames of the log files in order
+ * \param handler: Function called with each frame, returns false to stop parsing
+ * \return True if successful, false if a file could not be read.
+ */
+bool ASCReader::parseLog(const std::function<bool(const canFrameQueueItem &item)> &handler)
+{
+    ascFormat format = {};
+    canFrameQueueItem item;
+    bool parsed = false;
+    std::uint64_t lastTimestamp = 0;
+    std::string previousLog;
+    const char *begin, *end;
+
+    for (auto it = m_files.begin(); it != m_files.end(); ++it) {
+        ASCTokenizer file(*it);
+        if (!file.isOpen()) {
+            LOG(LOG_ERR, "error=1 Unable to open ASC file.\n");
+            return false;
+        }
+        if (!parseHeader(file, format) || !parseContinuousLogHeader(file, previousLog)) {
+            return false;
+        }
+        // Relative timestamps continue from the last frame of the previous file
+        if (parsed) {
+            format.oldTimestamp = lastTimestamp / 1000.0f;
+        }
+        // Parse messages
+        while (file.nextLine(begin, end)) {
+            if (ASCTokenizer::parseFrame(begin, end, format, item)) {
+                parsed = true;
+                lastTimestamp = item.timestamp;
+                if (!handler(item)) {
+                    return true;
+                }
+            }
+        }
     }
     return true;
 }
 
 /*!
  * \brief ASCReader::parseContinuousLogHeader
- * Parse ASC file header for continuous log information and parse previous file if found
- * \param file: File stream to parse
+ * Parse ASC file header for continuous log information
+ * \param file: Mapped file to parse
+ * \param previousLog: Set to filename of the previous log, empty if there is none
  * \return True if successful, false otherwise.
  */
-bool ASCReader::parseContinuousLogHeader(std::ifstream &file)
+bool ASCReader::parseContinuousLogHeader(ASCTokenizer &file, std::string &previousLog)
 {
+    previousLog.clear();
     // Check if line contains comment data with continuous log information
-    int c = file.peek();
-    if (c == '/') {
-        std::string line;
-        std::getline(file, line);
+    const char *begin, *end;
+    if (file.peek() == '/' && file.nextLine(begin, end)) {
+        std::string line(begin, end);
         if (line.find("previous log file") != std::string::npos) {
             // Find filename of previous log
             std::size_t logfilePosition = line.rfind(" ");
             if (logfilePosition != std::string::npos) {
-                std::string previousLog = line.substr(logfilePosition);
+                previousLog = line.substr(logfilePosition);
                 previousLog = trim(previousLog, " ");
-                // Find separator between path and filename to get path of the original ASC file
-                std::size_t separatorPosition = m_fileName.find_last_of("/");
-                if ((separatorPosition == std::string::npos && !parseASC(previousLog)) ||
-                    (separatorPosition != std::string::npos && !parseASC(m_fileName.substr(0, separatorPosition) + "/" + previousLog))) {
-                    LOG(LOG_ERR, "Previous log file '%s' could not be found.\n", (m_fileName.substr(0, separatorPosition) + "/" + previousLog).c_str());
-                    return false;
-                }
-                // Update old timestamp to last message in queue
-                if (m_frameQueue.size() > 0) {
-                    m_oldTimestamp = m_frameQueue[m_frameQueue.size() - 1].timestamp / 1000.0f;
-                }
             } else {
                 LOG(LOG_ERR, "Unable to find filename of previous log.\n");
                 return false;
@@ -108,134 +149,108 @@ bool ASCReader::parseContinuousLogHeader(std::ifstream &file)
 /*!
  * \brief ASCReader::parseHeader
  * Parse ASC file header
- * \param file: File stream to parse
+ * \param file: Mapped file to parse
+ * \param format: Set to ID number base and timestamp format of the file
  * \return True if successful, false otherwise.
  */
-bool ASCReader::parseHeader(std::ifstream &file)
+bool ASCReader::parseHeader(ASCTokenizer &file, ascFormat &format)
 {
-    std::istringstream input;
-    std::string base, line, timestampFormat;
-
-    // Skip first line
-    std::getline(file, line);
-    // Read line with ID number base and timestamp format
-    std::getline(file, line);
-    input.str(line);
-    input.ignore(line.length(), ' ');
+    const char *begin, *end, *pos, *field, *fieldEnd;
+    std::string base, timestampFormat;
+
+    // Skip first line, then read line with ID number base and timestamp format:
+    // base <hex|dec> timestamps <absolute|relative>
+    file.nextLine(begin, end);
+    if (file.nextLine(begin, end)) {
+        pos = begin;
+        for (int index = 0; index < 4 && ASCTokenizer::nextToken(pos, end, field, fieldEnd); ++index) {
+            if (index == 1) {
+                base.assign(field, fieldEnd);
+            } else if (index == 3) {
+                timestampFormat.assign(field, fieldEnd);
+            }
+        }
+    }
     // Get ID number base (hex or dec)
-    input >> base;
     if (base == "hex") {
-        m_hexId = true;
-    } else if (base != "dec") {
+        format.hexId = true;
+    } else if (base == "dec") {
+        format.hexId = false;
+    } else {
         LOG(LOG_ERR, "Failed to parse CAN ID number base from ASC file header\n");
         return false;
     }
-    input.ignore(line.length(), ' ');
-    input.ignore(line.length(), ' ');
-    input.ignore(line.length(), ' ');
     // Get timestamp format (absolute or relative)
-    input >> timestampFormat;
     if (timestampFormat == "absolute") {
-        m_absoluteTimestamps = true;
-    } else if (timestampFormat != "relative") {
+        format.absoluteTimestamps = true;
+    } else if (timestampFormat == "relative") {
+        format.absoluteTimestamps = false;
+    } else {
         LOG(LOG_ERR, "Failed to parse timestamp format from ASC file header\n");
         return false;
     }
     // Skip unneeded information
-    std::getline(file, line);
-    std::getline(file, line);
+    file.nextLine(begin, end);
+    file.nextLine(begin, end);
     return true;
 }
 
 /*!
- * \brief ASCReader::parseMessage
- * Parse message in ASC file
- * \param line: Input string
+ * \brief ASCReader::startStreaming
+ * Start parsing frames from the beginning of the log on a producer thread, a running stream is restarted
  * \return True if successful, false otherwise.
  */
-bool ASCReader::parseMessage(std::string &line)
+bool ASCReader::startStreaming()
 {
-    std::istringstream input;
-    input.str(line);
-    int bus = 0, dlc = 0;
-    int index = m_frameQueue.size();
-    float timestamp = 0;
-    uint32_t id = 0;
-    std::string dir, type;
-    unsigned int data[8];
-
-    // Get timestamp and CAN bus number
-    input >> timestamp >> bus;
-
-    if (!input.good()) {
-        return false;
-    }
-    // Get CAN ID
-    if (m_hexId) {
-        input >> std::hex >> id;
-    } else {
-        input >> std::dec >> id;
-    }
-    if (!input.good()) {
-        return false;
-    }
-    // Check for extended frame
-    int c = input.peek();
-    if (c == 'x') {
-        input.ignore();
-        id |= 0x80000000U;
-    }
-    // Get direction
-    input >> dir;
-    // Get message type
-    input >> type;
-    // Data frame
-    if (type == "d") {
-        // Get number of bytes of data (dlc)
-        input >> std::dec >> dlc;
-        // Get frame data
-        int d;
-        input >> std::hex;
-        for (d = 0; d < dlc; ++d) {
-            input >> data[d];
-        }
-    } else {
-        // Other frame types not supported
+    stopStreaming();
+    m_prefetch.reset();
+    m_producerThread = std::thread([this] {
+        parseLog([this](const canFrameQueueItem &item) { return m_prefetch.push(item); });
+        m_prefetch.close();
+    });
+    return true;
+}
+
+/*!
+ * \brief ASCReader::readFrame
+ * Take next streamed frame, waits until the producer thread has parsed it
+ * \param item: Set to the frame
+ * \return True if a frame was read, false at end of log or when not streaming.
+ */
+bool ASCReader::readFrame(canFrameQueueItem &item)
+{
+    if (!m_producerThread.joinable()) {
         return false;
     }
-    // Set successfully parsed frame to frame queue
-    if (!input.fail()) {
-        if (!m_absoluteTimestamps) {
-            // When using relative timestamps add the old (cumulative) timestamp
-            // to timestamp of current message
-            timestamp += m_oldTimestamp;
-            // Keep track of old (cumulative) timestamp
-            m_oldTimestamp = timestamp;
-        }
-        m_frameQueue[index].timestamp = llround(timestamp * 1000);
-        if (dir == "Rx") {
-            m_frameQueue[index].in = true;
-        } else if (dir == "Tx") {
-            m_frameQueue[index].in = false;
-        }
-        memset(&m_frameQueue[index].frame, 0, sizeof(struct canfd_frame));
-        m_frameQueue[index].frame.can_id = id;
-        m_frameQueue[index].frame.len = dlc;
-        int d;
-        for (d = 0; d < dlc; ++d) {
-            m_frameQueue[index].frame.data[d] = data[d];
-        }
+    return m_prefetch.pop(item);
+}
+
+/*!
+ * \brief ASCReader::stopStreaming
+ * Stop the producer thread and drop buffered frames
+ */
+void ASCReader::stopStreaming()
+{
+    if (m_producerThread.joinable()) {
+        m_prefetch.cancel();
+        m_producerThread.join();
     }
-    return true;
 }
 
 /*!
  * \brief ASCReader::getFrameQueue
- * Get CAN frame queue
+ * Get CAN frame queue, the whole log is parsed into memory on the first call
  * \return Reference to CAN frame queue
  */
 std::map<std::uint64_t, canFrameQueueItem> &ASCReader::getFrameQueue()
 {
+    if (!m_frameQueueLoaded) {
+        m_frameQueueLoaded = true;
+        parseLog([this](const canFrameQueueItem &item) {
+            m_frameQueue[m_frameQueue.size()] = item;
+            return true;
+        });
+    }
     return m_frameQueue;
 }
 
@@ -247,9 +262,10 @@ std::map<std::uint64_t, canFrameQueueItem> &ASCReader::getFrameQueue()
  */
 bool ASCReader::createFilterList(std::map<std::uint32_t, bool> &list)
 {
-    std::map<std::uint64_t, canFrameQueueItem>::iterator queue;
-    for (queue = m_frameQueue.begin(); queue != m_frameQueue.end(); ++queue) {
-        list.insert(std::pair<std::uint32_t, bool>(queue->second.frame.can_id, false));
-    }
+    // Only the IDs are kept, the log is not loaded into memory
+    parseLog([&list](const canFrameQueueItem &item) {
+        list.insert(std::pair<std::uint32_t, bool>(item.frame.can_id, false));
+        return true;
+    });
     return (list.size() > 0);
 }
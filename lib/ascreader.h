@@ -6,13 +6,15 @@
 #ifndef ASCREADER_H
 #define ASCREADER_H
 
+#include "asctokenizer.h"
+#include "ringbuffer.h"
+#include <cstdint>
 #include <exception>
+#include <functional>
 #include <map>
 #include <string>
-
-extern "C" {
-#include <linux/can.h>
-}
+#include <thread>
+#include <vector>
 
 class ASCReaderException : public std::exception
 {
@@ -20,30 +22,40 @@ public:
     virtual const char *what() const throw();
 };
 
-struct canFrameQueueItem {
-    uint64_t timestamp;
-    bool in;
-    canfd_frame frame;
-};
+// Number of parsed frames buffered ahead of the replay
+#define ASC_PREFETCH_FRAMES 4096
 
+/*!
+ * Reader of ASC logs, including the previous files of continuous logs.
+ * Frames are parsed on demand: streaming parses them on a producer thread into
+ * a bounded buffer read with readFrame(), so memory use does not grow with the
+ * log size. getFrameQueue() parses the whole log into memory for random access.
+ */
 class ASCReader
 {
 public:
-    explicit ASCReader(const std::string &fileName);
+    explicit ASCReader(const std::string &fileName, std::size_t prefetch = ASC_PREFETCH_FRAMES);
+    ~ASCReader();
+    bool startStreaming();
+    bool readFrame(canFrameQueueItem &item);
+    void stopStreaming();
     std::map<std::uint64_t, canFrameQueueItem> &getFrameQueue();
     bool createFilterList(std::map<std::uint32_t, bool> &list);
 
 private:
-    bool m_absoluteTimestamps;
     std::string m_fileName;
+    std::vector<std::string> m_files;
     std::map<std::uint64_t, canFrameQueueItem> m_frameQueue;
-    bool m_hexId;
-    float m_oldTimestamp;
-
-    bool parseASC(const std::string &fileName);
-    bool parseContinuousLogHeader(std::ifstream &file);
-    bool parseHeader(std::ifstream &file);
-    bool parseMessage(std::string &line);
+    bool m_frameQueueLoaded;
+    RingBuffer<canFrameQueueItem> m_prefetch;
+    std::thread m_producerThread;
+
+    // Do not copy ASCReader
+    ASCReader(const ASCReader&);
+    bool findLogFiles(const std::string &fileName);
+    bool parseLog(const std::function<bool(const canFrameQueueItem &item)> &handler);
+    bool parseContinuousLogHeader(ASCTokenizer &file, std::string &previousLog);
+    bool parseHeader(ASCTokenizer &file, ascFormat &format);
 };
 
-#endif // CANTRANSCEIVER_H
+#endif // ASCREADER_H
@@ -0,0 +1,376 @@
+/*!
+* \file
+* \brief asctokenizer.cpp foo
+*/
+
+#include "asctokenizer.h"
+#include "canfd.h"
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Most significant digits of a timestamp that are used
+#define ASC_TIMESTAMP_MAX_DIGITS 18
+
+// Powers of ten dividing the digits of a timestamp
+static const double powersOfTen[ASC_TIMESTAMP_MAX_DIGITS + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+    1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18
+};
+
+/*!
+ * \brief isSpace
+ * Check for field separator, lines are already split at newlines
+ * \param c: Character
+ * \return True if c separates fields
+ */
+static inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/*!
+ * \brief hexDigit
+ * Get value of a hexadecimal digit without branching on the character class
+ * \param c: Character
+ * \return Value 0-15, or 16 if c is not a hexadecimal digit
+ */
+static inline unsigned int hexDigit(unsigned char c)
+{
+    unsigned int digit = c - '0';
+    unsigned int letter = (c | 0x20) - 'a';
+    return digit < 10 ? digit : (letter < 6 ? letter + 10 : 16);
+}
+
+/*!
+ * \brief parseDigits
+ * Parse digits at the start of a field
+ * \param pos: Start of the digits
+ * \param end: End of the field
+ * \param hex: Parse hexadecimal instead of decimal digits
+ * \param value: Parsed value
+ * \return Position after the digits, NULL if there were none
+ */
+static const char *parseDigits(const char *pos, const char *end, bool hex, std::uint32_t &value)
+{
+    const char *start = pos;
+    value = 0;
+    if (hex) {
+        for (unsigned int digit; pos < end && (digit = hexDigit(*pos)) < 16; ++pos) {
+            value = (value << 4) | digit;
+        }
+    } else {
+        for (unsigned int digit; pos < end && (digit = (unsigned char)*pos - '0') < 10; ++pos) {
+            value = value * 10 + digit;
+        }
+    }
+    return pos == start ? NULL : pos;
+}
+
+/*!
+ * \brief parseNumber
+ * Parse field containing only a number
+ * \param begin: Start of the field
+ * \param end: End of the field
+ * \param hex: Parse hexadecimal instead of decimal number
+ * \param value: Parsed value
+ * \return True if successful, false otherwise.
+ */
+static inline bool parseNumber(const char *begin, const char *end, bool hex, std::uint32_t &value)
+{
+    return parseDigits(begin, end, hex, value) == end;
+}
+
+/*!
+ * \brief parseTimestamp
+ * Parse timestamp in seconds with optional decimals
+ * \param begin: Start of the field
+ * \param end: End of the field
+ * \param timestamp: Parsed timestamp
+ * \return True if successful, false otherwise.
+ */
+static bool parseTimestamp(const char *begin, const char *end, float &timestamp)
+{
+    std::uint64_t mantissa = 0;
+    unsigned int digits = 0, decimals = 0;
+    bool point = false;
+    const char *pos;
+    for (pos = begin; pos < end; ++pos) {
+        unsigned int digit = (unsigned char)*pos - '0';
+        if (digit < 10) {
+            // Digits beyond the precision of a float are dropped
+            if (digits < ASC_TIMESTAMP_MAX_DIGITS) {
+                mantissa = mantissa * 10 + digit;
+                ++digits;
+                decimals += point;
+            } else if (!point) {
+                return false;
+            }
+        } else if (*pos == '.' && !point) {
+            point = true;
+        } else {
+            return false;
+        }
+    }
+    if (!digits) {
+        return false;
+    }
+    timestamp = (float)(mantissa / powersOfTen[decimals]);
+    return true;
+}
+
+/*!
+ * \brief parseId
+ * Parse CAN ID field
+ * \param begin: Start of the field
+ * \param end: End of the field
+ * \param hex: IDs are hexadecimal instead of decimal
+ * \param id: Parsed CAN ID, with CAN_EFF_FLAG set for extended frames marked with x
+ * \return True if successful, false otherwise.
+ */
+static bool parseId(const char *begin, const char *end, bool hex, std::uint32_t &id)
+{
+    const char *pos = parseDigits(begin, end, hex, id);
+    if (!pos) {
+        return false;
+    }
+    // Check for extended frame
+    if (pos < end && *pos == 'x') {
+        ++pos;
+        id |= CAN_EFF_FLAG;
+    }
+    return pos == end;
+}
+
+/*!
+ * \brief isToken
+ * Compare field to text
+ * \param begin: Start of the field
+ * \param end: End of the field
+ * \param text: Text to compare to
+ * \return True if the field equals text
+ */
+static inline bool isToken(const char *begin, const char *end, const char *text)
+{
+    std::size_t length = strlen(text);
+    return (std::size_t)(end - begin) == length && !memcmp(begin, text, length);
+}
+
+/*!
+ * \brief ASCTokenizer::ASCTokenizer
+ * Constructor, maps the file read-only
+ * \param fileName: ASC file
+ */
+ASCTokenizer::ASCTokenizer(const std::string &fileName) :
+    m_data(NULL),
+    m_size(0),
+    m_pos(NULL),
+    m_open(false)
+{
+    int fd = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    struct stat status;
+    if (fstat(fd, &status) == 0 && S_ISREG(status.st_mode)) {
+        m_size = status.st_size;
+        if (!m_size) {
+            m_open = true;
+        } else {
+            void *data = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                madvise(data, m_size, MADV_SEQUENTIAL);
+                m_data = static_cast<const char *>(data);
+                m_open = true;
+            }
+        }
+    }
+    close(fd);
+    m_pos = m_data;
+}
+
+/*!
+ * \brief ASCTokenizer::~ASCTokenizer
+ * Destructor
+ */
+ASCTokenizer::~ASCTokenizer()
+{
+    if (m_data) {
+        munmap(const_cast<char *>(m_data), m_size);
+    }
+}
+
+/*!
+ * \brief ASCTokenizer::isOpen
+ * Check if the file was mapped
+ * \return True if open, false otherwise.
+ */
+bool ASCTokenizer::isOpen() const
+{
+    return m_open;
+}
+
+/*!
+ * \brief ASCTokenizer::nextLine
+ * Get next line of the file
+ * \param begin: Set to start of the line
+ * \param end: Set to end of the line, excluding the newline
+ * \return True if a line was read, false at end of file.
+ */
+bool ASCTokenizer::nextLine(const char *&begin, const char *&end)
+{
+    const char *fileEnd = m_data + m_size;
+    if (!m_data || m_pos >= fileEnd) {
+        return false;
+    }
+    begin = m_pos;
+    end = static_cast<const char *>(memchr(m_pos, '\n', fileEnd - m_pos));
+    if (!end) {
+        end = fileEnd;
+        m_pos = fileEnd;
+    } else {
+        m_pos = end + 1;
+    }
+    return true;
+}
+
+/*!
+ * \brief ASCTokenizer::peek
+ * Get first character of the next line
+ * \return Character, -1 at end of file
+ */
+int ASCTokenizer::peek() const
+{
+    return (m_data && m_pos < m_data + m_size) ? (unsigned char)*m_pos : -1;
+}
+
+/*!
+ * \brief ASCTokenizer::nextToken
+ * Get next whitespace separated field of a line
+ * \param pos: Position in the line, moved past the field
+ * \param end: End of the line
+ * \param begin: Set to start of the field
+ * \param tokenEnd: Set to end of the field
+ * \return True if a field was found, false at end of line.
+ */
+bool ASCTokenizer::nextToken(const char *&pos, const char *end, const char *&begin, const char *&tokenEnd)
+{
+    while (pos < end && isSpace(*pos)) {
+        ++pos;
+    }
+    if (pos == end) {
+        return false;
+    }
+    begin = pos;
+    while (pos < end && !isSpace(*pos)) {
+        ++pos;
+    }
+    tokenEnd = pos;
+    return true;
+}
+
+/*!
+ * \brief ASCTokenizer::parseFrame
+ * Parse CAN or CAN FD data frame line of an ASC file
+ * \param begin: Start of the line
+ * \param end: End of the line
+ * \param format: Format of the file, cumulative timestamp is updated
+ * \param item: Set to the parsed frame
+ * \return True if a frame was parsed, false otherwise.
+ */
+bool ASCTokenizer::parseFrame(const char *begin, const char *end, ascFormat &format, canFrameQueueItem &item)
+{
+    const char *pos = begin;
+    const char *field, *fieldEnd;
+    float timestamp;
+    std::uint32_t id, bus, value, dlc, length;
+    std::uint8_t data[CANFD_MAX_DLEN];
+    bool canfd = false, brs = false, esi = false, in;
+
+    // Get timestamp
+    if (!nextToken(pos, end, field, fieldEnd) || !parseTimestamp(field, fieldEnd, timestamp) ||
+        !nextToken(pos, end, field, fieldEnd)) {
+        return false;
+    }
+    // CAN FD frames have keyword CANFD before CAN bus number
+    if (*field == 'C') {
+        if (!isToken(field, fieldEnd, "CANFD") || !nextToken(pos, end, field, fieldEnd)) {
+            return false;
+        }
+        canfd = true;
+    }
+    // Get CAN bus number
+    if (!parseNumber(field, fieldEnd, false, bus)) {
+        return false;
+    }
+    if (canfd) {
+        // <dir> <id> [symbolic name] <brs> <esi> <dlc> <data length> <data>
+        if (!nextToken(pos, end, field, fieldEnd)) {
+            return false;
+        }
+        in = isToken(field, fieldEnd, "Rx");
+        if (!nextToken(pos, end, field, fieldEnd) || !parseId(field, fieldEnd, format.hexId, id) ||
+            !nextToken(pos, end, field, fieldEnd)) {
+            return false;
+        }
+        // Skip optional symbolic name of the message
+        if ((unsigned int)((unsigned char)*field - '0') > 9 && !nextToken(pos, end, field, fieldEnd)) {
+            return false;
+        }
+        brs = isToken(field, fieldEnd, "1");
+        if (!nextToken(pos, end, field, fieldEnd) || !parseNumber(field, fieldEnd, false, value)) {
+            return false;
+        }
+        esi = value;
+        if (!nextToken(pos, end, field, fieldEnd) || !parseNumber(field, fieldEnd, true, dlc) ||
+            !nextToken(pos, end, field, fieldEnd) || !parseNumber(field, fieldEnd, false, length) ||
+            dlc > CANFD_MAX_DLC || length != canfdDlcToLength(dlc)) {
+            return false;
+        }
+    } else {
+        if (!nextToken(pos, end, field, fieldEnd) || !parseId(field, fieldEnd, format.hexId, id)) {
+            return false;
+        }
+        // Get direction
+        if (!nextToken(pos, end, field, fieldEnd)) {
+            return false;
+        }
+        in = isToken(field, fieldEnd, "Rx");
+        // Other frame types than data frame not supported
+        if (!nextToken(pos, end, field, fieldEnd) || !isToken(field, fieldEnd, "d")) {
+            return false;
+        }
+        // Get DLC, values above 8 still carry 8 bytes of data
+        if (!nextToken(pos, end, field, fieldEnd) || !parseNumber(field, fieldEnd, true, dlc)) {
+            return false;
+        }
+        length = (dlc > CAN_MAX_DLEN) ? CAN_MAX_DLEN : dlc;
+    }
+    // Get frame data
+    for (std::uint32_t d = 0; d < length; ++d) {
+        if (!nextToken(pos, end, field, fieldEnd) || !parseNumber(field, fieldEnd, true, value)) {
+            return false;
+        }
+        data[d] = value;
+    }
+    if (!format.absoluteTimestamps) {
+        // When using relative timestamps add the old (cumulative) timestamp
+        // to timestamp of current message
+        timestamp += format.oldTimestamp;
+        // Keep track of old (cumulative) timestamp
+        format.oldTimestamp = timestamp;
+    }
+    item.timestamp = llround(timestamp * 1000);
+    item.in = in;
+    memset(&item.frame, 0, sizeof(struct canfd_frame));
+    item.frame.can_id = id;
+    item.frame.len = length;
+    if (canfd) {
+        item.frame.flags = CANFD_FDF | (brs ? CANFD_BRS : 0) | (esi ? CANFD_ESI : 0);
+    }
+    memcpy(item.frame.data, data, length);
+    return true;
+}
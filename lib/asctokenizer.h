@@ -0,0 +1,59 @@
+/*!
+* \file
+* \brief asctokenizer.h foo
+*/
+
+#ifndef ASCTOKENIZER_H
+#define ASCTOKENIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+extern "C" {
+#include <linux/can.h>
+}
+
+struct canFrameQueueItem {
+    uint64_t timestamp;
+    bool in;
+    canfd_frame frame;
+};
+
+/*!
+ * Format of the ASC file being parsed
+ */
+struct ascFormat {
+    bool hexId;                 // CAN IDs are hexadecimal instead of decimal
+    bool absoluteTimestamps;    // Timestamps are absolute instead of relative to the previous frame
+    float oldTimestamp;         // Cumulative timestamp in seconds when using relative timestamps
+};
+
+/*!
+ * Line reader over a memory mapped ASC file.
+ * Lines and their fields are ranges of the mapping, so parsing frames does not
+ * allocate or copy. The mapping is read sequentially from start to end.
+ */
+class ASCTokenizer
+{
+public:
+    explicit ASCTokenizer(const std::string &fileName);
+    ~ASCTokenizer();
+    bool isOpen() const;
+    bool nextLine(const char *&begin, const char *&end);
+    int peek() const;
+    static bool nextToken(const char *&pos, const char *end, const char *&begin, const char *&tokenEnd);
+    static bool parseFrame(const char *begin, const char *end, ascFormat &format, canFrameQueueItem &item);
+
+private:
+    const char *m_data;
+    std::size_t m_size;
+    const char *m_pos;
+    bool m_open;
+
+    // Do not copy ASCTokenizer
+    ASCTokenizer(const ASCTokenizer&);
+    ASCTokenizer &operator=(const ASCTokenizer&);
+};
+
+#endif // ASCTOKENIZER_H
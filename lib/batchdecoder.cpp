@@ -0,0 +1,266 @@
+/*!
+* \file
+* \brief batchdecoder.cpp foo
+*/
+
+#include "batchdecoder.h"
+#include <cstddef>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/*!
+ * \brief BatchDecoder::BatchDecoder
+ * Constructor, prepare columns for all signals of the message
+ * \param message: CAN message to decode
+ * \param kernel: Preferred decoding kernel, falls back to the best supported one
+ */
+BatchDecoder::BatchDecoder(CANMessage &message, BatchDecoderKernel kernel) :
+    m_id(message.getId()),
+    m_size(0),
+    m_kernel(kernel),
+    m_extract(&BatchDecoder::extractScalar)
+{
+    std::map<std::string, CANSignal> &signals = message.getSignals();
+    for (auto it = signals.begin(); it != signals.end(); ++it) {
+        Column column;
+        column.name = it->first;
+        column.layout = it->second.getLayout();
+        column.isSigned = (it->second.getSign() == Sign::SIGNED);
+        column.factor = it->second.getFactor();
+        column.offset = it->second.getOffset();
+        m_columns.push_back(column);
+    }
+
+    while (!isKernelSupported(m_kernel)) {
+        m_kernel = static_cast<BatchDecoderKernel>(static_cast<int>(m_kernel) - 1);
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    if (m_kernel == BatchDecoderKernel::AVX2) {
+        m_extract = &BatchDecoder::extractAVX2;
+    } else if (m_kernel == BatchDecoderKernel::SSE) {
+        m_extract = &BatchDecoder::extractSSE;
+    }
+#endif
+}
+
+/*!
+ * \brief BatchDecoder::decode
+ * Decode frames to signal columns. All frames must have the ID of the message.
+ * \param frames: Array of frames
+ * \param count: Number of frames in array
+ * \return Number of decoded frames
+ */
+std::size_t BatchDecoder::decode(const canfd_frame *frames, std::size_t count)
+{
+    m_size = count;
+    for (auto it = m_columns.begin(); it != m_columns.end(); ++it) {
+        it->raw.resize(count);
+        it->physical.resize(count);
+        if (count == 0) {
+            continue;
+        }
+        if (it->layout.length == 0) {
+            memset(it->raw.data(), 0, count * sizeof(std::uint64_t));
+        } else if (it->layout.singleWord) {
+            m_extract(frames, count, it->layout, it->raw.data());
+        } else {
+            extractScalar(frames, count, it->layout, it->raw.data());
+        }
+
+        // Raw to physical conversion
+        const std::uint64_t *raw = it->raw.data();
+        double *physical = it->physical.data();
+        if (it->isSigned) {
+            for (std::size_t i = 0; i < count; ++i) {
+                physical[i] = (std::int64_t)raw[i] * it->factor + it->offset;
+            }
+        } else {
+            for (std::size_t i = 0; i < count; ++i) {
+                physical[i] = raw[i] * it->factor + it->offset;
+            }
+        }
+    }
+    return count;
+}
+
+/*!
+ * \brief BatchDecoder::getKernel
+ * Get decoding kernel in use
+ * \return Decoding kernel
+ */
+BatchDecoderKernel BatchDecoder::getKernel() const
+{
+    return m_kernel;
+}
+
+/*!
+ * \brief BatchDecoder::getId
+ * Get ID of the decoded message
+ * \return CAN message ID
+ */
+std::uint32_t BatchDecoder::getId() const
+{
+    return m_id;
+}
+
+/*!
+ * \brief BatchDecoder::getSignalCount
+ * Get number of signal columns
+ * \return Number of signals
+ */
+std::size_t BatchDecoder::getSignalCount() const
+{
+    return m_columns.size();
+}
+
+/*!
+ * \brief BatchDecoder::getSignalName
+ * Get name of the signal of a column
+ * \param signal: Index of the column
+ * \return Name of the signal
+ */
+const std::string &BatchDecoder::getSignalName(std::size_t signal) const
+{
+    return m_columns.at(signal).name;
+}
+
+/*!
+ * \brief BatchDecoder::size
+ * Get number of frames decoded on last call to decode
+ * \return Number of rows in columns
+ */
+std::size_t BatchDecoder::size() const
+{
+    return m_size;
+}
+
+/*!
+ * \brief BatchDecoder::getRawColumn
+ * Get raw values of a signal
+ * \param signal: Index of the column
+ * \return Raw values, sign extended for signed signals
+ */
+const std::vector<std::uint64_t> &BatchDecoder::getRawColumn(std::size_t signal) const
+{
+    return m_columns.at(signal).raw;
+}
+
+/*!
+ * \brief BatchDecoder::getPhysicalColumn
+ * Get physical values of a signal
+ * \param signal: Index of the column
+ * \return Physical values
+ */
+const std::vector<double> &BatchDecoder::getPhysicalColumn(std::size_t signal) const
+{
+    return m_columns.at(signal).physical;
+}
+
+/*!
+ * \brief BatchDecoder::isKernelSupported
+ * Check whether the CPU supports decoding kernel
+ * \param kernel: Decoding kernel
+ * \return True if supported, false otherwise.
+ */
+bool BatchDecoder::isKernelSupported(BatchDecoderKernel kernel)
+{
+    switch (kernel) {
+#if defined(__x86_64__) || defined(__i386__)
+    case BatchDecoderKernel::AVX2:
+        return __builtin_cpu_supports("avx2");
+    case BatchDecoderKernel::SSE:
+        return __builtin_cpu_supports("ssse3");
+#endif
+    case BatchDecoderKernel::SCALAR:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*!
+ * \brief BatchDecoder::extractScalar
+ * Extract sign extended raw values of a signal from frames one frame at a time
+ * \param frames: Array of frames
+ * \param count: Number of frames
+ * \param layout: Layout of the signal
+ * \param out: Output column
+ */
+void BatchDecoder::extractScalar(const canfd_frame *frames, std::size_t count, const SignalLayout &layout, std::uint64_t *out)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        out[i] = layout.signExtend(layout.extract(frames[i].data));
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/*!
+ * \brief BatchDecoder::extractSSE
+ * Extract sign extended raw values of a single word signal two frames at a time
+ * \param frames: Array of frames
+ * \param count: Number of frames
+ * \param layout: Layout of the signal
+ * \param out: Output column
+ */
+__attribute__((target("ssse3")))
+void BatchDecoder::extractSSE(const canfd_frame *frames, std::size_t count, const SignalLayout &layout, std::uint64_t *out)
+{
+    const __m128i swap = _mm_set_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+    const __m128i shift = _mm_cvtsi32_si128(layout.shift);
+    const __m128i mask = _mm_set1_epi64x(layout.mask);
+    const __m128i sign = _mm_set1_epi64x((layout.signBits && layout.signBits < 64) ? 1ULL << (layout.signBits - 1) : 0);
+    const bool motorola = (layout.order == ByteOrder::MOTOROLA);
+
+    std::size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        std::uint64_t word0;
+        std::uint64_t word1;
+        memcpy(&word0, frames[i].data + layout.wordOffset, sizeof(word0));
+        memcpy(&word1, frames[i + 1].data + layout.wordOffset, sizeof(word1));
+        __m128i value = _mm_set_epi64x(word1, word0);
+        if (motorola) {
+            value = _mm_shuffle_epi8(value, swap);
+        }
+        value = _mm_and_si128(_mm_srl_epi64(value, shift), mask);
+        value = _mm_sub_epi64(_mm_xor_si128(value, sign), sign);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), value);
+    }
+    extractScalar(frames + i, count - i, layout, out + i);
+}
+
+/*!
+ * \brief BatchDecoder::extractAVX2
+ * Extract sign extended raw values of a single word signal four frames at a time
+ * \param frames: Array of frames
+ * \param count: Number of frames
+ * \param layout: Layout of the signal
+ * \param out: Output column
+ */
+__attribute__((target("avx2")))
+void BatchDecoder::extractAVX2(const canfd_frame *frames, std::size_t count, const SignalLayout &layout, std::uint64_t *out)
+{
+    const long long stride = sizeof(canfd_frame);
+    const __m256i index = _mm256_set_epi64x(3 * stride, 2 * stride, stride, 0);
+    const __m256i swap = _mm256_set_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7,
+                                         8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+    const __m128i shift = _mm_cvtsi32_si128(layout.shift);
+    const __m256i mask = _mm256_set1_epi64x(layout.mask);
+    const __m256i sign = _mm256_set1_epi64x((layout.signBits && layout.signBits < 64) ? 1ULL << (layout.signBits - 1) : 0);
+    const bool motorola = (layout.order == ByteOrder::MOTOROLA);
+
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const long long *base = reinterpret_cast<const long long *>(frames[i].data + layout.wordOffset);
+        __m256i value = _mm256_i64gather_epi64(base, index, 1);
+        if (motorola) {
+            value = _mm256_shuffle_epi8(value, swap);
+        }
+        value = _mm256_and_si256(_mm256_srl_epi64(value, shift), mask);
+        value = _mm256_sub_epi64(_mm256_xor_si256(value, sign), sign);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), value);
+    }
+    extractScalar(frames + i, count - i, layout, out + i);
+}
+#endif
@@ -0,0 +1,70 @@
+/*!
+* \file
+* \brief batchdecoder.h foo
+*/
+
+#ifndef BATCHDECODER_H
+#define BATCHDECODER_H
+
+#include "canmessage.h"
+#include "signallayout.h"
+#include <linux/can.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class BatchDecoderKernel {
+    SCALAR = 0,
+    SSE = 1,
+    AVX2 = 2
+};
+
+/*!
+ * Batch decoder of CAN frames of a single message.
+ * Frames are decoded to structure of arrays: one contiguous raw column and one
+ * physical column per signal, in the signal order of CANMessage::getSignals().
+ * Raw values of signed signals are sign extended to 64 bits.
+ */
+class BatchDecoder
+{
+public:
+    explicit BatchDecoder(CANMessage &message, BatchDecoderKernel kernel = BatchDecoderKernel::AVX2);
+    std::size_t decode(const canfd_frame *frames, std::size_t count);
+    BatchDecoderKernel getKernel() const;
+    std::uint32_t getId() const;
+    std::size_t getSignalCount() const;
+    const std::string &getSignalName(std::size_t signal) const;
+    std::size_t size() const;
+    const std::vector<std::uint64_t> &getRawColumn(std::size_t signal) const;
+    const std::vector<double> &getPhysicalColumn(std::size_t signal) const;
+
+private:
+    struct Column {
+        std::string name;
+        SignalLayout layout;
+        bool isSigned;
+        double factor;
+        double offset;
+        std::vector<std::uint64_t> raw;
+        std::vector<double> physical;
+    };
+
+    typedef void (*ExtractFunction)(const canfd_frame *frames, std::size_t count,
+                                    const SignalLayout &layout, std::uint64_t *out);
+
+    std::uint32_t m_id;
+    std::size_t m_size;
+    BatchDecoderKernel m_kernel;
+    ExtractFunction m_extract;
+    std::vector<Column> m_columns;
+
+    static bool isKernelSupported(BatchDecoderKernel kernel);
+    static void extractScalar(const canfd_frame *frames, std::size_t count, const SignalLayout &layout, std::uint64_t *out);
+#if defined(__x86_64__) || defined(__i386__)
+    static void extractSSE(const canfd_frame *frames, std::size_t count, const SignalLayout &layout, std::uint64_t *out);
+    static void extractAVX2(const canfd_frame *frames, std::size_t count, const SignalLayout &layout, std::uint64_t *out);
+#endif
+};
+
+#endif // BATCHDECODER_H
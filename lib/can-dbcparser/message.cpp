@@ -1,4 +1,5 @@
 #include "header/message.hpp"
+#include "canfd.h"
 #include "logger.h"
 
 #include <istream>
@@ -16,7 +17,8 @@ std::istream& operator>>(std::istream& in, Message& msg) {
 
 	//Parse the Messages length
 	in >> msg.dlc;
-	if (msg.dlc > 8) {
+	//CAN FD messages have payload length of a valid DLC code
+	if (!isValidCANFDLength(msg.dlc)) {
 		LOG(LOG_WARN, "warning=1 Incorrect dlc %u in CAN message %u\n", msg.dlc, msg.id);
 		in.setstate(std::ios_base::failbit);
 		return in;
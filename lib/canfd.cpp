@@ -0,0 +1,111 @@
+/*!
+* \file
+* \brief canfd.cpp foo
+*/
+
+#include "canfd.h"
+
+// Classic CAN frame without ID and data: SOF, RTR, IDE, r0, DLC, CRC, CRC delimiter, ACK and EOF
+#define CAN_FRAME_BITS 33
+// CAN FD arbitration phase without ID: SOF, RRS, IDE, FDF, res and BRS
+#define CANFD_ARBITRATION_BITS 6
+// CAN FD data phase without data: ESI and DLC
+#define CANFD_CONTROL_BITS 5
+// CAN FD stuff count and CRC including fixed stuff bits, for CRC-17 and CRC-21
+#define CANFD_CRC17_BITS 27
+#define CANFD_CRC21_BITS 32
+// CAN FD end of frame: CRC delimiter, ACK and EOF
+#define CANFD_TRAILER_BITS 10
+
+static const std::uint8_t dlcToLength[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
+
+/*!
+ * \brief canfdDlcToLength
+ * Convert CAN FD DLC code to payload length
+ * \param dlc: DLC code (0-15)
+ * \return Payload length in bytes
+ */
+std::uint8_t canfdDlcToLength(std::uint8_t dlc)
+{
+    return dlcToLength[dlc & CANFD_MAX_DLC];
+}
+
+/*!
+ * \brief canfdLengthToDlc
+ * Convert payload length to smallest CAN FD DLC code which can hold it
+ * \param length: Payload length in bytes
+ * \return DLC code (0-15)
+ */
+std::uint8_t canfdLengthToDlc(std::uint8_t length)
+{
+    std::uint8_t dlc = 0;
+    while (dlc < CANFD_MAX_DLC && dlcToLength[dlc] < length) {
+        ++dlc;
+    }
+    return dlc;
+}
+
+/*!
+ * \brief isValidCANFDLength
+ * Check whether payload length can be expressed with a DLC code
+ * \param length: Payload length in bytes
+ * \return True if valid, false otherwise.
+ */
+bool isValidCANFDLength(unsigned int length)
+{
+    return length <= CANFD_MAX_DLEN && dlcToLength[canfdLengthToDlc(length)] == length;
+}
+
+/*!
+ * \brief isCANFDFrame
+ * Check whether frame is a CAN FD frame
+ * \param frame: Pointer to frame
+ * \return True if CAN FD frame, false if classic CAN frame.
+ */
+bool isCANFDFrame(const canfd_frame *frame)
+{
+    return (frame->flags & CANFD_FDF) || frame->len > CAN_MAX_DLEN;
+}
+
+/*!
+ * \brief canFrameBitCount
+ * Calculate number of bits of a CAN (FD) frame
+ * \param extended: True if frame has extended ID
+ * \param length: Payload length in bytes
+ * \param canfd: True if CAN FD frame
+ * \param bitRateSwitch: True if data phase of CAN FD frame uses data bitrate
+ * \return Number of bits in nominal and data phase
+ */
+canFrameBits canFrameBitCount(bool extended, unsigned int length, bool canfd, bool bitRateSwitch)
+{
+    canFrameBits bits;
+    unsigned int idBits = extended ? CAN_EFF_ID_BITS : CAN_SFF_ID_BITS;
+    if (!canfd) {
+        bits.nominal = CAN_FRAME_BITS + (length * 8) + idBits;
+        bits.data = 0;
+        return bits;
+    }
+    bits.nominal = CANFD_ARBITRATION_BITS + idBits + CANFD_TRAILER_BITS;
+    bits.data = CANFD_CONTROL_BITS + (length * 8) + ((length > 16) ? CANFD_CRC21_BITS : CANFD_CRC17_BITS);
+    if (!bitRateSwitch) {
+        bits.nominal += bits.data;
+        bits.data = 0;
+    }
+    return bits;
+}
+
+/*!
+ * \brief canFrameNominalBits
+ * Convert number of bits to the equivalent number of bits at nominal bitrate
+ * \param bits: Number of bits in nominal and data phase
+ * \param bitrate: Nominal bitrate, or 0 if not known
+ * \param dataBitrate: Data bitrate, or 0 if not known
+ * \return Equivalent number of nominal bits
+ */
+float canFrameNominalBits(const canFrameBits &bits, int bitrate, int dataBitrate)
+{
+    if (bitrate > 0 && dataBitrate > 0) {
+        return bits.nominal + (bits.data * (bitrate / (float)dataBitrate));
+    }
+    return bits.nominal + bits.data;
+}
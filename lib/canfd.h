@@ -0,0 +1,36 @@
+/*!
+* \file
+* \brief canfd.h foo
+*/
+
+#ifndef CANFD_H
+#define CANFD_H
+
+#include <cstdint>
+
+extern "C" {
+#include <linux/can.h>
+}
+
+#ifndef CANFD_FDF
+#define CANFD_FDF 0x04
+#endif
+
+/*!
+ * Number of bits of a CAN (FD) frame, excluding dynamic stuff bits and interframe space.
+ * Bits of the data phase are sent with the data bitrate when bit rate switch is used.
+ */
+struct canFrameBits {
+    unsigned int nominal;   // Bits sent with the nominal (arbitration) bitrate
+    unsigned int data;      // Bits sent with the data bitrate
+};
+
+std::uint8_t canfdDlcToLength(std::uint8_t dlc);
+std::uint8_t canfdLengthToDlc(std::uint8_t length);
+bool isValidCANFDLength(unsigned int length);
+bool isCANFDFrame(const canfd_frame *frame);
+
+canFrameBits canFrameBitCount(bool extended, unsigned int length, bool canfd, bool bitRateSwitch);
+float canFrameNominalBits(const canFrameBits &bits, int bitrate, int dataBitrate);
+
+#endif // CANFD_H
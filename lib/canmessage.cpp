@@ -4,8 +4,9 @@
 */
 
 #include "canmessage.h"
+#include "canfd.h"
 #include "logger.h"
-#include <cmath>
+#include <algorithm>
 #include <endian.h>
 #include <inttypes.h>
 #include <string.h>
@@ -17,11 +18,16 @@
  */
 CANMessage::CANMessage(const Message &message) :
     m_modified(false),
-    m_sendTime(std::chrono::high_resolution_clock::now()),
+    m_codec(NULL),
+    m_multiplexor(NULL),
+    m_lastPayloadValid(false),
     m_transferSuccessful(0),
     m_transferFailed(0),
     m_transferFalseDirection(0),
-    m_direction(MessageDirection::SEND)
+    m_direction(MessageDirection::SEND),
+    m_canfd(false),
+    m_bitRateSwitch(false),
+    m_sendOffset(-1)
 {
     name = message.getName();
     id = message.getId();
@@ -35,6 +41,9 @@ CANMessage::CANMessage(const Message &message) :
     for (const auto &attribute : attributes) {
         attributeList.insert({attribute.first, Attribute(attribute.second)});
     }
+    initDecodePlan();
+    initFrameFormat();
+    initSendSchedule();
 }
 
 /*!
@@ -52,6 +61,8 @@ CANMessage::CANMessage(const CANMessage &message)
     m_transferSuccessful = message.getSuccessful();
     m_transferFailed = message.getFailed();
     m_transferFalseDirection = message.getFalseDirection();
+    m_codec = message.m_codec;
+    m_codecValues = message.m_codecValues;
     for (auto it = message.m_signals.begin(); it != message.m_signals.end(); ++it) {
         m_signals.insert({it->second.getName(), CANSignal(it->second)});
     }
@@ -60,6 +71,10 @@ CANMessage::CANMessage(const CANMessage &message)
     for (const auto &attribute : attributes) {
         attributeList.insert({attribute.first, Attribute(attribute.second)});
     }
+    initDecodePlan();
+    initFrameFormat();
+    initSendSchedule();
+    m_sendOffset = message.m_sendOffset;
     m_modified = message.m_modified;
 }
 
@@ -78,6 +93,8 @@ CANMessage& CANMessage::operator=(const CANMessage &message)
     m_transferSuccessful = message.getSuccessful();
     m_transferFailed = message.getFailed();
     m_transferFalseDirection = message.getFalseDirection();
+    m_codec = message.m_codec;
+    m_codecValues = message.m_codecValues;
     for (auto it = message.m_signals.begin(); it != message.m_signals.end(); ++it) {
         m_signals.insert({it->second.getName(), CANSignal(it->second)});
     }
@@ -86,6 +103,10 @@ CANMessage& CANMessage::operator=(const CANMessage &message)
     for (const auto &attribute : attributes) {
         attributeList.insert({attribute.first, Attribute(attribute.second)});
     }
+    initDecodePlan();
+    initFrameFormat();
+    initSendSchedule();
+    m_sendOffset = message.m_sendOffset;
     m_modified = message.m_modified;
     return *this;
 }
@@ -101,60 +122,207 @@ bool CANMessage::isModified() const
 }
 
 /*!
- * \brief CANMessage::isSendScheduled
- * Return whether message should be sent
- * \param now: Current time
- * \return True if message should be sent, false otherwise.
+ * \brief CANMessage::isActive
+ * Check whether any signal of an if active message or signal differs from its inactive value
+ * \return True if message is active, false otherwise.
  */
-bool CANMessage::isSendScheduled(std::chrono::time_point<std::chrono::system_clock> &now)
+bool CANMessage::isActive() const
 {
-    bool ret = false;
-    try {
-        int cycleTime = 0;
-        bool updateSendTime = false;
-        if (getAttribute("GenMsgCycleTime")) {
-            cycleTime = std::stoi(getAttribute("GenMsgCycleTime")->getValue());
-        }
-        // Check message first
-        std::string msgSendType;
-        if (getAttribute("GenMsgSendType")) {
-            msgSendType = getAttribute("GenMsgSendType")->getValue();
-            if (msgSendType == "Cyclic" && cycleTime > 0 && now >= m_sendTime) {
-                updateSendTime = true;
-                ret = true;
-            } else if (msgSendType == "OnChange" ||
-                msgSendType == "OnChangeWithRepetition") {
-                if (isModified()) {
-                    ret = true;
-                }
-            }
+    for (std::size_t index = 0; index < m_signalOrder.size(); ++index) {
+        if (m_sendType != SendType::IF_ACTIVE && !((m_activeSignals[index / 64] >> (index % 64)) & 1)) {
+            continue;
         }
-        // Check also signals if message is not to be sent yet
-        if (!ret) {
-            for (auto it = m_signals.begin(); it != m_signals.end(); ++it) {
-                if (it->second.getAttribute("GenSigSendType")) {
-                    std::string sigSendType = it->second.getAttribute("GenSigSendType")->getValue();
-                    if ((sigSendType == "Cyclic") && now >= m_sendTime) {
-                        updateSendTime = true;
-                        ret = true;
-                        break;
-                    } else if (sigSendType == "OnChange" || sigSendType == "OnChangeWithRepetition") {
-                        if (it->second.isModified()) {
-                            ret = true;
-                            break;
-                        }
-                    }
-                }
-            }
+        const CANSignal *signal = m_signalOrder[index];
+        std::uint64_t mask = (signal->getLength() >= 64) ? UINT64_MAX : ((std::uint64_t)1 << signal->getLength()) - 1;
+        if ((signal->getRawValue() ^ m_inactiveValues[index]) & mask) {
+            return true;
         }
-        if (updateSendTime) {
-            m_sendTime = now + std::chrono::duration<int,std::milli>(cycleTime);
+    }
+    return false;
+}
+
+/*!
+ * \brief CANMessage::isCyclic
+ * Check whether message is sent cyclically, either by message or signal send type
+ * \return True if message is sent cyclically, false otherwise.
+ */
+bool CANMessage::isCyclic() const
+{
+    return (m_sendType == SendType::CYCLIC && m_cycleTime > 0) || m_cyclicSignals;
+}
+
+/*!
+ * \brief CANMessage::isIfActive
+ * Check whether message is sent at fast cycle time while active, either by message or signal send type
+ * \return True if message is sent while active, false otherwise.
+ */
+bool CANMessage::isIfActive() const
+{
+    if (m_cycleTimeFast <= 0) {
+        return false;
+    }
+    if (m_sendType == SendType::IF_ACTIVE) {
+        return true;
+    }
+    for (auto it = m_activeSignals.begin(); it != m_activeSignals.end(); ++it) {
+        if (*it) {
+            return true;
         }
     }
-    catch (const std::exception &) {
+    return false;
+}
+
+/*!
+ * \brief CANMessage::isChangeScheduled
+ * Return whether message should be sent because its content changed
+ * \return True if message should be sent, false otherwise.
+ */
+bool CANMessage::isChangeScheduled() const
+{
+    if ((m_sendType == SendType::ON_CHANGE || m_sendType == SendType::ON_CHANGE_WITH_REPETITION) && isModified()) {
+        return true;
+    }
+    return isSignalModified(m_onChangeSignals);
+}
+
+/*!
+ * \brief CANMessage::isRepetitionScheduled
+ * Return whether sending the changed message content should be followed by repetitions
+ * \return True if message should be repeated, false otherwise.
+ */
+bool CANMessage::isRepetitionScheduled() const
+{
+    if (m_repetitions <= 0) {
         return false;
     }
-    return ret;
+    if (m_sendType == SendType::ON_CHANGE_WITH_REPETITION && isModified()) {
+        return true;
+    }
+    return isSignalModified(m_repetitionSignals);
+}
+
+/*!
+ * \brief CANMessage::isOnChange
+ * Check whether message can be sent on change, either by message or signal send type
+ * \return True if message is sent on change, false otherwise.
+ */
+bool CANMessage::isOnChange() const
+{
+    if (m_sendType == SendType::ON_CHANGE || m_sendType == SendType::ON_CHANGE_WITH_REPETITION) {
+        return true;
+    }
+    for (auto it = m_onChangeSignals.begin(); it != m_onChangeSignals.end(); ++it) {
+        if (*it) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * \brief CANMessage::isSignalModified
+ * Check whether any of the given signals has been modified
+ * \param signals: Bitmask of signal indices
+ * \return True if any of the signals has been modified, false otherwise.
+ */
+bool CANMessage::isSignalModified(const std::vector<std::uint64_t> &signals) const
+{
+    for (std::size_t word = 0; word < signals.size(); ++word) {
+        std::uint64_t bits = signals[word];
+        while (bits) {
+            if (m_signalOrder[word * 64 + __builtin_ctzll(bits)]->isModified()) {
+                return true;
+            }
+            bits &= bits - 1;
+        }
+    }
+    return false;
+}
+
+/*!
+ * \brief CANMessage::getSendType
+ * Get send type of the message
+ * \return Send type from GenMsgSendType attribute
+ */
+SendType CANMessage::getSendType() const
+{
+    return m_sendType;
+}
+
+/*!
+ * \brief CANMessage::getCycleTime
+ * Get cycle time of the message
+ * \return Cycle time in milliseconds from GenMsgCycleTime attribute, 0 if not defined
+ */
+int CANMessage::getCycleTime() const
+{
+    return m_cycleTime;
+}
+
+/*!
+ * \brief CANMessage::getCycleTimeFast
+ * Get fast cycle time of repetitions and if active sends
+ * \return Cycle time in milliseconds from GenMsgCycleTimeFast attribute, 0 if not defined
+ */
+int CANMessage::getCycleTimeFast() const
+{
+    return m_cycleTimeFast;
+}
+
+/*!
+ * \brief CANMessage::getDelayTime
+ * Get minimum delay between sends of changed message content
+ * \return Delay in milliseconds from GenMsgDelayTime attribute, 0 if not defined
+ */
+int CANMessage::getDelayTime() const
+{
+    return m_delayTime;
+}
+
+/*!
+ * \brief CANMessage::getRepetitions
+ * Get number of repetitions after sending changed message content
+ * \return Number of repetitions from GenMsgNrOfRepetition attribute, 0 if not defined
+ */
+int CANMessage::getRepetitions() const
+{
+    return m_repetitions;
+}
+
+/*!
+ * \brief CANMessage::getSendOffset
+ * Get configured phase offset of cyclic sends
+ * \return Offset in milliseconds from start of cycle, -1 if assigned automatically
+ */
+int CANMessage::getSendOffset() const
+{
+    return m_sendOffset;
+}
+
+/*!
+ * \brief CANMessage::setSendOffset
+ * Set phase offset of cyclic sends
+ * \param offset: Offset in milliseconds from start of cycle, -1 to assign automatically
+ */
+void CANMessage::setSendOffset(int offset)
+{
+    m_sendOffset = offset;
+}
+
+/*!
+ * \brief CANMessage::isOnChangeSignal
+ * Check whether signal triggers sending of the message when modified
+ * \param name: Name of the signal
+ * \return True if GenSigSendType of the signal is on change, false otherwise.
+ */
+bool CANMessage::isOnChangeSignal(const std::string &name) const
+{
+    for (std::size_t index = 0; index < m_signalOrder.size(); ++index) {
+        if (m_signalOrder[index]->getName() == name) {
+            return (m_onChangeSignals[index / 64] >> (index % 64)) & 1;
+        }
+    }
+    return false;
 }
 
 /*!
@@ -186,6 +354,7 @@ void CANMessage::resetValues(bool setValues)
             m_modified = false;
         }
     }
+    m_lastPayloadValid = false;
 }
 
 /*!
@@ -201,6 +370,7 @@ bool CANMessage::setValue(const std::string &key, Value &value)
     if (CANSignal *signal = getSignalPrivate(key)) {
         if (signal->setValue(value)) {
             m_modified = true;
+            m_lastPayloadValid = false;
             return true;
         }
     }
@@ -220,12 +390,49 @@ bool CANMessage::setValue(const std::string &key, const std::string &value)
     if (CANSignal *signal = getSignalPrivate(key)) {
         if (signal->setValue(value)) {
             m_modified = true;
+            m_lastPayloadValid = false;
             return true;
         }
     }
     return false;
 }
 
+/*!
+ * \brief CANMessage::setValue
+ * Set a value for a signal of the message
+ * \param signal: Signal of the message
+ * \param value: Value for the signal
+ * \return True if successful, false otherwise.
+ */
+bool CANMessage::setValue(CANSignal &signal, Value &value)
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (signal.setValue(value)) {
+        m_modified = true;
+        m_lastPayloadValid = false;
+        return true;
+    }
+    return false;
+}
+
+/*!
+ * \brief CANMessage::setValue
+ * Set a value for a signal of the message from string
+ * \param signal: Signal of the message
+ * \param valueString: Value as a string
+ * \return True if successful, false otherwise.
+ */
+bool CANMessage::setValue(CANSignal &signal, const std::string &valueString)
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (signal.setValue(valueString)) {
+        m_modified = true;
+        m_lastPayloadValid = false;
+        return true;
+    }
+    return false;
+}
+
 /*!
  * \brief CANMessage::getSignal
  * Get CANSignal by signal name
@@ -284,6 +491,16 @@ std::map<std::string, CANSignal> &CANMessage::getSignals()
     return m_signals;
 }
 
+/*!
+ * \brief CANMessage::getSignals
+ * Get all CANSignal objects in a map
+ * \return Const reference to map containing CANSignal objects
+ */
+const std::map<std::string, CANSignal> &CANMessage::getSignals() const
+{
+    return m_signals;
+}
+
 /*!
  * \brief CANSimulatorCore::assembleCANFrame
  * Fill CAN frame with current values of message
@@ -296,61 +513,65 @@ void CANMessage::assembleCANFrame(canfd_frame *frame)
     LOG(LOG_DBG, "Assemble message %u (%#x): %s\n", id, id, name.c_str());
     frame->len = dlc;
     frame->can_id = id;
+    if (m_canfd) {
+        frame->flags = CANFD_FDF | (m_bitRateSwitch ? CANFD_BRS : 0);
+    }
 
     std::lock_guard<std::mutex> guard(m_mutex);
-    for (auto it = m_signals.begin(); it != m_signals.end(); ++it) {
-        LOG(LOG_DBG, "Add to CAN message: %s=%f\n", it->second.getName().c_str(), it->second.getValue().toDouble());
-        uint64_t value = it->second.getRawValue();
-        // Index of the first part of the value in array
-        int startIndex;
-        // Calculate start bit for the signal value
-        int startBit;
-        if (it->second.getByteOrder() == ByteOrder::INTEL) {
-            startBit = it->second.getStartbit();
-            startIndex = floor(startBit / 8);
-        } else {
-            //Convert bit numbering to inverted format
-            //data will be filled to CAN frame in reverse order
-            //Start from the end (dlc-1)
-            startBit = (dlc - 1) * 8;
-            //Subtract length-1 of the value
-            startBit -= (it->second.getLength() - 1);
-            //Subtract full bytes of the start bit
-            startBit -= floor(it->second.getStartbit() / 8) * 8;
-            //Add remainder of the start bit
-            startBit += it->second.getStartbit() % 8;
-            startIndex = floor(startBit / 8) - (dlc - 1);
+    if (m_codec) {
+        std::size_t index = 0;
+        for (auto it = m_signals.begin(); it != m_signals.end(); ++it, ++index) {
+            LOG(LOG_DBG, "Add to CAN message: %s=%f\n", it->second.getName().c_str(), it->second.getValue().toDouble());
+            m_codecValues[index] = it->second.getRawValue();
         }
+        m_codec->encode(m_codecValues.data(), frame->data);
+        return;
+    }
 
-        // Amount of unread value data of current signal left in array
-        unsigned int dataLeft = it->second.getLength();
-        // Offset from array index
-        unsigned int startOffset = abs(startBit) % 8;
-        // Current offset
-        unsigned int offset = startOffset;
-        // Current index
-        int index = startIndex;
-        // Add value to array
-        while (dataLeft > 0) {
-            // Amount of data to be read from current index
-            unsigned int currentSize = ((8 - offset) >= dataLeft) ? dataLeft : (8 - offset);
-            // Bit mask for the current index
-            unsigned int bitmask = (1 << currentSize) - 1;
-            // Add part of the value to current index
-            if (startOffset != 0 && (startIndex - index) == 0) {
-                frame->data[abs(index)] |= (value & bitmask) << startOffset;
-            } else {
-                frame->data[abs(index)] |= (value >> (8 * abs(startIndex - index) - startOffset)) & bitmask;
+    for (auto it = m_staticSignals.begin(); it != m_staticSignals.end(); ++it) {
+        LOG(LOG_DBG, "Add to CAN message: %s=%f\n", (*it)->getName().c_str(), (*it)->getValue().toDouble());
+        (*it)->getLayout().insert(frame->data, (*it)->getRawValue());
+    }
+    if (m_multiplexor) {
+        // Add only signals of the page selected by multiplexor
+        auto page = m_multiplexedSignals.find(m_multiplexor->getRawValue() & m_multiplexor->getLayout().mask);
+        if (page != m_multiplexedSignals.end()) {
+            for (auto it = page->second.begin(); it != page->second.end(); ++it) {
+                LOG(LOG_DBG, "Add to CAN message: %s=%f\n", (*it)->getName().c_str(), (*it)->getValue().toDouble());
+                (*it)->getLayout().insert(frame->data, (*it)->getRawValue());
             }
-            offset=0;
-            // Calculate amount of data left
-            dataLeft -= currentSize;
-            // Shift index
-            index++;
         }
     }
 }
 
+/*!
+ * \brief CANMessage::takeSnapshot
+ * Store last received payload and modified signals to snapshot and clear modified state
+ * \param snapshot: Snapshot to fill
+ * \param timestamp: Reception time of the payload
+ */
+void CANMessage::takeSnapshot(MessageSnapshot &snapshot, const std::chrono::time_point<std::chrono::system_clock> &timestamp)
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    snapshot.m_message = this;
+    snapshot.m_id = id;
+    snapshot.m_timestamp = timestamp;
+    snapshot.m_length = dlc;
+    // Received words may hold bytes past the length of the message
+    std::size_t length = std::min<std::size_t>(dlc, sizeof(snapshot.m_payload));
+    memcpy(snapshot.m_payload, m_lastPayload, length);
+    memset(snapshot.m_payload + length, 0, sizeof(snapshot.m_payload) - length);
+    memset(snapshot.m_changed, 0, sizeof(snapshot.m_changed));
+    std::size_t index = 0;
+    for (auto it = m_signals.begin(); it != m_signals.end(); ++it, ++index) {
+        if (it->second.isModified() && index < MESSAGE_SNAPSHOT_MAX_SIGNALS) {
+            snapshot.m_changed[index / 64] |= (uint64_t)1 << (index % 64);
+        }
+        it->second.setModified(false);
+    }
+    m_modified = false;
+}
+
 /*!
  * \brief CANMessage::parseCANFrame
  * Parse CAN frame and return boolean whether message content had changed
@@ -366,65 +587,297 @@ bool CANMessage::parseCANFrame(canfd_frame *frame, bool canfd)
     LOG(LOG_DBG, "Parse CANFrame %u (%#x), len: %u, CAN FD: %i\n",  frame->can_id, frame->can_id, frame->len, canfd);
 
     std::lock_guard<std::mutex> guard(m_mutex);
+    // Decode only signals whose bits differ from the previous payload, all after values were set
+    uint64_t diffWords[SIGNAL_LAYOUT_DIFF_WORDS] = {0};
+    const uint64_t *diff = m_lastPayloadValid ? diffWords : NULL;
+    if (!updatePayload(frame->data, diffWords) && diff) {
+        return false;
+    }
+
+    if (m_codec) {
+        m_codec->decode(frame->data, m_codecValues.data());
+        std::size_t index = 0;
+        for (auto it = m_signals.begin(); it != m_signals.end(); ++it, ++index) {
+            if (!diff) {
+                ret |= updateSignalFromRaw(it->second, m_codecValues[index]);
+            } else if (it->second.getLayout().isChanged(diff)) {
+                ret |= it->second.setValueFromRaw(m_codecValues[index]);
+            }
+        }
+        return ret;
+    }
+
+    for (auto it = m_staticSignals.begin(); it != m_staticSignals.end(); ++it) {
+        ret |= decodeSignal(**it, frame->data, diff);
+    }
+    if (m_multiplexor) {
+        // Decode only signals of the page selected by multiplexor, all of them if page changed
+        auto page = m_multiplexedSignals.find(m_multiplexor->getLayout().extract(frame->data));
+        if (page != m_multiplexedSignals.end()) {
+            const uint64_t *pageDiff = (diff && !m_multiplexor->getLayout().isChanged(diff)) ? diff : NULL;
+            for (auto it = page->second.begin(); it != page->second.end(); ++it) {
+                ret |= decodeSignal(**it, frame->data, pageDiff);
+            }
+        }
+    }
+    return ret;
+}
+
+/*!
+ * \brief CANMessage::updatePayload
+ * Store payload as previous payload and compute difference to the old one
+ * \param data: Payload of received frame
+ * \param diff: SIGNAL_LAYOUT_DIFF_WORDS zero initialized words to fill with XOR of payloads
+ * \return True if payload differs from the previous one, false otherwise.
+ */
+bool CANMessage::updatePayload(const uint8_t *data, uint64_t *diff)
+{
+    uint64_t changed = 0;
+    for (std::size_t word = 0; word < (dlc + 7) / 8; ++word) {
+        uint64_t value;
+        memcpy(&value, data + word * 8, sizeof(value));
+        diff[word] = value ^ m_lastPayload[word];
+        changed |= diff[word];
+        m_lastPayload[word] = value;
+    }
+    m_lastPayloadValid = true;
+    return changed != 0;
+}
+
+/*!
+ * \brief CANMessage::decodeSignal
+ * Decode signal from payload
+ * \param signal: Signal to update
+ * \param data: Payload of received frame
+ * \param diff: XOR of the payload and previous payload, NULL to decode regardless of it
+ * \return True if signal value had changed, false otherwise.
+ */
+bool CANMessage::decodeSignal(CANSignal &signal, const uint8_t *data, const uint64_t *diff)
+{
+    const SignalLayout &layout = signal.getLayout();
+    if (!diff) {
+        return updateSignalFromRaw(signal, layout.signExtend(layout.extract(data)));
+    }
+    if (layout.isChanged(diff)) {
+        return signal.setValueFromRaw(layout.signExtend(layout.extract(data)));
+    }
+    return false;
+}
+
+/*!
+ * \brief CANMessage::updateSignalFromRaw
+ * Update signal value from raw value extracted from CAN frame
+ * \param signal: Signal to update
+ * \param value: Raw value, sign extended for signed signals
+ * \return True if signal value had changed, false otherwise.
+ */
+bool CANMessage::updateSignalFromRaw(CANSignal &signal, uint64_t value)
+{
+    const SignalLayout &layout = signal.getLayout();
+    if (!signal.isValueSet() || (value & layout.mask) != (signal.getRawValue() & layout.mask)) {
+        return signal.setValueFromRaw(value);
+    }
+    return false;
+}
+
+/*!
+ * \brief CANMessage::initDecodePlan
+ * Sort signals to static signals and pages of multiplexed signals
+ */
+void CANMessage::initDecodePlan()
+{
+    m_lastPayloadValid = false;
+    memset(m_lastPayload, 0, sizeof(m_lastPayload));
+    m_multiplexor = NULL;
+    m_staticSignals.clear();
+    m_multiplexedSignals.clear();
     for (auto it = m_signals.begin(); it != m_signals.end(); ++it) {
-        uint64_t value = 0;
-        // Index of the first part of the value in array
-        int startIndex;
-        // Calculate start bit for the signal value
-        int startBit;
-        if (it->second.getByteOrder() == ByteOrder::INTEL) {
-            startBit = it->second.getStartbit();
-            startIndex = floor(startBit / 8);
+        if (it->second.getMultiplexor() == Multiplexor::MULTIPLEXED) {
+            m_multiplexedSignals[it->second.getMultiplexedNumber()].push_back(&it->second);
         } else {
-            //Convert bit numbering to inverted format
-            //data will be filled to CAN frame in reverse order
-            //Start from the end (dlc-1)
-            startBit = (dlc - 1) * 8;
-            //Subtract length-1 of the value
-            startBit -= (it->second.getLength() - 1);
-            //Subtract full bytes of the start bit
-            startBit -= floor(it->second.getStartbit() / 8) * 8;
-            //Add remainder of the start bit
-            startBit += it->second.getStartbit() % 8;
-            startIndex = floor(startBit / 8) - (dlc - 1);
+            if (it->second.getMultiplexor() == Multiplexor::MULTIPLEXOR) {
+                m_multiplexor = &it->second;
+            }
+            m_staticSignals.push_back(&it->second);
+        }
+    }
+    if (!m_multiplexor && !m_multiplexedSignals.empty()) {
+        // Without multiplexor all signals are handled on every frame
+        for (auto page = m_multiplexedSignals.begin(); page != m_multiplexedSignals.end(); ++page) {
+            m_staticSignals.insert(m_staticSignals.end(), page->second.begin(), page->second.end());
         }
+        m_multiplexedSignals.clear();
+    }
+}
 
-        // Amount of unread value data of current signal left in array
-        unsigned int dataLeft = it->second.getLength();
-        // Offset from array index
-        unsigned int startOffset = abs(startBit) % 8;
-        // Current offset
-        unsigned int offset = startOffset;
-        // Current index
-        int index = startIndex;
-        // Extract value from array
-        while (dataLeft > 0) {
-            // Amount of data to be read from current index
-            unsigned int currentSize = ((8 - offset) >= dataLeft) ? dataLeft : (8 - offset);
-            // Bit mask for the current index
-            unsigned int bitmask = (1 << currentSize) - 1;
-            // Extract part of the value from current index
-            if (startOffset != 0 && (startIndex - index) == 0) {
-                value |= (frame->data[abs(index)] >> startOffset) & bitmask;
-            } else {
-                value |= (frame->data[abs(index)] & bitmask) << (8 * abs(startIndex - index) - startOffset);
+/*!
+ * \brief toSendType
+ * Convert value of GenMsgSendType or GenSigSendType attribute to send type
+ * \param value: Attribute value
+ * \return Send type, SendType::NONE if not supported
+ */
+static SendType toSendType(const std::string &value)
+{
+    if (value == "Cyclic") {
+        return SendType::CYCLIC;
+    } else if (value == "OnChange") {
+        return SendType::ON_CHANGE;
+    } else if (value == "OnChangeWithRepetition") {
+        return SendType::ON_CHANGE_WITH_REPETITION;
+    } else if (value == "IfActive") {
+        return SendType::IF_ACTIVE;
+    }
+    return SendType::NONE;
+}
+
+/*!
+ * \brief toUnsignedAttribute
+ * Convert value of a non-negative integer attribute such as GenMsgCycleTimeFast
+ * \param attribute: Attribute, NULL if not defined
+ * \param value: Set to attribute value, 0 if not defined or invalid
+ * \return True if valid or not defined, false otherwise.
+ */
+static bool toUnsignedAttribute(Attribute *attribute, int &value)
+{
+    value = 0;
+    if (!attribute) {
+        return true;
+    }
+    try {
+        value = std::stoi(attribute->getValue());
+    }
+    catch (const std::exception &) {
+        return false;
+    }
+    if (value < 0) {
+        value = 0;
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief CANMessage::initSendSchedule
+ * Resolve send type, cycle times and repetitions of the message and its signals from attributes
+ */
+void CANMessage::initSendSchedule()
+{
+    m_sendType = SendType::NONE;
+    m_cycleTime = 0;
+    m_cycleTimeFast = 0;
+    m_delayTime = 0;
+    m_repetitions = 0;
+    m_cyclicSignals = false;
+    m_lastSendTime = 0;
+    m_repetitionsLeft = 0;
+    m_sendDelayed = false;
+    m_signalOrder.clear();
+    m_onChangeSignals.assign((m_signals.size() + 63) / 64, 0);
+    m_repetitionSignals.assign((m_signals.size() + 63) / 64, 0);
+    m_activeSignals.assign((m_signals.size() + 63) / 64, 0);
+    m_inactiveValues.assign(m_signals.size(), 0);
+    for (auto it = m_signals.begin(); it != m_signals.end(); ++it) {
+        m_signalOrder.push_back(&it->second);
+    }
+    if (Attribute *cycleTime = getAttribute("GenMsgCycleTime")) {
+        try {
+            m_cycleTime = std::stoi(cycleTime->getValue());
+        }
+        catch (const std::exception &) {
+            // Message is never scheduled for sending
+            LOG(LOG_WARN, "warning=4 Invalid GenMsgCycleTime of message %u (%#x)\n", id, id);
+            m_cycleTime = 0;
+            return;
+        }
+    }
+    if (!toUnsignedAttribute(getAttribute("GenMsgCycleTimeFast"), m_cycleTimeFast)) {
+        LOG(LOG_WARN, "warning=4 Invalid GenMsgCycleTimeFast of message %u (%#x)\n", id, id);
+    }
+    if (!toUnsignedAttribute(getAttribute("GenMsgDelayTime"), m_delayTime)) {
+        LOG(LOG_WARN, "warning=4 Invalid GenMsgDelayTime of message %u (%#x)\n", id, id);
+    }
+    if (!toUnsignedAttribute(getAttribute("GenMsgNrOfRepetition"), m_repetitions)) {
+        LOG(LOG_WARN, "warning=4 Invalid GenMsgNrOfRepetition of message %u (%#x)\n", id, id);
+    }
+    if (Attribute *sendType = getAttribute("GenMsgSendType")) {
+        m_sendType = toSendType(sendType->getValue());
+    }
+    for (std::size_t index = 0; index < m_signalOrder.size(); ++index) {
+        std::uint64_t bit = (std::uint64_t)1 << (index % 64);
+        if (Attribute *sendType = m_signalOrder[index]->getAttribute("GenSigSendType")) {
+            SendType type = toSendType(sendType->getValue());
+            if (type == SendType::CYCLIC) {
+                m_cyclicSignals = true;
+            } else if (type == SendType::ON_CHANGE || type == SendType::ON_CHANGE_WITH_REPETITION) {
+                m_onChangeSignals[index / 64] |= bit;
+                if (type == SendType::ON_CHANGE_WITH_REPETITION) {
+                    m_repetitionSignals[index / 64] |= bit;
+                }
+            } else if (type == SendType::IF_ACTIVE) {
+                m_activeSignals[index / 64] |= bit;
             }
-            // Calculate amount of data left
-            dataLeft -= currentSize;
-            // Only start of the value can have offset
-            offset = 0;
-            // Shift index
-            index++;
         }
+        if (Attribute *inactiveValue = m_signalOrder[index]->getAttribute("GenSigInactiveValue")) {
+            try {
+                m_inactiveValues[index] = (std::uint64_t)std::stoll(inactiveValue->getValue());
+            }
+            catch (const std::exception &) {
+                LOG(LOG_WARN, "warning=4 Invalid GenSigInactiveValue of signal '%s'\n",
+                    m_signalOrder[index]->getName().c_str());
+            }
+        }
+    }
+}
+
+/*!
+ * \brief CANMessage::initFrameFormat
+ * Determine CAN FD frame format from payload length and message attributes
+ */
+void CANMessage::initFrameFormat()
+{
+    m_canfd = (dlc > CAN_MAX_DLEN);
+    if (Attribute *frameFormat = getAttribute("VFrameFormat")) {
+        // CAN FD formats are "StandardCAN_FD" and "ExtendedCAN_FD"
+        if (frameFormat->getValue().find("_FD") != std::string::npos) {
+            m_canfd = true;
+        }
+    }
+    // Bit rate switch is used unless disabled for the message
+    m_bitRateSwitch = m_canfd;
+    if (Attribute *bitRateSwitch = getAttribute("CANFD_BRS")) {
+        m_bitRateSwitch = m_canfd && (bitRateSwitch->getValue() != "0");
+    }
+}
 
-        // Process extracted value
-        if (!it->second.isValueSet() || value != it->second.getRawValue()) {
-            if (it->second.setValueFromRaw(value)) {
-                ret = true;
+/*!
+ * \brief CANMessage::setCodec
+ * Use generated codec instead of signal layouts when assembling and parsing CAN frames
+ * \param codec: Pointer to generated codec, NULL to use signal layouts
+ * \return True if codec matches the message, false otherwise.
+ */
+bool CANMessage::setCodec(const FrameCodec *codec)
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (codec) {
+        // Generated codecs handle every signal on every frame
+        if (m_multiplexor) {
+            return false;
+        }
+        if (codec->id != id || codec->dlc != dlc || codec->signalCount != m_signals.size()) {
+            return false;
+        }
+        std::size_t index = 0;
+        for (auto it = m_signals.begin(); it != m_signals.end(); ++it, ++index) {
+            if (it->first != codec->signalNames[index]) {
+                return false;
             }
         }
+        m_codecValues.assign(codec->signalCount, 0);
+    } else {
+        m_codecValues.clear();
     }
-    return ret;
+    m_codec = codec;
+    return true;
 }
 
 /*
@@ -495,3 +948,23 @@ void CANMessage::updateTransfer(bool successful, MessageDirection direction)
         }
     }
 }
+
+/*!
+ * \brief CANMessage::isCANFD
+ * Check whether message is sent as CAN FD frame
+ * \return True if CAN FD message, false if classic CAN message.
+ */
+bool CANMessage::isCANFD() const
+{
+    return m_canfd;
+}
+
+/*!
+ * \brief CANMessage::getBitRateSwitch
+ * Check whether data phase of CAN FD message is sent with data bitrate
+ * \return True if bit rate switch is used, false otherwise.
+ */
+bool CANMessage::getBitRateSwitch() const
+{
+    return m_bitRateSwitch;
+}
@@ -7,12 +7,15 @@
 #define CANMESSAGE_H
 
 #include "cansignal.h"
+#include "framecodec.h"
+#include "messagesnapshot.h"
 #include <can-dbcparser/header/message.hpp>
 #include <linux/can.h>
 #include <chrono>
 #include <mutex>
 #include <string>
 #include <map>
+#include <vector>
 
 class CANSimulatorCore;
 class CANTransceiver;
@@ -23,6 +26,15 @@ enum class MessageDirection {
     RECEIVE = 1
 };
 
+// Send types of GenMsgSendType and GenSigSendType attributes
+enum class SendType {
+    NONE = 0,
+    CYCLIC,
+    ON_CHANGE,
+    ON_CHANGE_WITH_REPETITION,
+    IF_ACTIVE
+};
+
 class CANMessage : public Message
 {
     friend class CANSimulatorCore;
@@ -35,6 +47,7 @@ public:
     CANMessage& operator=(const CANMessage & msg);
     const CANSignal *getSignal(const std::string &name);
     std::map<std::string, CANSignal> &getSignals();
+    const std::map<std::string, CANSignal> &getSignals() const;
     bool isModified() const;
     std::string toString(bool details = false) const;
     void assembleCANFrame(canfd_frame *frame);
@@ -45,25 +58,76 @@ public:
     uint64_t getFailed() const;
     uint64_t getFalseDirection() const;
     void updateTransfer(bool successful, MessageDirection direction = MessageDirection::SEND);
+    bool isCANFD() const;
+    bool getBitRateSwitch() const;
+    SendType getSendType() const;
+    int getCycleTime() const;
+    int getCycleTimeFast() const;
+    int getDelayTime() const;
+    int getRepetitions() const;
+    int getSendOffset() const;
+    bool isOnChangeSignal(const std::string &name) const;
+    void takeSnapshot(MessageSnapshot &snapshot, const std::chrono::time_point<std::chrono::system_clock> &timestamp);
 
 protected:
-    bool isSendScheduled(std::chrono::time_point<std::chrono::system_clock> &now);
+    bool isActive() const;
+    bool isCyclic() const;
+    bool isIfActive() const;
+    bool isOnChange() const;
+    bool isChangeScheduled() const;
+    bool isRepetitionScheduled() const;
     void resetValues(bool setValues = false);
+    bool setCodec(const FrameCodec *codec);
     void setModified(bool modified);
+    void setSendOffset(int offset);
     bool setValue(const std::string &key, const std::string &valueString);
     bool setValue(const std::string &key, Value &value);
+    bool setValue(CANSignal &signal, const std::string &valueString);
+    bool setValue(CANSignal &signal, Value &value);
 
 private:
     bool m_modified;
     std::mutex m_mutex;
-    std::chrono::time_point<std::chrono::system_clock> m_sendTime;
     std::map<std::string, CANSignal> m_signals;
+    const FrameCodec *m_codec;
+    std::vector<std::uint64_t> m_codecValues;
+    CANSignal *m_multiplexor;
+    std::vector<CANSignal *> m_staticSignals;
+    std::map<unsigned int, std::vector<CANSignal *>> m_multiplexedSignals;
+    std::uint64_t m_lastPayload[SIGNAL_LAYOUT_PAYLOAD_SIZE / 8];
+    bool m_lastPayloadValid;
     CANSignal *getSignalPrivate(const std::string &name);
+    void initDecodePlan();
+    void initFrameFormat();
+    void initSendSchedule();
+    bool isSignalModified(const std::vector<std::uint64_t> &signals) const;
+    bool decodeSignal(CANSignal &signal, const uint8_t *data, const uint64_t *diff);
+    bool updatePayload(const uint8_t *data, uint64_t *diff);
+    bool updateSignalFromRaw(CANSignal &signal, uint64_t value);
 
     uint64_t m_transferSuccessful;
     uint64_t m_transferFailed;
     uint64_t m_transferFalseDirection;
     MessageDirection m_direction;
+    bool m_canfd;
+    bool m_bitRateSwitch;
+    // Send schedule resolved from attributes, signal send types as bitmasks of signal indices
+    SendType m_sendType;
+    int m_cycleTime;
+    int m_cycleTimeFast;
+    int m_delayTime;
+    int m_repetitions;
+    int m_sendOffset;
+    bool m_cyclicSignals;
+    std::vector<CANSignal *> m_signalOrder;
+    std::vector<std::uint64_t> m_onChangeSignals;
+    std::vector<std::uint64_t> m_repetitionSignals;
+    std::vector<std::uint64_t> m_activeSignals;
+    std::vector<std::uint64_t> m_inactiveValues;
+    // Send state of the sender thread
+    std::uint64_t m_lastSendTime;
+    int m_repetitionsLeft;
+    bool m_sendDelayed;
 };
 
 #endif // CANMESSAGE_H
@@ -7,9 +7,52 @@
 #include "cansimulatorcore.h"
 #include "logger.h"
 #include <cmath>
+#include <cstdlib>
 #include <map>
 #include <sstream>
 
+// Largest denominator tried when looking for exact integer scaling
+#define FIXED_POINT_MAX_DENOMINATOR 1000000000LL
+// Limit of intermediate values of integer scaling, keeps sums within 63 bits
+#define FIXED_POINT_LIMIT (1LL << 62)
+
+/*!
+ * \brief divideRounded
+ * Integer division rounding half away from zero, as llround does
+ * \param dividend: Dividend
+ * \param divisor: Non-zero divisor
+ * \return Rounded quotient
+ */
+static int64_t divideRounded(int64_t dividend, int64_t divisor)
+{
+    if (divisor < 0) {
+        dividend = -dividend;
+        divisor = -divisor;
+    }
+    if (dividend >= 0) {
+        return (dividend + divisor / 2) / divisor;
+    }
+    return -((-dividend + divisor / 2) / divisor);
+}
+
+/*!
+ * \brief scaledInteger
+ * Check whether value multiplied by denominator is an integer
+ * \param value: Value to scale
+ * \param denominator: Denominator
+ * \param numerator: Resulting integer
+ * \return True if value is exactly numerator / denominator, false otherwise.
+ */
+static bool scaledInteger(double value, int64_t denominator, int64_t &numerator)
+{
+    double scaled = value * denominator;
+    if (std::abs(scaled) >= FIXED_POINT_LIMIT) {
+        return false;
+    }
+    numerator = llround(scaled);
+    return std::abs(scaled - numerator) <= std::abs(scaled) * 1e-12;
+}
+
 /*!
  * \brief CANSignal::CANSignal
  * Constructor
@@ -28,6 +71,8 @@ CANSignal::CANSignal(const Signal &signal) :
     offset = signal.getOffset();
     unit = signal.getUnit();
     m_conversion = unitToConversionType(signal.getUnit());
+    m_layout = SignalLayout(order, startBit, length, sign);
+    initFixedPoint();
     multiplexor = signal.getMultiplexor();
     multiplexNum = signal.getMultiplexedNumber();
     to = signal.getTo();
@@ -84,6 +129,85 @@ const Value &CANSignal::getDefaultValue() const
     return m_defaultValue;
 }
 
+/*!
+ * \brief CANSignal::getLayout
+ * Get precompiled bit layout of the signal
+ * \return Bit layout of the signal
+ */
+const SignalLayout &CANSignal::getLayout() const
+{
+    return m_layout;
+}
+
+/*!
+ * \brief CANSignal::isFixedPoint
+ * Check whether factor and offset allow exact integer conversion between raw and physical values
+ * \return True if integer conversion is used, false if floating point conversion is used.
+ */
+bool CANSignal::isFixedPoint() const
+{
+    return m_fixedPoint;
+}
+
+/*!
+ * \brief CANSignal::initFixedPoint
+ * Find common denominator of factor and offset, power of ten or two, for exact integer conversion
+ */
+void CANSignal::initFixedPoint()
+{
+    m_fixedPoint = false;
+    m_scaleNumerator = 1;
+    m_scaleDenominator = 1;
+    m_offsetNumerator = 0;
+    if (length == 0 || length > 62) {
+        return;
+    }
+    static const int64_t bases[] = {10, 2};
+    for (int64_t base : bases) {
+        for (int64_t denominator = 1; denominator <= FIXED_POINT_MAX_DENOMINATOR; denominator *= base) {
+            int64_t numerator, offsetNumerator;
+            if (scaledInteger(factor, denominator, numerator) && numerator != 0 &&
+                scaledInteger(offset, denominator, offsetNumerator)) {
+                // Raw value times numerator plus offset numerator must not overflow
+                if (std::abs(numerator) < (FIXED_POINT_LIMIT >> length) && std::abs(offsetNumerator) < FIXED_POINT_LIMIT / 2) {
+                    m_fixedPoint = true;
+                    m_scaleNumerator = numerator;
+                    m_scaleDenominator = denominator;
+                    m_offsetNumerator = offsetNumerator;
+                }
+                return;
+            }
+        }
+    }
+}
+
+/*!
+ * \brief CANSignal::fixedPointToRaw
+ * Convert current value to raw value with integer scaling
+ * \param rawValue: Raw value, not truncated to signal length
+ * \return True if successful, false if value is out of integer scaling range.
+ */
+bool CANSignal::fixedPointToRaw(int64_t &rawValue) const
+{
+    int64_t scaled;
+    if (m_value.type() == Value::Integer) {
+        scaled = (int64_t)m_value.toInt() * m_scaleDenominator;
+    } else if (m_value.type() == Value::Unsigned) {
+        if (m_value.toUnsigned() >= (uint64_t)(FIXED_POINT_LIMIT / m_scaleDenominator)) {
+            return false;
+        }
+        scaled = (int64_t)m_value.toUnsigned() * m_scaleDenominator;
+    } else {
+        double value = m_value.toDouble() * m_scaleDenominator;
+        if (!(std::abs(value) < FIXED_POINT_LIMIT)) {
+            return false;
+        }
+        scaled = llround(value);
+    }
+    rawValue = divideRounded(scaled - m_offsetNumerator, m_scaleNumerator);
+    return true;
+}
+
 /*!
  * \brief CANSignal::getRawValue
  * Get current value of the signal as raw value ready for CAN frame
@@ -91,19 +215,19 @@ const Value &CANSignal::getDefaultValue() const
  */
 uint64_t CANSignal::getRawValue() const
 {
-    uint64_t rawValue = 0;
+    int64_t value;
+    if (!m_fixedPoint || !fixedPointToRaw(value)) {
+        value = llround((m_value.toDouble() - offset) / factor);
+    }
+    uint64_t rawValue = value;
     if (sign == Sign::SIGNED) {
         if (length == 8) {
-            rawValue = (uint8_t)llround((m_value.toDouble() - offset) / factor);
+            rawValue = (uint8_t)value;
         } else if (length == 16) {
-            rawValue = (uint16_t)llround((m_value.toDouble() - offset) / factor);
+            rawValue = (uint16_t)value;
         } else if (length == 32) {
-            rawValue = (uint32_t)llround((m_value.toDouble() - offset) / factor);
-        } else {
-            rawValue = llround((m_value.toDouble() - offset) / factor);
+            rawValue = (uint32_t)value;
         }
-    } else {
-        rawValue = llround((m_value.toDouble() - offset) / factor);
     }
     return rawValue;
 }
@@ -175,26 +299,28 @@ bool CANSignal::setValue(Value &value)
 }
 
 /*!
- * \brief CANSignal::setValueFromRaw
- * Set value of the signal from raw CAN value
- * \param rawValue: new value
- * \return True if successful, false otherwise.
+ * \brief CANSignal::rawToValue
+ * Convert raw CAN value to value of the signal without changing the signal
+ * \param rawValue: Raw value, sign extended to 64 bits for signed signals
+ * \return Converted value
  */
-bool CANSignal::setValueFromRaw(uint64_t rawValue)
+Value CANSignal::rawToValue(uint64_t rawValue) const
 {
     Value val;
-    if (m_value.type() == Value::Double) {
+    if (m_fixedPoint) {
+        // Raw value fits in 62 bits, sign extended for signed signals
+        int64_t scaled = (int64_t)rawValue * m_scaleNumerator + m_offsetNumerator;
+        if (m_value.type() == Value::Double) {
+            val = Value((double)scaled / m_scaleDenominator);
+        } else if (m_value.type() == Value::Unsigned) {
+            val = Value((unsigned long)divideRounded(scaled, m_scaleDenominator));
+        } else {
+            val = Value((int)divideRounded(scaled, m_scaleDenominator));
+        }
+    } else if (m_value.type() == Value::Double) {
         double value;
         if (sign == Sign::SIGNED) {
-            if (length == 8) {
-                value = ((int8_t)rawValue * factor) + offset;
-            } else if (length == 16) {
-                value = ((int16_t)rawValue * factor) + offset;
-            } else if (length == 32) {
-                value = ((int32_t)rawValue * factor) + offset;
-            } else {
-                return false;
-            }
+            value = ((int64_t)rawValue * factor) + offset;
         } else {
             value = (rawValue * factor) + offset;
         }
@@ -206,20 +332,24 @@ bool CANSignal::setValueFromRaw(uint64_t rawValue)
         // No unit conversion for integers?
         int value;
         if (sign == Sign::SIGNED) {
-            if (length == 8) {
-                value = lround(((int8_t)rawValue * factor) + offset);
-            } else if (length == 16) {
-                value = lround(((int16_t)rawValue * factor) + offset);
-            } else if (length == 32) {
-                value = lround(((int32_t)rawValue * factor) + offset);
-            } else {
-                return false;
-            }
+            value = lround(((int64_t)rawValue * factor) + offset);
         } else {
             value = lround((rawValue * factor) + offset);
         }
         val = Value(value);
     }
+    return val;
+}
+
+/*!
+ * \brief CANSignal::setValueFromRaw
+ * Set value of the signal from raw CAN value
+ * \param rawValue: new value, sign extended to 64 bits for signed signals
+ * \return True if successful, false otherwise.
+ */
+bool CANSignal::setValueFromRaw(uint64_t rawValue)
+{
+    Value val = rawToValue(rawValue);
     if (testValue(val)) {
         m_isValueSet = true;
         m_modified = true;
@@ -356,6 +486,18 @@ void CANSignal::setConversionUnit(const ConvertTo &conv)
  * \return Compact overview of the signal as a string
  */
 std::string CANSignal::toString(bool details) const
+{
+    return toString(m_value, details);
+}
+
+/*!
+ * \brief CANSignal::toString
+ * Print information about the signal with given value
+ * \param value: Value to print instead of the current value
+ * \param details: Add also signal attributes and value descriptions
+ * \return Compact overview of the signal as a string
+ */
+std::string CANSignal::toString(const Value &value, bool details) const
 {
     std::stringstream sstream;
     if (!description.empty()) {
@@ -364,11 +506,11 @@ std::string CANSignal::toString(bool details) const
     sstream << "name: " << name << ", type: " << m_valueType;
 
     if (!m_valueType.compare("double")) {
-        sstream << ", value: " << m_value.toDouble() << ", range [" << minimum << ", " << maximum << "] " << unit << "\n";
+        sstream << ", value: " << value.toDouble() << ", range [" << minimum << ", " << maximum << "] " << unit << "\n";
     } else if (!m_valueType.compare("unsigned")) {
-        sstream << ", value: " << m_value.toUnsigned() << ", range [" << llround(minimum) << ", " << llround(maximum) << "] " << unit << "\n";
+        sstream << ", value: " << value.toUnsigned() << ", range [" << llround(minimum) << ", " << llround(maximum) << "] " << unit << "\n";
     } else {
-        sstream << ", value: " << m_value.toInt() << ", range [" << lround(minimum) << ", " << lround(maximum) << "] " << unit << "\n";
+        sstream << ", value: " << value.toInt() << ", range [" << lround(minimum) << ", " << lround(maximum) << "] " << unit << "\n";
     }
     // Print value descriptions
     if (details) {
@@ -6,6 +6,7 @@
 #ifndef CANSIGNAL_H
 #define CANSIGNAL_H
 
+#include "signallayout.h"
 #include "unitconversion.h"
 #include "value.h"
 #include <can-dbcparser/header/signal.hpp>
@@ -24,12 +25,16 @@ public:
     explicit CANSignal(const Signal &signal);
     const ConvertTo &getConversionUnit() const;
     const Value &getDefaultValue() const;
+    const SignalLayout &getLayout() const;
     uint64_t getRawValue() const;
     const Value &getValue() const;
     const std::string &getVariableName() const;
+    bool isFixedPoint() const;
     bool isModified() const;
     bool isValueSet() const;
+    Value rawToValue(uint64_t rawValue) const;
     std::string toString(bool details = false) const;
+    std::string toString(const Value &value, bool details = false) const;
 
 protected:
     bool resetValue(bool setValue = false);
@@ -46,10 +51,18 @@ private:
     bool m_isValueSet;
     bool m_modified;
     ConvertTo m_conversion;
+    SignalLayout m_layout;
+    // Exact integer scaling: physical = (raw * numerator + offset numerator) / denominator
+    bool m_fixedPoint;
+    int64_t m_scaleNumerator;
+    int64_t m_scaleDenominator;
+    int64_t m_offsetNumerator;
     std::string m_valueType;
     std::string m_variableName;
     Value m_value;
     Value m_defaultValue;
+    void initFixedPoint();
+    bool fixedPointToRaw(int64_t &rawValue) const;
     bool parseValue(const std::string &valueString, Value &value);
     bool testValue(Value &value) const;
 };
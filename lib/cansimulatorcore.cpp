@@ -5,10 +5,13 @@
 
 #include "cansimulatorcore.h"
 #include "canerror.h"
+#include "canfd.h"
 #include "logger.h"
 #include "stringtools.h"
+#include <algorithm>
 #include <chrono>
 #include <cstring>
+#include <sys/epoll.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -16,8 +19,6 @@ extern "C" {
 #include <linux/can.h>
 }
 
-#define FRAME_SIZE 33
-
 const char *CANSimulatorCoreException::what() const throw()
 {
     return "CANSimulatorCoreException";
@@ -44,54 +45,43 @@ CANSimulatorCore::CANSimulatorCore(const std::string &cfg, const std::string &db
     m_interval(interval),
     m_runTime(runTime),
     m_sendTime(true),
+    m_sendTimeEnabled(true),
     m_useUTCTime(false),
     m_threadsRunning(true),
-    m_config(NULL),
+    m_snapshotPool(MESSAGE_SNAPSHOT_POOL_SIZE),
+    m_clock(&m_monotonicClock),
+    m_memoryLocked(false),
     m_ascReader(NULL),
-    m_canTransceiver(NULL),
     m_simulationRunning(false),
     m_simulationTime(0)
 {
+    memset(&m_errorMetrics, 0, sizeof(struct errorMetrics));
+    m_buses.push_back(new canBus());
     if (!asc.empty()) {
         try {
             m_ascReader = new ASCReader(asc);
         }
         catch (ASCReaderException&) {
+            delete m_buses[0];
             throw CANSimulatorCoreException();
         }
     } else {
         if (!loadConfiguration(cfg, dbc, suppressDefaults, ignoreDirections)) {
             m_threadsRunning = false;
+            delete m_buses[0];
             throw CANSimulatorCoreException();
         }
         setSendTime(m_sendTime);
     }
 
     // Do not use CAN interface if socket name is empty
-    if (socketName.empty()) {
-        return;
-    }
-
-    try {
-        int bitrateConfigured = 0;
-        // If .dbc-file has baudrate info use it in CAN interface initialization
-        if (m_config && m_config->getAttribute("Baudrate")) {
-            bitrateConfigured = std::stoi(m_config->getAttribute("Baudrate")->getValue());
-        }
-        m_canTransceiver = new CANTransceiver(socketName, bitrateConfigured);
-    }
-    catch (const std::invalid_argument &) {
-        LOG(LOG_WARN, "warning=2 Invalid dbc Baudrate: %s\n", m_config->getAttribute("Baudrate")->getValue().c_str());
-    }
-    catch (const std::out_of_range &) {
-        LOG(LOG_ERR, "error=2 dbc Baudrate out of range: %s\n", m_config->getAttribute("Baudrate")->getValue().c_str());
-    }
-    catch (CANTransceiverException&) {
+    if (!socketName.empty() && !openInterface(*m_buses[0], socketName)) {
         m_threadsRunning = false;
-        delete m_config;
+        delete m_ascReader;
+        delete m_buses[0]->config;
+        delete m_buses[0];
         throw CANSimulatorCoreException();
     }
-    memset(&m_errorMetrics, 0, sizeof(struct errorMetrics));
 }
 
 /*!
@@ -100,13 +90,46 @@ CANSimulatorCore::CANSimulatorCore(const std::string &cfg, const std::string &db
  */
 CANSimulatorCore::~CANSimulatorCore()
 {
-    m_threadsRunning = false;
+    stopCANThreads();
     // Wait for threads to end.
     if (m_readerThread.joinable()) m_readerThread.join();
     if (m_senderThread.joinable()) m_senderThread.join();
+    clearMessageQueue();
     delete m_ascReader;
-    delete m_canTransceiver;
-    delete m_config;
+    for (auto it = m_buses.begin(); it != m_buses.end(); ++it) {
+        delete (*it)->transceiver;
+        delete (*it)->config;
+        delete *it;
+    }
+}
+
+/*!
+ * \brief CANSimulatorCore::openInterface
+ * Open CAN interface of a bus, using the dbc Baudrate if defined
+ * \param bus: Bus using the interface
+ * \param socketName: CAN socket name
+ * \return True if successful, false otherwise.
+ */
+bool CANSimulatorCore::openInterface(canBus &bus, const std::string &socketName)
+{
+    try {
+        int bitrateConfigured = 0;
+        // If .dbc-file has baudrate info use it in CAN interface initialization
+        if (bus.config && bus.config->getAttribute("Baudrate")) {
+            bitrateConfigured = std::stoi(bus.config->getAttribute("Baudrate")->getValue());
+        }
+        bus.transceiver = new CANTransceiver(socketName, bitrateConfigured);
+    }
+    catch (const std::invalid_argument &) {
+        LOG(LOG_WARN, "warning=2 Invalid dbc Baudrate: %s\n", bus.config->getAttribute("Baudrate")->getValue().c_str());
+    }
+    catch (const std::out_of_range &) {
+        LOG(LOG_ERR, "error=2 dbc Baudrate out of range: %s\n", bus.config->getAttribute("Baudrate")->getValue().c_str());
+    }
+    catch (CANTransceiverException&) {
+        return false;
+    }
+    return true;
 }
 
 /*!
@@ -120,16 +143,196 @@ CANSimulatorCore::~CANSimulatorCore()
 */
 bool CANSimulatorCore::loadConfiguration(const std::string &cfg, const std::string &dbc, bool suppressDefaults, bool ignoreDirections)
 {
-    delete m_config;
+    // Queued snapshots refer to messages of the old configuration
+    clearMessageQueue();
+    delete m_buses[0]->config;
+    m_buses[0]->config = NULL;
+    try {
+        m_buses[0]->config = new Configuration(cfg, dbc, suppressDefaults, ignoreDirections);
+    }
+    catch (ConfigurationException&) {
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief CANSimulatorCore::addBus
+ * Add a bus driven by the same sender and reader threads. Variables of the bus are
+ * referred to as "name.variable". Buses are added before starting the threads.
+ * \param name: Name of the bus, used as prefix of its variables
+ * \param cfg: path to configuration file
+ * \param dbc: path to CAN specification dbc file
+ * \param socketName: CAN socket name, empty to not use a CAN interface
+ * \param suppressDefaults: suppress reporting incoming initial default values
+ * \param ignoreDirections: ignore message directions defined in configuration
+ * \return True if successful, false otherwise.
+ */
+bool CANSimulatorCore::addBus(const std::string &name, const std::string &cfg, const std::string &dbc,
+                              const std::string &socketName, bool suppressDefaults, bool ignoreDirections)
+{
+    if (name.empty() || name.find('.') != std::string::npos) {
+        LOG(LOG_WARN, "warning=4 Invalid bus name: '%s'\n", name.c_str());
+        return false;
+    }
+    for (auto it = m_buses.begin(); it != m_buses.end(); ++it) {
+        if ((*it)->name == name) {
+            LOG(LOG_WARN, "warning=4 Bus '%s' already exists\n", name.c_str());
+            return false;
+        }
+    }
+    canBus *bus = new canBus();
+    bus->name = name;
     try {
-        m_config = new Configuration(cfg, dbc, suppressDefaults, ignoreDirections);
+        bus->config = new Configuration(cfg, dbc, suppressDefaults, ignoreDirections);
     }
     catch (ConfigurationException&) {
+        delete bus;
         return false;
     }
+    if (!socketName.empty() && !openInterface(*bus, socketName)) {
+        delete bus->config;
+        delete bus;
+        return false;
+    }
+    int targetLoad = m_buses[0]->admission.getTargetLoad();
+    if (targetLoad) {
+        bus->admission.configure(targetLoad, getCANBitrate(*bus), getCANDataBitrate(*bus));
+    }
+    m_buses.push_back(bus);
+    setSendTime(m_sendTimeEnabled);
+    return true;
+}
+
+/*!
+ * \brief CANSimulatorCore::getBusCount
+ * Get number of buses, including the primary bus
+ * \return Number of buses
+ */
+std::size_t CANSimulatorCore::getBusCount() const
+{
+    return m_buses.size();
+}
+
+/*!
+ * \brief CANSimulatorCore::setTransceiver
+ * Use an already opened transceiver for a bus instead of its CAN interface.
+ * The core takes ownership of the transceiver. Set before starting the threads.
+ * \param name: Name of the bus, empty for the primary bus
+ * \param transceiver: CAN transceiver
+ * \return True if successful, false if the bus does not exist.
+ */
+bool CANSimulatorCore::setTransceiver(const std::string &name, CANTransceiver *transceiver)
+{
+    for (auto it = m_buses.begin(); it != m_buses.end(); ++it) {
+        if ((*it)->name == name) {
+            delete (*it)->transceiver;
+            (*it)->transceiver = transceiver;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * \brief CANSimulatorCore::addSignalRoute
+ * Set received values of a signal to an outgoing signal, typically of another bus.
+ * The target message is sent according to its send type when the value changes.
+ * \param source: Variable name of a signal received on its bus, "bus.variable" for added buses
+ * \param target: Variable name of the outgoing signal, "bus.variable" for added buses
+ * \return True if successful, false otherwise.
+ */
+bool CANSimulatorCore::addSignalRoute(const std::string &source, const std::string &target)
+{
+    signalRoute route;
+    std::string sourceVariable;
+    std::string targetVariable;
+    route.sourceBus = resolveBus(source, sourceVariable);
+    route.targetBus = resolveBus(target, targetVariable);
+    Configuration *sourceConfig = m_buses[route.sourceBus]->config;
+    Configuration *targetConfig = m_buses[route.targetBus]->config;
+    if (!sourceConfig || !targetConfig || !sourceConfig->getMessageId(sourceVariable, route.sourceId)) {
+        LOG(LOG_WARN, "warning=3 Unknown route source '%s'\n", source.c_str());
+        return false;
+    }
+    if (!sourceConfig->getReceiveIDs().count(route.sourceId)) {
+        // Values of other messages are never updated from received frames
+        LOG(LOG_WARN, "warning=3 Route source '%s' is not received\n", source.c_str());
+        return false;
+    }
+    route.source = sourceConfig->getSignalHandle(sourceVariable);
+    route.target = targetConfig->getSignalHandle(targetVariable);
+    if (!route.target.isValid() || !route.target.isOutgoing()) {
+        LOG(LOG_WARN, "warning=3 Unknown or incoming route target '%s'\n", target.c_str());
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(m_inputMutex);
+    m_routes.push_back(route);
     return true;
 }
 
+/*!
+ * \brief CANSimulatorCore::resolveBus
+ * Find the bus of a variable name
+ * \param key: Variable name, "bus.variable" for added buses
+ * \param variable: Set to variable name within the bus configuration
+ * \return Index of the bus, primary bus if key has no bus prefix
+ */
+unsigned int CANSimulatorCore::resolveBus(const std::string &key, std::string &variable) const
+{
+    std::size_t separator = key.find('.');
+    if (separator != std::string::npos) {
+        for (unsigned int bus = 1; bus < m_buses.size(); ++bus) {
+            if (!key.compare(0, separator, m_buses[bus]->name)) {
+                variable = key.substr(separator + 1);
+                return bus;
+            }
+        }
+    }
+    variable = key;
+    return 0;
+}
+
+/*!
+ * \brief CANSimulatorCore::routeSignals
+ * Copy received signals of a changed message to their route targets
+ * \param bus: Index of the bus receiving the message
+ * \param id: CAN ID of the changed message
+ */
+void CANSimulatorCore::routeSignals(unsigned int bus, std::uint32_t id)
+{
+    bool routed = false;
+    {
+        std::lock_guard<std::mutex> guard(m_inputMutex);
+        for (auto it = m_routes.begin(); it != m_routes.end(); ++it) {
+            if (it->sourceBus == bus && it->sourceId == id) {
+                Configuration *target = m_buses[it->targetBus]->config;
+                routed = target->setValue(it->target, target->getValue(it->source)) || routed;
+            }
+        }
+    }
+    if (routed) {
+        m_scheduler.notify();
+    }
+}
+
+/*!
+ * \brief CANSimulatorCore::loadCodecs
+ * Use generated codecs instead of generic signal layouts for matching messages
+ * \param codecs: Array of codecs generated with dbc2cpp
+ * \param count: Number of codecs in array
+ * \return Number of codecs taken into use
+ */
+std::size_t CANSimulatorCore::loadCodecs(const FrameCodec *codecs, std::size_t count)
+{
+    if (!m_buses[0]->config) {
+        return 0;
+    }
+    std::size_t loaded = m_buses[0]->config->loadCodecs(codecs, count);
+    LOG(LOG_INFO, "Using generated codecs for %zu of %zu messages\n", loaded, m_buses[0]->config->getMessages().size());
+    return loaded;
+}
+
 /*!
  * \brief CANSimulatorCore::getCfgVersion
  * Get cfg file date and revision
@@ -137,7 +340,7 @@ bool CANSimulatorCore::loadConfiguration(const std::string &cfg, const std::stri
  */
 std::string CANSimulatorCore::getCfgVersion() const
 {
-    return m_config->getCfgVersion();
+    return m_buses[0]->config->getCfgVersion();
 }
 
 /*!
@@ -147,7 +350,7 @@ std::string CANSimulatorCore::getCfgVersion() const
  */
 std::string CANSimulatorCore::getDBCVersion() const
 {
-    return m_config->getDBCVersion();
+    return m_buses[0]->config->getDBCVersion();
 }
 
 /*!
@@ -170,6 +373,22 @@ void CANSimulatorCore::setUseNativeUnits(bool enable)
     m_useNativeUnits = enable;
 }
 
+/*!
+ * \brief isTimeSupported
+ * Check whether configuration has the variables for automatic sending of time
+ * \param config: Configuration of a bus
+ * \return True if time variables are supported, false otherwise
+ */
+static bool isTimeSupported(Configuration *config)
+{
+    return config &&
+           config->isVariableSupported("year") &&
+           config->isVariableSupported("month") &&
+           config->isVariableSupported("day") &&
+           config->isVariableSupported("hour") &&
+           config->isVariableSupported("min");
+}
+
 /*!
  * \brief CANSimulatorCore::getSendTime
  * Get usage of automatic sending of time
@@ -182,19 +401,16 @@ bool CANSimulatorCore::getSendTime() const
 
 /*!
  * \brief CANSimulatorCore::setSendTime
- * Set usage of automatic sending of time
+ * Set usage of automatic sending of time, enabled if any bus has the time variables
  */
 void CANSimulatorCore::setSendTime(bool enable)
 {
-    if (enable &&
-        (m_config->isVariableSupported("year") &&
-         m_config->isVariableSupported("month") &&
-         m_config->isVariableSupported("day") &&
-         m_config->isVariableSupported("hour") &&
-         m_config->isVariableSupported("min"))) {
-        m_sendTime = true;
-    } else {
-        m_sendTime = false;
+    m_sendTimeEnabled = enable;
+    m_sendTime = false;
+    for (auto it = m_buses.begin(); enable && it != m_buses.end(); ++it) {
+        if (isTimeSupported((*it)->config)) {
+            m_sendTime = true;
+        }
     }
 }
 
@@ -217,6 +433,54 @@ void CANSimulatorCore::setUseUTCTime(bool enable)
     m_useUTCTime = enable;
 }
 
+/*!
+ * \brief CANSimulatorCore::getClock
+ * Get time source of sending, replay and metrics
+ * \return Clock
+ */
+Clock &CANSimulatorCore::getClock() const
+{
+    return *m_clock;
+}
+
+/*!
+ * \brief CANSimulatorCore::setClock
+ * Set time source of sending, replay and metrics, set before starting threads or collecting metrics
+ * \param clock: Clock which must outlive the simulator, NULL for real time
+ */
+void CANSimulatorCore::setClock(Clock *clock)
+{
+    m_clock = clock ? clock : &m_monotonicClock;
+}
+
+/*!
+ * \brief CANSimulatorCore::getBusLoadLimit
+ * Get target bus utilisation of sent frames
+ * \return Target bus load in percent, 0 if not limited
+ */
+int CANSimulatorCore::getBusLoadLimit() const
+{
+    return m_buses[0]->admission.getTargetLoad();
+}
+
+/*!
+ * \brief CANSimulatorCore::setBusLoadLimit
+ * Limit bus utilisation of all sent frames on each bus. When the budget is exhausted,
+ * frames are held back and lower CAN IDs are sent first.
+ * \param targetLoad: Target bus load in percent of the bitrate (1-100), 0 to disable
+ * \return True if successful, false otherwise.
+ */
+bool CANSimulatorCore::setBusLoadLimit(int targetLoad)
+{
+    bool ret = true;
+    for (auto it = m_buses.begin(); it != m_buses.end(); ++it) {
+        if (!(*it)->admission.configure(targetLoad, targetLoad ? getCANBitrate(**it) : 0, getCANDataBitrate(**it))) {
+            ret = false;
+        }
+    }
+    return ret;
+}
+
 /*!
  * \brief CANSimulatorCore::getRunTime
  * Get run time in seconds
@@ -250,27 +514,103 @@ void CANSimulatorCore::setRunTime(int runTime)
 /*!
  * \brief CANSimulatorCore::setValue
  * Set a value for a key
- * \param key: Variable name
+ * \param key: Variable name, "bus.variable" for added buses
  * \param value: Value for key
  * \return True if successful, false otherwise.
  */
 bool CANSimulatorCore::setValue(std::string key, Value value)
 {
     std::lock_guard<std::mutex> guard(m_inputMutex);
-    return m_config->setValue(key, value);
+    std::string variable;
+    Configuration *config = m_buses[resolveBus(key, variable)]->config;
+    bool ret = config->setValue(variable, value);
+    m_scheduler.notify();
+    return ret;
 }
 
 /*!
  * \brief CANSimulatorCore::setValue
  * Set a value for a key from string
- * \param key: Variable name
+ * \param key: Variable name, "bus.variable" for added buses
  * \param value: Value as a string
  * \return True if successful, false otherwise.
  */
 bool CANSimulatorCore::setValue(std::string key, std::string value)
 {
     std::lock_guard<std::mutex> guard(m_inputMutex);
-    return m_config->setValue(key, value);
+    std::string variable;
+    Configuration *config = m_buses[resolveBus(key, variable)]->config;
+    bool ret = config->setValue(variable, value);
+    m_scheduler.notify();
+    return ret;
+}
+
+/*!
+ * \brief CANSimulatorCore::getSignalHandle
+ * Resolve variable name to a handle for repeated access with getValue and setValue
+ * \param key: Variable name, "bus.variable" for added buses
+ * \return Handle of the variable, invalid if variable is not found
+ */
+SignalHandle CANSimulatorCore::getSignalHandle(const std::string &key)
+{
+    std::string variable;
+    unsigned int bus = resolveBus(key, variable);
+    if (!m_buses[bus]->config) {
+        return SignalHandle();
+    }
+    SignalHandle handle = m_buses[bus]->config->getSignalHandle(variable);
+    handle.m_bus = bus;
+    return handle;
+}
+
+/*!
+ * \brief CANSimulatorCore::getValue
+ * Get the value of a variable
+ * \param handle: Handle of the variable
+ * \return Current value of the variable
+ */
+Value CANSimulatorCore::getValue(const SignalHandle &handle) const
+{
+    if (handle.m_bus >= m_buses.size() || !m_buses[handle.m_bus]->config) {
+        return Value();
+    }
+    return m_buses[handle.m_bus]->config->getValue(handle);
+}
+
+/*!
+ * \brief CANSimulatorCore::setValue
+ * Set a value for a variable
+ * \param handle: Handle of the variable
+ * \param value: Value for the variable
+ * \return True if successful, false otherwise.
+ */
+bool CANSimulatorCore::setValue(const SignalHandle &handle, Value value)
+{
+    if (handle.m_bus >= m_buses.size() || !m_buses[handle.m_bus]->config) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(m_inputMutex);
+    bool ret = m_buses[handle.m_bus]->config->setValue(handle, value);
+    m_scheduler.notify();
+    return ret;
+}
+
+/*!
+ * \brief CANSimulatorCore::setValue
+ * Set a value for a variable from string
+ * \param handle: Handle of the variable
+ * \param value: Value as a string
+ * \return True if successful, false otherwise.
+ */
+bool CANSimulatorCore::setValue(const SignalHandle &handle, const std::string &value)
+{
+    if (handle.m_bus >= m_buses.size() || !m_buses[handle.m_bus]->config) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(m_inputMutex);
+    bool ret = m_buses[handle.m_bus]->config->setValue(handle, value);
+    m_scheduler.notify();
+    return ret;
 }
 
 /*!
@@ -292,7 +632,8 @@ bool CANSimulatorCore::setValues(std::vector<std::string> &input)
         // Parse and set signal values
         std::vector<std::string> values = split(*it, '=');
         if (values.size() == 2) {
-            if (!m_config->setValue(values[0], values[1])) {
+            std::string variable;
+            if (!m_buses[resolveBus(values[0], variable)]->config->setValue(variable, values[1])) {
                 ret = false;
             }
         } else {
@@ -300,17 +641,22 @@ bool CANSimulatorCore::setValues(std::vector<std::string> &input)
             ret = false;
         }
     }
+    m_scheduler.notify();
     return ret;
 }
 
 /*!
  * \brief CANSimulatorCore::setDefaultValues
- * Set all value to defaults
+ * Set all values of all buses to defaults
  * \param sendMessages: boolean to define whether values are send to CAN bus
  */
 void CANSimulatorCore::setDefaultValues(bool sendMessages)
 {
-    m_config->setDefaultValues();
+    for (auto it = m_buses.begin(); it != m_buses.end(); ++it) {
+        if ((*it)->config) {
+            (*it)->config->setDefaultValues();
+        }
+    }
     if (sendMessages) {
         sendCANMessages(true);
     }
@@ -351,23 +697,25 @@ bool CANSimulatorCore::isDataSimulatorRunning() const
 /*!
  * \brief CANSimulatorCore::getSignal
  * Get the signal by variable name
- * \param key: Variable name
+ * \param key: Variable name, "bus.variable" for added buses
  * \return Pointer to signal object, NULL if not found.
  */
 const CANSignal *CANSimulatorCore::getSignal(const std::string &key)
 {
-    return m_config->getSignal(key);
+    std::string variable;
+    return m_buses[resolveBus(key, variable)]->config->getSignal(variable);
 }
 
 /*!
  * \brief CANSimulatorCore::getMessage
  * Get the message by variable name
- * \param key: Variable name
+ * \param key: Variable name, "bus.variable" for added buses
  * \return Pointer to message object, NULL if not found.
  */
 const CANMessage *CANSimulatorCore::getMessage(const std::string &key)
 {
-    return m_config->getMessage(key);
+    std::string variable;
+    return m_buses[resolveBus(key, variable)]->config->getMessage(variable);
 }
 
 /*!
@@ -378,7 +726,7 @@ const CANMessage *CANSimulatorCore::getMessage(const std::string &key)
  */
 const CANMessage *CANSimulatorCore::getMessage(std::uint32_t id)
 {
-    return m_config->getMessage(id);
+    return m_buses[0]->config->getMessage(id);
 }
 
 /*!
@@ -386,9 +734,9 @@ const CANMessage *CANSimulatorCore::getMessage(std::uint32_t id)
  * Get all configured messages
  * \return complete CANMessage map
  */
-const std::map<std::uint32_t, CANMessage> &CANSimulatorCore::getMessages() const
+const std::vector<CANMessage> &CANSimulatorCore::getMessages() const
 {
-    return m_config->getMessages();
+    return m_buses[0]->config->getMessages();
 }
 
 /*!
@@ -398,37 +746,54 @@ const std::map<std::uint32_t, CANMessage> &CANSimulatorCore::getMessages() const
  */
 const std::set<std::string> &CANSimulatorCore::getVariables() const
 {
-    return m_config->getVariables();
+    return m_buses[0]->config->getVariables();
 }
 
 /*!
  * \brief CANSimulatorCore::sendCANMessage
- * \param key: name of the signal
+ * \param key: name of the signal, "bus.variable" for added buses
  * \param forceSend: Send message even if not modified
  * \return True if successful, false otherwise
  */
 bool CANSimulatorCore::sendCANMessage(const std::string &key, bool forceSend)
 {
+    std::string variable;
+    unsigned int bus = resolveBus(key, variable);
     std::uint32_t msgId;
-    if (m_config->getMessageId(key, msgId)) {
-       return sendCANMessage(msgId, forceSend);
+    if (m_buses[bus]->config->getMessageId(variable, msgId)) {
+       return sendCANMessage(bus, m_buses[bus]->config->getMessage(msgId), forceSend);
     }
     return false;
 }
 
 /*!
  * \brief CANSimulatorCore::sendCANMessage
- * \param id: CAN ID of the signal
+ * \param id: CAN ID of the signal on the primary bus
  * \param forceSend: Send message even if not modified
  * \return True if successful, false otherwise
  */
 bool CANSimulatorCore::sendCANMessage(std::uint32_t id, bool forceSend)
 {
-    CANMessage *message = m_config->getMessage(id);
-    if (message) {
-        if (!isMessageFiltered(message->id)) {
+    return sendCANMessage(0, m_buses[0]->config->getMessage(id), forceSend);
+}
+
+/*!
+ * \brief CANSimulatorCore::sendCANMessage
+ * \param bus: Index of the bus sending the message
+ * \param message: CAN message, may be NULL
+ * \param forceSend: Send message even if not modified
+ * \return True if successful, false otherwise
+ */
+bool CANSimulatorCore::sendCANMessage(unsigned int bus, CANMessage *message, bool forceSend)
+{
+    if (message && m_buses[bus]->transceiver) {
+        if (!isMessageFiltered(bus, message->id)) {
             if (forceSend || message->isModified()) {
-                return m_canTransceiver->sendCANMessage(message);
+                if (!admitFrame(*m_buses[bus], message->id, message->getDlc(), message->isCANFD(), message->getBitRateSwitch())) {
+                    LOG(LOG_DBG, "Message %u held back by bus load limit\n", message->id);
+                    return false;
+                }
+                return m_buses[bus]->transceiver->sendCANMessage(message);
             }
         }
     }
@@ -437,68 +802,224 @@ bool CANSimulatorCore::sendCANMessage(std::uint32_t id, bool forceSend)
 
 /*!
  * \brief CANSimulatorCore::sendCANMessages
- * Send all modified CAN messages
+ * Send all modified CAN messages of all buses
  * \param sendAll: Send messages even if not modified
  * \return True if all modifien message were sent successfully, false otherwise
  */
 bool CANSimulatorCore::sendCANMessages(bool sendAll)
 {
     bool ret = true;
-    std::set<std::uint32_t> sendIDs = m_config->getSendIDs();
-    for (std::set<std::uint32_t>::iterator it = sendIDs.begin(); it != sendIDs.end(); ++it) {
-        if (!sendCANMessage(*it, sendAll)) {
+    for (unsigned int bus = 0; bus < m_buses.size(); ++bus) {
+        Configuration *config = m_buses[bus]->config;
+        CANTransceiver *transceiver = m_buses[bus]->transceiver;
+        if (!config || !transceiver) {
+            continue;
+        }
+        CANFrameBatch batch;
+        std::set<std::uint32_t> sendIDs = config->getSendIDs();
+        for (std::set<std::uint32_t>::iterator it = sendIDs.begin(); it != sendIDs.end(); ++it) {
+            CANMessage *message = config->getMessage(*it);
+            if (!message || !queueCANMessage(bus, message, sendAll, batch)) {
+                ret = false;
+            }
+        }
+        if (!batch.empty() && transceiver->sendCANBatch(batch) != batch.size()) {
             ret = false;
         }
     }
     return ret;
 }
 
+/*!
+ * \brief CANSimulatorCore::queueCANMessage
+ * Queue CAN message for sending with the next flushCANMessages call
+ * \param key: Variable name of a signal of the message, "bus.variable" for added buses
+ * \param forceSend: Queue message even if not modified
+ * \return True if queued, false otherwise
+ */
+bool CANSimulatorCore::queueCANMessage(const std::string &key, bool forceSend)
+{
+    std::string variable;
+    unsigned int bus = resolveBus(key, variable);
+    std::uint32_t msgId;
+    if (m_buses[bus]->config->getMessageId(variable, msgId)) {
+        if (CANMessage *message = m_buses[bus]->config->getMessage(msgId)) {
+            std::lock_guard<std::mutex> guard(m_sendBatchMutex);
+            return queueCANMessage(bus, message, forceSend, m_buses[bus]->sendBatch);
+        }
+    }
+    return false;
+}
+
+/*!
+ * \brief CANSimulatorCore::flushCANMessages
+ * Send CAN messages queued with queueCANMessage in a single batch per bus
+ * \return Number of messages sent
+ */
+std::size_t CANSimulatorCore::flushCANMessages()
+{
+    std::lock_guard<std::mutex> guard(m_sendBatchMutex);
+    std::size_t sent = 0;
+    for (auto it = m_buses.begin(); it != m_buses.end(); ++it) {
+        if (!(*it)->sendBatch.empty() && (*it)->transceiver) {
+            sent += (*it)->transceiver->sendCANBatch((*it)->sendBatch);
+        }
+    }
+    return sent;
+}
+
+/*!
+ * \brief CANSimulatorCore::queueCANMessage
+ * Assemble CAN message to a batch of frames if it may be sent
+ * \param bus: Index of the bus sending the message
+ * \param message: CAN message
+ * \param forceSend: Queue message even if not modified
+ * \param batch: Batch of frames
+ * \return True if queued, false if filtered, not modified or held back by bus load limit
+ */
+bool CANSimulatorCore::queueCANMessage(unsigned int bus, CANMessage *message, bool forceSend, CANFrameBatch &batch)
+{
+    if (isMessageFiltered(bus, message->id) || !(forceSend || message->isModified())) {
+        return false;
+    }
+    if (!admitFrame(*m_buses[bus], message->id, message->getDlc(), message->isCANFD(), message->getBitRateSwitch())) {
+        LOG(LOG_DBG, "Message %u held back by bus load limit\n", message->id);
+        return false;
+    }
+    canfd_frame frame;
+    message->assembleCANFrame(&frame);
+    batch.add(frame, message);
+    return true;
+}
+
+/*!
+ * \brief CANSimulatorCore::admitFrame
+ * Check bus load limit before sending a frame
+ * \param bus: Bus sending the frame
+ * \param id: CAN ID of the frame
+ * \param length: Payload length in bytes
+ * \param canfd: True if CAN FD frame
+ * \param bitRateSwitch: True if CAN FD frame uses data bitrate
+ * \return True if frame may be sent, false otherwise.
+ */
+bool CANSimulatorCore::admitFrame(canBus &bus, std::uint32_t id, std::size_t length, bool canfd, bool bitRateSwitch)
+{
+    if (!bus.admission.isEnabled()) {
+        return true;
+    }
+    return bus.admission.admit(id, canFrameBitCount(id & CAN_EFF_FLAG, length, canfd, bitRateSwitch), m_clock->now());
+}
+
+/*!
+ * \brief CANSimulatorCore::readCANMessages
+ * Read all available incoming CAN frames of a bus, queue snapshots of messages
+ * whose content changed and route their signals
+ * \param bus: Index of the bus
+ * \param sampled: Read frames dropped by kernel filters from the sampling socket
+ * \return Number of frames read from the socket, including incomplete frames
+ */
+std::size_t CANSimulatorCore::readCANMessages(unsigned int bus, bool sampled)
+{
+    receivedCANFrame frames[CAN_RECEIVE_BATCH_SIZE];
+    std::size_t received;
+    std::size_t count = m_buses[bus]->transceiver->readCANFrames(frames, CAN_RECEIVE_BATCH_SIZE, sampled, &received);
+    for (std::size_t index = 0; index < count; ++index) {
+        std::uint32_t id;
+        if ((id = readCANMessage(bus, frames[index].frame, frames[index].canfd))) {
+            MessageSnapshot *snapshot = m_snapshotPool.acquire();
+            m_buses[bus]->config->getMessage(id)->takeSnapshot(*snapshot, frames[index].timestamp);
+            m_messageQueue.push(snapshot);
+            routeSignals(bus, id);
+            LOG(LOG_DBG, "Incoming message read successfully\n");
+        } else {
+            LOG(LOG_DBG, "Incoming message read failed\n");
+        }
+    }
+    return received;
+}
+
 /*!
  * \brief CANSimulatorCore::readCANMessage
- * Read the data from incoming CAN message and set values to variables
+ * Read the data from incoming CAN frame and set values to variables
+ * \param bus: Index of the bus receiving the frame
+ * \param frame: Received CAN (FD) frame
+ * \param canfd: True if frame was received as CAN FD frame
  * \return Message CAN ID if message was read and its content was changed, otherwise 0
  */
-std::uint32_t CANSimulatorCore::readCANMessage()
+std::uint32_t CANSimulatorCore::readCANMessage(unsigned int bus, canfd_frame &frame, bool canfd)
 {
-    canfd_frame frame;
-    bool canfd;
-    if (m_canTransceiver->readCANFrame(&frame, &canfd)) {
-        if ((frame.can_id & CAN_ERR_FLAG) == CAN_ERR_FLAG) {
-            LOG(LOG_ERR, analyzeErrorFrame(&frame));
-            m_errorMetrics.errorMessages++;
-            m_errorMetrics.errorSize += FRAME_SIZE + frame.len + ((frame.can_id & CAN_EFF_FLAG) ? CAN_EFF_ID_BITS : CAN_SFF_ID_BITS);
-            return 0;
-        } else if (!isMessageFiltered(frame.can_id)) {
-            if (m_config->getReceiveIDs().count(frame.can_id)) {
-                if (CANMessage *message = m_config->getMessage(frame.can_id)) {
-                    message->updateTransfer(true, MessageDirection::RECEIVE);
-                    if (message->parseCANFrame(&frame, canfd)) {
-                        return frame.can_id;
-                    }
-                    return 0;
-                }
-            } else if (m_config->getSendIDs().count(frame.can_id)) {
-                if (CANMessage *message = m_config->getMessage(frame.can_id)) {
-                    message->updateTransfer(true, MessageDirection::RECEIVE);
-                    return 0;
-                }
+    if ((frame.can_id & CAN_ERR_FLAG) == CAN_ERR_FLAG) {
+        LOG(LOG_ERR, analyzeErrorFrame(&frame));
+        m_errorMetrics.errorMessages++;
+        m_errorMetrics.errorSize += canFrameBitCount(frame.can_id & CAN_EFF_FLAG, frame.len, false, false).nominal;
+        return 0;
+    } else if (!isMessageFiltered(bus, frame.can_id)) {
+        bool send;
+        bool receive;
+        if (CANMessage *message = m_buses[bus]->config->findMessage(frame.can_id, send, receive)) {
+            message->updateTransfer(true, MessageDirection::RECEIVE);
+            if (receive && message->parseCANFrame(&frame, canfd)) {
+                return frame.can_id;
             }
+            return 0;
         }
-        m_errorMetrics.unknownMessages++;
-        m_errorMetrics.unknownSize += FRAME_SIZE + frame.len + ((frame.can_id & CAN_EFF_FLAG) ? CAN_EFF_ID_BITS : CAN_SFF_ID_BITS);
     }
+    m_errorMetrics.unknownMessages++;
+    canFrameBits bits = canFrameBitCount(frame.can_id & CAN_EFF_FLAG, frame.len, canfd, frame.flags & CANFD_BRS);
+    m_errorMetrics.unknownSize += bits.nominal;
+    m_errorMetrics.unknownDataSize += bits.data;
     return 0;
 }
 
 /*!
  * \brief CANSimulatorCore::getCANBitrate
- * Read CAN bus bitrate from the bus
+ * Read CAN bus bitrate of the primary bus from the bus
  * \return CAN bitrate, or 0 in case of an error
  */
 int CANSimulatorCore::getCANBitrate()
 {
-    if (m_canTransceiver) {
-        return m_canTransceiver->getCANBitrate();
+    return getCANBitrate(*m_buses[0]);
+}
+
+/*!
+ * \brief CANSimulatorCore::getCANDataBitrate
+ * Get CAN FD data bitrate of the primary bus from dbc file
+ * \return CAN FD data bitrate, or 0 if not defined
+ */
+int CANSimulatorCore::getCANDataBitrate()
+{
+    return getCANDataBitrate(*m_buses[0]);
+}
+
+/*!
+ * \brief CANSimulatorCore::getCANBitrate
+ * Read CAN bus bitrate from the bus
+ * \param bus: Bus
+ * \return CAN bitrate, or 0 in case of an error
+ */
+int CANSimulatorCore::getCANBitrate(const canBus &bus)
+{
+    if (bus.transceiver) {
+        return bus.transceiver->getCANBitrate();
+    }
+    return 0;
+}
+
+/*!
+ * \brief CANSimulatorCore::getCANDataBitrate
+ * Get CAN FD data bitrate from dbc file of the bus
+ * \param bus: Bus
+ * \return CAN FD data bitrate, or 0 if not defined
+ */
+int CANSimulatorCore::getCANDataBitrate(const canBus &bus)
+{
+    if (bus.config && bus.config->getAttribute("BaudrateCANFD")) {
+        try {
+            return std::stoi(bus.config->getAttribute("BaudrateCANFD")->getValue());
+        }
+        catch (const std::logic_error &) {
+            LOG(LOG_WARN, "warning=2 Invalid dbc BaudrateCANFD: %s\n", bus.config->getAttribute("BaudrateCANFD")->getValue().c_str());
+        }
     }
     return 0;
 }
@@ -528,148 +1049,525 @@ void CANSimulatorCore::startCANSenderThread()
 void CANSimulatorCore::stopCANThreads()
 {
     m_threadsRunning = false;
+    m_scheduler.notify();
+    m_receiveReactor.stop();
+    m_sendReactor.stop();
+}
+
+/*!
+ * \brief CANSimulatorCore::getReaderThreadConfig
+ * Get CPU and scheduling of the reader thread
+ * \return Thread configuration
+ */
+const threadConfig &CANSimulatorCore::getReaderThreadConfig() const
+{
+    return m_readerThreadConfig;
+}
+
+/*!
+ * \brief CANSimulatorCore::setReaderThreadConfig
+ * Set CPU and scheduling of the reader thread, applied when the thread starts
+ * \param config: Thread configuration
+ * \return True if successful, false if the CPU does not exist or the priority is invalid.
+ */
+bool CANSimulatorCore::setReaderThreadConfig(const threadConfig &config)
+{
+    if (!isValidThreadConfig(config)) {
+        LOG(LOG_WARN, "warning=4 Invalid reader thread configuration\n");
+        return false;
+    }
+    m_readerThreadConfig = config;
+    return true;
+}
+
+/*!
+ * \brief CANSimulatorCore::getSenderThreadConfig
+ * Get CPU and scheduling of the sender thread
+ * \return Thread configuration
+ */
+const threadConfig &CANSimulatorCore::getSenderThreadConfig() const
+{
+    return m_senderThreadConfig;
+}
+
+/*!
+ * \brief CANSimulatorCore::setSenderThreadConfig
+ * Set CPU and scheduling of the sender thread, also used by data simulation, applied when the thread starts
+ * \param config: Thread configuration
+ * \return True if successful, false if the CPU does not exist or the priority is invalid.
+ */
+bool CANSimulatorCore::setSenderThreadConfig(const threadConfig &config)
+{
+    if (!isValidThreadConfig(config)) {
+        LOG(LOG_WARN, "warning=4 Invalid sender thread configuration\n");
+        return false;
+    }
+    m_senderThreadConfig = config;
+    return true;
+}
+
+/*!
+ * \brief CANSimulatorCore::lockMemory
+ * Lock process memory to avoid page faults in the CAN threads, their stacks are prefaulted when they start
+ * \return True if successful, false otherwise.
+ */
+bool CANSimulatorCore::lockMemory()
+{
+    m_memoryLocked = lockProcessMemory();
+    return m_memoryLocked;
 }
 
 /*!
  * \brief CANSimulatorCore::CANReaderThread
- * Read incoming messages from CAN bus.
+ * Read incoming messages from the CAN buses.
  */
 void CANSimulatorCore::CANReaderThread()
 {
-    fd_set input_set;
-    while (m_threadsRunning) {
-        // Empty the FD set
-        FD_ZERO(&input_set);
-        int canSocket = m_canTransceiver->getCANSocket();
-        if (canSocket >= 0) {
-            FD_SET(canSocket, &input_set);
-        }
-        // Wait 10 milliseconds for incoming CAN messages
-        struct timeval timeout;
-        timeout.tv_sec = 0;
-        timeout.tv_usec = 10000;
-
-        if (select(canSocket+1, &input_set, NULL, NULL, &timeout) > 0) {
-            // Check for data from CAN bus
-            if (FD_ISSET(canSocket, &input_set)) {
-                std::uint32_t id;
-                if ((id = readCANMessage())) {
-                    CANMessage *msg = m_config->getMessage(id);
-                    CANMessage *newMsg = new CANMessage(*msg);
-                    std::shared_ptr<CANMessage> msgCopy(newMsg);
-                    m_messageQueue.push(msgCopy);
-                    msg->setModified(false);
-                    LOG(LOG_DBG, "Incoming message read successfully\n");
-                } else {
-                    LOG(LOG_DBG, "Incoming message read failed\n");
-                }
+    applyThreadConfig(m_readerThreadConfig, m_memoryLocked);
+    std::vector<int> canSockets;
+    for (unsigned int bus = 0; bus < m_buses.size(); ++bus) {
+        if (!m_buses[bus]->transceiver) {
+            continue;
+        }
+        int canSocket = m_buses[bus]->transceiver->getCANSocket();
+        if (canSocket < 0) {
+            LOG(LOG_ERR, "CAN socket not ready\n");
+            continue;
+        }
+        // Edge triggered, read until the socket has been drained, a batch smaller than the maximum drains it
+        if (m_receiveReactor.add(canSocket, EPOLLIN, [this, bus](std::uint32_t) {
+            while (readCANMessages(bus) == CAN_RECEIVE_BATCH_SIZE) {
+            }
+        })) {
+            canSockets.push_back(canSocket);
+        }
+        // Frames dropped by kernel filters are only accounted
+        int samplingSocket = m_buses[bus]->transceiver->getSamplingSocket();
+        if (samplingSocket >= 0 && m_receiveReactor.add(samplingSocket, EPOLLIN, [this, bus](std::uint32_t) {
+            while (readCANMessages(bus, true) == CAN_RECEIVE_BATCH_SIZE) {
             }
+        })) {
+            canSockets.push_back(samplingSocket);
         }
     }
+    if (m_threadsRunning && !canSockets.empty()) {
+        m_receiveReactor.run();
+    }
+    for (auto it = canSockets.begin(); it != canSockets.end(); ++it) {
+        m_receiveReactor.remove(*it);
+    }
 }
 
 /*!
  * \brief CANSimulatorCore::CANSenderThread
- * Send outgoing messages to CAN bus.
+ * Send outgoing messages to the CAN buses.
  */
 void CANSimulatorCore::CANSenderThread()
 {
-    std::map<std::uint64_t, canFrameQueueItem> queue;
-    std::map<std::uint64_t, canFrameQueueItem>::iterator it;
-    std::set<std::uint32_t> sendIDs;
-    std::chrono::time_point<std::chrono::system_clock> loopCounter = std::chrono::high_resolution_clock::now();
-    std::chrono::time_point<std::chrono::system_clock> timeSendCounter = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<int,std::milli> loopTime(std::chrono::duration<int,std::milli>(10));
-    std::chrono::duration<int,std::milli> timeSendInterval(std::chrono::duration<int,std::milli>(100));
+    applyThreadConfig(m_senderThreadConfig, m_memoryLocked);
     if (m_simulationRunning) {
-        m_simulationTime = 0;
-        queue = m_ascReader->getFrameQueue();
-        it = queue.begin();
-    } else {
-        sendIDs = m_config->getSendIDs();
+        CANSimulationLoop();
+        return;
     }
-    while (m_threadsRunning || m_simulationRunning) {
-        std::chrono::time_point<std::chrono::system_clock> now = std::chrono::high_resolution_clock::now();
-        int canSocket = m_canTransceiver->getCANSocket();
-        if (canSocket < 0) {
-            LOG(LOG_ERR, "CAN socket not ready\n");
-            continue;
-        }
-        if (m_simulationRunning) {
-            while (it != queue.end() && it->second.timestamp <= m_simulationTime) {
-                if (it->second.in) {
-                    if (!isMessageFiltered(it->second.frame.can_id)) {
-                        m_canTransceiver->sendCANFrame(&it->second.frame);
+
+    const std::uint64_t interval = (std::uint64_t)m_interval * 1000000ULL;
+    std::uint64_t nextTimeUpdate = m_clock->now();
+    {
+        std::lock_guard<std::mutex> guard(m_inputMutex);
+        m_scheduler.clear();
+        for (unsigned int bus = 0; bus < m_buses.size(); ++bus) {
+            Configuration *config = m_buses[bus]->config;
+            m_buses[bus]->onChangeIDs.clear();
+            if (!config) {
+                continue;
+            }
+            std::set<std::uint32_t> sendIDs = config->getSendIDs();
+            std::vector<SendPhase> phases;
+            std::vector<SendEvent> events;
+            int bitrate = getCANBitrate(*m_buses[bus]);
+            int dataBitrate = getCANDataBitrate(*m_buses[bus]);
+            for (std::set<std::uint32_t>::iterator it = sendIDs.begin(); it != sendIDs.end(); ++it) {
+                if (CANMessage *msg = config->getMessage(*it)) {
+                    canFrameBits bits = canFrameBitCount(msg->getId() & CAN_EFF_FLAG, msg->getDlc(),
+                                                         msg->isCANFD(), msg->getBitRateSwitch());
+                    SendPhase phase;
+                    phase.id = *it;
+                    phase.bits = canFrameNominalBits(bits, bitrate, dataBitrate);
+                    phase.offset = msg->getSendOffset();
+                    if (msg->isCyclic()) {
+                        phase.cycleTime = msg->getCycleTime() > 0 ? msg->getCycleTime() : m_interval;
+                        phases.push_back(phase);
+                        events.push_back(SendEvent::CYCLIC);
+                        m_buses[bus]->periods[*it].lastSend = 0;
                     }
+                    if (msg->isIfActive()) {
+                        phase.cycleTime = msg->getCycleTimeFast();
+                        phases.push_back(phase);
+                        events.push_back(SendEvent::IF_ACTIVE);
+                    }
+                    if (msg->isOnChange()) {
+                        m_buses[bus]->onChangeIDs.push_back(*it);
+                    }
+                    msg->m_lastSendTime = 0;
+                    msg->m_repetitionsLeft = 0;
+                    msg->m_sendDelayed = false;
                 }
-                ++it;
             }
-            m_simulationTime += m_interval;
-
-            if (it == queue.end() || (m_runTime > 0 && m_simulationTime > (unsigned int)m_runTime * 1000)) {
-                m_simulationRunning = false;
+            // Spread first cyclic sends over the cycle to avoid bursts, each bus has its own load
+            assignPhaseOffsets(phases);
+            for (std::size_t index = 0; index < phases.size(); ++index) {
+                m_scheduler.schedule(phases[index].id, nextTimeUpdate + (std::uint64_t)phases[index].offset * 1000000ULL,
+                                     events[index], bus);
             }
-        } else {
+        }
+    }
+    // Send frames queued by the sender thread
+    auto flushBatches = [&]() {
+        for (auto it = m_buses.begin(); it != m_buses.end(); ++it) {
+            flushSenderBatch(**it);
+        }
+    };
+    // Send due messages of all buses and return the time of the next wakeup
+    auto sendDue = [&]() -> std::uint64_t {
+        std::uint64_t now = m_clock->now();
+        std::uint64_t retry = ADMISSION_NEVER;
+        for (auto it = m_buses.begin(); it != m_buses.end(); ++it) {
+            if ((*it)->transceiver && (*it)->transceiver->getCANSocket() < 0) {
+                LOG(LOG_ERR, "CAN socket not ready\n");
+                return now + interval;
+            }
+        }
+        {
             std::lock_guard<std::mutex> guard(m_inputMutex);
             // Set current time to signal values if needed
-            updateTime(timeSendCounter, now, timeSendInterval);
-            // Check all messages
-            for (std::set<std::uint32_t>::iterator it = sendIDs.begin(); it != sendIDs.end(); ++it) {
-                CANMessage *msg = m_config->getMessage(*it);
-                if (msg) {
-                    if (!isMessageFiltered(msg->id)) {
-                        bool force = false;
-                        bool send = false;
-                        if (msg->isSendScheduled(now)) {
-                            send = true;
-                            force = true;
-                        }
-                        if (send && sendCANMessage(*it, force)) {
-                            LOG(LOG_DBG, "Sent message %u\n", *it);
-                        }
+            updateTime(nextTimeUpdate, now);
+            // Send due messages and schedule their next deadline
+            std::uint32_t id;
+            std::uint64_t deadline;
+            SendEvent event;
+            unsigned int bus;
+            while (m_scheduler.popDue(now, id, deadline, event, bus)) {
+                m_schedulingLateness.record(now - deadline);
+                CANMessage *msg = m_buses[bus]->config->getMessage(id);
+                AdmissionController &admission = m_buses[bus]->admission;
+                std::uint64_t cycleTime = msg->getCycleTimeFast() > 0 ? (std::uint64_t)msg->getCycleTimeFast() * 1000000ULL : interval;
+                bool sent = true;
+                switch (event) {
+                case SendEvent::CYCLIC:
+                    // Messages with only cyclic signals use the simulator interval
+                    cycleTime = msg->getCycleTime() > 0 ? (std::uint64_t)msg->getCycleTime() * 1000000ULL : interval;
+                    // Period of a queued send is recorded when its frame is written
+                    sent = sendScheduledMessage(bus, msg, now, cycleTime);
+                    if (!sent) {
+                        recordPeriod(m_buses[bus]->periods[id], false, now, cycleTime);
+                    }
+                    break;
+                case SendEvent::IF_ACTIVE:
+                    if (msg->isActive()) {
+                        sent = sendScheduledMessage(bus, msg, now);
+                    }
+                    break;
+                case SendEvent::REPETITION:
+                    if (msg->m_repetitionsLeft > 0) {
+                        sent = sendScheduledMessage(bus, msg, now);
+                        --msg->m_repetitionsLeft;
                     }
+                    break;
+                case SendEvent::DELAYED:
+                    msg->m_sendDelayed = false;
+                    if (msg->isChangeScheduled()) {
+                        sendChangedMessage(bus, msg, now, interval);
+                    }
+                    continue;
+                case SendEvent::RETRY:
+                    sent = sendScheduledMessage(bus, msg, now);
+                    break;
+                }
+                // Send held back by bus load limit once the budget allows, keeping the cycle phase
+                if (!sent && admission.isReserved(id)) {
+                    m_scheduler.schedule(id, admission.getRetryTime(), SendEvent::RETRY, bus);
+                }
+                if (event == SendEvent::RETRY || (event == SendEvent::REPETITION && msg->m_repetitionsLeft <= 0)) {
+                    continue;
                 }
+                deadline += cycleTime;
+                // Prevent bursts of sends after long delays
+                if (deadline < now) {
+                    deadline = now + cycleTime;
+                }
+                m_scheduler.schedule(id, deadline, event, bus);
+            }
+            flushBatches();
+            // Send messages whose content changed
+            for (bus = 0; bus < m_buses.size(); ++bus) {
+                canBus &current = *m_buses[bus];
+                for (auto it = current.onChangeIDs.begin(); it != current.onChangeIDs.end(); ++it) {
+                    CANMessage *msg = current.config->getMessage(*it);
+                    if (msg->isChangeScheduled() && !sendChangedMessage(bus, msg, now, interval) &&
+                        current.admission.isEnabled() && !isMessageFiltered(bus, *it)) {
+                        // Changed messages held back by bus load limit are retried when the budget allows
+                        retry = std::min<std::uint64_t>(retry, std::min<std::uint64_t>(current.admission.getRetryTime(),
+                                                                                       now + ADMISSION_RESERVATION_HOLD));
+                    }
+                }
+            }
+            flushBatches();
+        }
+        m_loopDuration.record(m_clock->now() - now);
+        std::uint64_t deadline = m_scheduler.nextDeadline();
+        if (m_sendTime && nextTimeUpdate < deadline) {
+            deadline = nextTimeUpdate;
+        }
+        if (retry != ADMISSION_NEVER) {
+            deadline = std::min(deadline, std::max<std::uint64_t>(retry, now + ADMISSION_RETRY_INTERVAL));
+        }
+        return deadline;
+    };
+
+    if (m_clock->isVirtual()) {
+        // Jump to each deadline at once, wait only when nothing is scheduled
+        while (m_threadsRunning) {
+            std::uint64_t deadline = sendDue();
+            if (deadline == SEND_SCHEDULER_NEVER) {
+                m_scheduler.wait(SEND_SCHEDULER_NEVER);
+            } else {
+                m_clock->sleepUntil(deadline);
             }
         }
+        return;
+    }
+    if (m_scheduler.getTimerFd() < 0 || m_scheduler.getEventFd() < 0) {
+        while (m_threadsRunning) {
+            m_scheduler.wait(sendDue());
+        }
+        return;
+    }
+    // Scheduler timer and notifications wake up the sender, stopCANThreads notifies too
+    Reactor::Handler handler = [&](std::uint32_t) {
+        m_scheduler.acknowledge();
+        if (!m_threadsRunning) {
+            m_sendReactor.stop();
+            return;
+        }
+        m_scheduler.arm(sendDue());
+    };
+    if (!m_sendReactor.add(m_scheduler.getTimerFd(), EPOLLIN, handler) ||
+        !m_sendReactor.add(m_scheduler.getEventFd(), EPOLLIN, handler)) {
+        return;
+    }
+    if (m_threadsRunning) {
+        m_scheduler.arm(sendDue());
+        m_sendReactor.run();
+    }
+    m_sendReactor.remove(m_scheduler.getTimerFd());
+    m_sendReactor.remove(m_scheduler.getEventFd());
+}
+
+/*!
+ * \brief CANSimulatorCore::sendChangedMessage
+ * Send message whose content changed. Sends closer than GenMsgDelayTime to the previous
+ * send are postponed, and sends of messages with repetition are followed by
+ * GenMsgNrOfRepetition repetitions at GenMsgCycleTimeFast.
+ * \param bus: Index of the bus sending the message
+ * \param msg: Changed CAN message
+ * \param now: Current scheduler time
+ * \param interval: Simulator interval in nanoseconds, used if fast cycle time is not defined
+ * \return True if message was sent or postponed, false if sending failed.
+ */
+bool CANSimulatorCore::sendChangedMessage(unsigned int bus, CANMessage *msg, std::uint64_t now, std::uint64_t interval)
+{
+    if (msg->m_sendDelayed) {
+        // Already postponed, latest content is sent when the delay expires
+        return true;
+    }
+    std::uint64_t delay = (std::uint64_t)msg->getDelayTime() * 1000000ULL;
+    if (delay && msg->m_lastSendTime && now < msg->m_lastSendTime + delay) {
+        msg->m_sendDelayed = true;
+        m_scheduler.schedule(msg->getId(), msg->m_lastSendTime + delay, SendEvent::DELAYED, bus);
+        return true;
+    }
+    bool repeat = msg->isRepetitionScheduled();
+    if (!sendScheduledMessage(bus, msg, now)) {
+        return false;
+    }
+    if (!repeat) {
+        return true;
+    }
+    // Further changes during repetitions restart the count of the running repetitions
+    if (msg->m_repetitionsLeft <= 0) {
+        std::uint64_t cycleTime = msg->getCycleTimeFast() > 0 ? (std::uint64_t)msg->getCycleTimeFast() * 1000000ULL : interval;
+        m_scheduler.schedule(msg->getId(), now + cycleTime, SendEvent::REPETITION, bus);
+    }
+    msg->m_repetitionsLeft = msg->getRepetitions();
+    return true;
+}
+
+/*!
+ * \brief CANSimulatorCore::sendScheduledMessage
+ * Queue message from the sender thread unless it is filtered, queued
+ * messages are sent when the sender thread flushes its batch
+ * \param bus: Index of the bus sending the message
+ * \param msg: CAN message
+ * \param now: Current scheduler time, stored as time of the last send
+ * \param cycleTime: Cycle time of a cyclic send in nanoseconds, 0 for other sends
+ * \return True if message was queued, false otherwise.
+ */
+bool CANSimulatorCore::sendScheduledMessage(unsigned int bus, CANMessage *msg, std::uint64_t now, std::uint64_t cycleTime)
+{
+    canBus &current = *m_buses[bus];
+    std::size_t frame = current.senderBatch.size();
+    if (!queueCANMessage(bus, msg, true, current.senderBatch)) {
+        return false;
+    }
+    // Later sends of this round see the queued send, it is rolled back if the frame is not written
+    current.pendingSends.push_back({msg, frame, now, msg->m_lastSendTime, cycleTime});
+    msg->m_lastSendTime = now;
+    return true;
+}
+
+/*!
+ * \brief CANSimulatorCore::flushSenderBatch
+ * Send frames queued by the sender thread and record the sends of written frames.
+ * Buses without CAN interface drop the frames as if they were written.
+ * \param bus: Bus of the batch
+ */
+void CANSimulatorCore::flushSenderBatch(canBus &bus)
+{
+    if (bus.senderBatch.empty()) {
+        return;
+    }
+    std::vector<bool> written;
+    if (bus.transceiver) {
+        bus.transceiver->sendCANBatch(bus.senderBatch, &written);
+    } else {
+        written.assign(bus.senderBatch.size(), true);
+        bus.senderBatch.clear();
+    }
+    // Restore send times from before the batch, then set the times of written frames
+    for (auto it = bus.pendingSends.rbegin(); it != bus.pendingSends.rend(); ++it) {
+        it->message->m_lastSendTime = it->previousSendTime;
+    }
+    for (auto it = bus.pendingSends.begin(); it != bus.pendingSends.end(); ++it) {
+        bool sent = it->frame < written.size() && written[it->frame];
+        if (sent) {
+            it->message->m_lastSendTime = it->time;
+        }
+        if (it->cycleTime) {
+            recordPeriod(bus.periods[it->message->getId()], sent, it->time, it->cycleTime);
+        }
+    }
+    bus.pendingSends.clear();
+}
+
+/*!
+ * \brief CANSimulatorCore::recordPeriod
+ * Count deviation of a cyclic send from the cycle time
+ * \param period: Period metrics of the message
+ * \param sent: True if message was sent, a held back send starts a new measurement
+ * \param now: Current scheduler time
+ * \param cycleTime: Cycle time in nanoseconds
+ */
+void CANSimulatorCore::recordPeriod(periodMetrics &period, bool sent, std::uint64_t now, std::uint64_t cycleTime)
+{
+    if (sent && period.lastSend) {
+        std::uint64_t elapsed = now - period.lastSend;
+        period.error.record(elapsed > cycleTime ? elapsed - cycleTime : cycleTime - elapsed);
+    }
+    period.lastSend = sent ? now : 0;
+}
+
+/*!
+ * \brief CANSimulatorCore::CANSimulationLoop
+ * Send frames of the ASC file at simulation interval on the primary bus
+ */
+void CANSimulatorCore::CANSimulationLoop()
+{
+    canFrameQueueItem next;
+    std::uint64_t loopCounter = m_clock->now();
+    const std::uint64_t loopTime = 10000000ULL;
+    m_simulationTime = 0;
+    // Frames are parsed ahead on a producer thread while replaying
+    m_ascReader->startStreaming();
+    bool pending = m_ascReader->readFrame(next);
+    canBus &bus = *m_buses[0];
+    while (m_simulationRunning) {
+        std::uint64_t now = m_clock->now();
+        if (now > loopCounter) {
+            m_schedulingLateness.record(now - loopCounter);
+        }
+        int canSocket = bus.transceiver->getCANSocket();
+        if (canSocket < 0) {
+            LOG(LOG_ERR, "CAN socket not ready\n");
+            continue;
+        }
+        while (pending && next.timestamp <= m_simulationTime) {
+            if (next.in) {
+                const canfd_frame &frame = next.frame;
+                if (!isMessageFiltered(frame.can_id)) {
+                    if (!admitFrame(bus, frame.can_id, frame.len, isCANFDFrame(&frame), frame.flags & CANFD_BRS)) {
+                        // Held back by bus load limit, continue from this frame on next round
+                        break;
+                    }
+                    bus.senderBatch.add(frame);
+                }
+            }
+            pending = m_ascReader->readFrame(next);
+        }
+        if (!bus.senderBatch.empty()) {
+            bus.transceiver->sendCANBatch(bus.senderBatch);
+        }
+        m_loopDuration.record(m_clock->now() - now);
+        m_simulationTime += m_interval;
+
+        if (!pending || (m_runTime > 0 && m_simulationTime > (unsigned int)m_runTime * 1000)) {
+            m_simulationRunning = false;
+        }
         // Wait in loop for 10 milliseconds
         loopCounter += loopTime;
         // Prevent fast looping in case of long delays in loop
         if (loopCounter < now) {
             loopCounter = now + loopTime;
         }
-        std::this_thread::sleep_until(loopCounter);
+        m_clock->sleepUntil(loopCounter);
     }
+    m_ascReader->stopStreaming();
 }
 
 /*!
  * \brief CANSimulatorCore::updateTime
- * Update time signal values if needed
+ * Set current time to time signals of all buses at 100 millisecond intervals
+ * \param nextUpdate: Scheduler time of the next update, advanced when updated
+ * \param now: Current scheduler time
  */
-void CANSimulatorCore::updateTime(std::chrono::time_point<std::chrono::system_clock> &timeSendCounter,
-                                  std::chrono::time_point<std::chrono::system_clock> &now,
-                                  std::chrono::duration<int,std::milli> &timeSendInterval)
+void CANSimulatorCore::updateTime(std::uint64_t &nextUpdate, std::uint64_t now)
 {
+    const std::uint64_t timeSendInterval = 100000000ULL;
     if (m_sendTime) {
-        if (timeSendCounter <= now) {
-            time_t rawtime;
+        if (nextUpdate <= now) {
+            time_t rawtime = m_clock->wallTime() / 1000000000ULL;
             struct tm ptm;
-            time(&rawtime);
             if (m_useUTCTime) {
                 gmtime_r(&rawtime, &ptm);
             } else {
                 localtime_r(&rawtime, &ptm);
             }
-            m_config->setValue("year", std::to_string(1900+ptm.tm_year));
-            m_config->setValue("month", std::to_string(ptm.tm_mon+1));
-            m_config->setValue("day", std::to_string(ptm.tm_mday));
-            m_config->setValue("hour", std::to_string(ptm.tm_hour));
-            m_config->setValue("min", std::to_string(ptm.tm_min));
-            if (m_config->isVariableSupported("sec")) {
-                m_config->setValue("sec", std::to_string(ptm.tm_sec));
+            for (auto it = m_buses.begin(); it != m_buses.end(); ++it) {
+                Configuration *config = (*it)->config;
+                if (!isTimeSupported(config)) {
+                    continue;
+                }
+                config->setValue("year", std::to_string(1900+ptm.tm_year));
+                config->setValue("month", std::to_string(ptm.tm_mon+1));
+                config->setValue("day", std::to_string(ptm.tm_mday));
+                config->setValue("hour", std::to_string(ptm.tm_hour));
+                config->setValue("min", std::to_string(ptm.tm_min));
+                if (config->isVariableSupported("sec")) {
+                    config->setValue("sec", std::to_string(ptm.tm_sec));
+                }
             }
-            timeSendCounter += timeSendInterval;
-            if (timeSendCounter < now) {
-                timeSendCounter = now + timeSendInterval;
+            nextUpdate += timeSendInterval;
+            if (nextUpdate < now) {
+                nextUpdate = now + timeSendInterval;
             }
         }
     }
@@ -680,11 +1578,32 @@ void CANSimulatorCore::updateTime(std::chrono::time_point<std::chrono::system_cl
  * Get pointer to incoming message queue
  * \return Pointer to incoming message queue
  */
-Queue<std::shared_ptr<CANMessage>> *CANSimulatorCore::getMessageQueue()
+Queue<MessageSnapshot *> *CANSimulatorCore::getMessageQueue()
 {
     return &m_messageQueue;
 }
 
+/*!
+ * \brief CANSimulatorCore::releaseSnapshot
+ * Give snapshot taken from the incoming message queue back for reuse
+ * \param snapshot: Pointer to snapshot
+ */
+void CANSimulatorCore::releaseSnapshot(MessageSnapshot *snapshot)
+{
+    m_snapshotPool.release(snapshot);
+}
+
+/*!
+ * \brief CANSimulatorCore::clearMessageQueue
+ * Release all snapshots left in the incoming message queue
+ */
+void CANSimulatorCore::clearMessageQueue()
+{
+    while (!m_messageQueue.empty()) {
+        m_snapshotPool.release(m_messageQueue.pop());
+    }
+}
+
 /*!
  * \brief CANSimulatorCore::getFrameQueue
  * Get CAN frame queue (used for testing)
@@ -731,6 +1650,18 @@ bool CANSimulatorCore::isMessageFiltered(std::uint32_t id)
     return false;
 }
 
+/*!
+ * \brief CANSimulatorCore::isMessageFiltered
+ * Check if message of a bus is filtered, filters apply to the primary bus
+ * \param bus: Index of the bus
+ * \param id: message ID
+ * \return true if message is to be filtered, false if not
+ */
+bool CANSimulatorCore::isMessageFiltered(unsigned int bus, std::uint32_t id)
+{
+    return bus == 0 && isMessageFiltered(id);
+}
+
 /*! \brief CANSimulatorCore::initializeMessageFilterList
  * Initialize message filtering list based on message sources
  * \param ids: list of message IDs to be filtered, if NULL or empty apply to all messages
@@ -748,8 +1679,8 @@ bool CANSimulatorCore::initializeMessageFilterList(std::vector<std::string> *ids
         bool success = false;
         if (m_ascReader) {
             success = m_ascReader->createFilterList(m_filterList);
-        } else if (m_config) {
-            success = m_config->createFilterList(m_filterList);
+        } else if (m_buses[0]->config) {
+            success = m_buses[0]->config->createFilterList(m_filterList);
         }
         if (!success) {
             LOG(LOG_ERR, "error=2 No messages found to be filtered!\n");
@@ -798,6 +1729,44 @@ bool CANSimulatorCore::initializeMessageFilterList(std::vector<std::string> *ids
     return (m_filterList.size() > 0);
 }
 
+/*!
+ * \brief CANSimulatorCore::setKernelFilters
+ * Let the kernel drop frames of IDs which are not received or are filtered out.
+ * Call after initializing the message filter list and before starting the reader thread.
+ * \param countUnknown: Read dropped frames from a sampling socket for unknown message metrics
+ * \return True if filters were set on all CAN interfaces, false otherwise
+ */
+bool CANSimulatorCore::setKernelFilters(bool countUnknown)
+{
+    bool ret = true;
+    for (unsigned int bus = 0; bus < m_buses.size(); ++bus) {
+        if (!m_buses[bus]->config || !m_buses[bus]->transceiver) {
+            continue;
+        }
+        std::set<std::uint32_t> ids;
+        const std::set<std::uint32_t> &receiveIDs = m_buses[bus]->config->getReceiveIDs();
+        for (auto it = receiveIDs.begin(); it != receiveIDs.end(); ++it) {
+            if (!isMessageFiltered(bus, *it)) {
+                ids.insert(*it);
+            }
+        }
+        std::vector<can_filter> filters = buildCANFilters(ids);
+        LOG(LOG_INFO, "Receiving %zu messages with %zu kernel filters\n", ids.size(), filters.size());
+        // Only frames of unknown messages are sampled, not the frames sent by the simulator
+        std::vector<can_filter> knownFilters;
+        if (countUnknown) {
+            std::set<std::uint32_t> known(receiveIDs);
+            const std::set<std::uint32_t> &sendIDs = m_buses[bus]->config->getSendIDs();
+            known.insert(sendIDs.begin(), sendIDs.end());
+            knownFilters = buildCANFilters(known);
+        }
+        if (!m_buses[bus]->transceiver->setReceiveFilters(filters, countUnknown, knownFilters)) {
+            ret = false;
+        }
+    }
+    return ret;
+}
+
 /*!
  * \brief CANSimulatorCore::getErrorMetrics
  * Get simulator error metrics
@@ -807,3 +1776,38 @@ struct errorMetrics CANSimulatorCore::getErrorMetrics() const
 {
     return m_errorMetrics;
 }
+
+/*!
+ * \brief CANSimulatorCore::getSchedulingLateness
+ * Get histogram of how late scheduled sends and simulation rounds were handled
+ * \return Histogram of lateness in nanoseconds
+ */
+const LatencyHistogram &CANSimulatorCore::getSchedulingLateness() const
+{
+    return m_schedulingLateness;
+}
+
+/*!
+ * \brief CANSimulatorCore::getLoopDuration
+ * Get histogram of time used by each round of the sender thread
+ * \return Histogram of durations in nanoseconds
+ */
+const LatencyHistogram &CANSimulatorCore::getLoopDuration() const
+{
+    return m_loopDuration;
+}
+
+/*!
+ * \brief CANSimulatorCore::getPeriodError
+ * Get histogram of deviations of send intervals from the cycle time of a cyclic message
+ * \param id: CAN ID of a message of the primary bus
+ * \return Histogram of deviations in nanoseconds, NULL if message has not been sent cyclically
+ */
+const LatencyHistogram *CANSimulatorCore::getPeriodError(std::uint32_t id) const
+{
+    auto it = m_buses[0]->periods.find(id);
+    if (it != m_buses[0]->periods.end()) {
+        return &it->second.error;
+    }
+    return NULL;
+}
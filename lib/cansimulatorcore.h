@@ -6,10 +6,18 @@
 #ifndef CANSIMULATORCORE_H
 #define CANSIMULATORCORE_H
 
+#include "admissioncontroller.h"
 #include "ascreader.h"
 #include "cantransceiver.h"
+#include "clock.h"
 #include "configuration.h"
+#include "latencyhistogram.h"
+#include "messagesnapshot.h"
 #include "queue.h"
+#include "reactor.h"
+#include "sendscheduler.h"
+#include "signalhandle.h"
+#include "threadconfig.h"
 #include "value.h"
 #include <cstdint>
 #include <exception>
@@ -19,11 +27,64 @@
 #include <thread>
 #include <vector>
 
+// Number of preallocated snapshots for the incoming message queue
+#define MESSAGE_SNAPSHOT_POOL_SIZE 256
+
 struct errorMetrics {
     std::uint64_t errorMessages;        // Total number of error messages
     std::uint64_t unknownMessages;      // Total number of unknown messages
-    std::uint64_t errorSize;            // Total size of all error messages
-    std::uint64_t unknownSize;          // Total size of all unknown messages
+    std::uint64_t errorSize;            // Total size of all error messages in nominal bits
+    std::uint64_t unknownSize;          // Total size of all unknown messages in nominal bits
+    std::uint64_t unknownDataSize;      // Total size of all unknown CAN FD messages in data phase bits
+};
+
+/*!
+ * Cycle time conformance of a cyclic message
+ */
+struct periodMetrics {
+    LatencyHistogram error;     // Deviation of send intervals from the cycle time in nanoseconds
+    std::uint64_t lastSend;     // Scheduler time of the previous cyclic send, 0 if not known
+
+    periodMetrics() : lastSend(0) {}
+};
+
+/*!
+ * Send queued by the sender thread, recorded when its frame is written
+ */
+struct pendingSend {
+    CANMessage *message;            // Sent message
+    std::size_t frame;              // Index of the frame in the sender batch
+    std::uint64_t time;             // Scheduler time of the send
+    std::uint64_t previousSendTime; // Last send time of the message before this send
+    std::uint64_t cycleTime;        // Cycle time of a cyclic send in nanoseconds, 0 for other sends
+};
+
+/*!
+ * CAN bus driven by the simulator, with its own dbc and cfg binding
+ */
+struct canBus {
+    std::string name;                               // Prefix of variables of the bus, empty for the primary bus
+    Configuration *config;                          // Messages and signals of the bus
+    CANTransceiver *transceiver;                    // CAN interface, NULL if not used
+    AdmissionController admission;                  // Bus load limit of sent frames
+    CANFrameBatch senderBatch;                      // Frames queued by the sender thread
+    std::vector<pendingSend> pendingSends;          // Sends of messages in senderBatch
+    CANFrameBatch sendBatch;                        // Frames queued with queueCANMessage
+    std::vector<std::uint32_t> onChangeIDs;         // On change messages checked by the sender thread
+    std::map<std::uint32_t, periodMetrics> periods; // Cyclic messages, added when the sender thread starts
+
+    canBus() : config(NULL), transceiver(NULL) {}
+};
+
+/*!
+ * Copy of a received signal value to an outgoing signal of another bus
+ */
+struct signalRoute {
+    unsigned int sourceBus;     // Index of the bus receiving the source signal
+    std::uint32_t sourceId;     // CAN ID of the message of the source signal
+    SignalHandle source;        // Received signal
+    unsigned int targetBus;     // Index of the bus sending the target signal
+    SignalHandle target;        // Outgoing signal set to the received value
 };
 
 class CANSimulatorCoreException : public std::exception
@@ -41,6 +102,13 @@ public:
                               unsigned int interval=10, int runTime=-1);
     ~CANSimulatorCore();
     bool loadConfiguration(const std::string &cfg, const std::string &dbc, bool suppressDefaults, bool ignoreDirections);
+    // Multiple buses
+    bool addBus(const std::string &name, const std::string &cfg, const std::string &dbc, const std::string &socketName,
+                bool suppressDefaults=false, bool ignoreDirections=false);
+    std::size_t getBusCount() const;
+    bool setTransceiver(const std::string &name, CANTransceiver *transceiver);
+    bool addSignalRoute(const std::string &source, const std::string &target);
+    std::size_t loadCodecs(const FrameCodec *codecs, std::size_t count);
     std::string getCfgVersion() const;
     std::string getDBCVersion() const;
     static bool getUseNativeUnits();
@@ -49,6 +117,10 @@ public:
     void setSendTime(bool enable);
     bool getUseUTCTime() const;
     void setUseUTCTime(bool enable);
+    Clock &getClock() const;
+    void setClock(Clock *clock);
+    int getBusLoadLimit() const;
+    bool setBusLoadLimit(int targetLoad);
     // Data simulator
     void startDataSimulator();
     void stopDataSimulator();
@@ -59,56 +131,100 @@ public:
     // Manual control
     bool setValue(std::string key, Value value);
     bool setValue(std::string key, std::string value);
+    SignalHandle getSignalHandle(const std::string &key);
+    Value getValue(const SignalHandle &handle) const;
+    bool setValue(const SignalHandle &handle, Value value);
+    bool setValue(const SignalHandle &handle, const std::string &value);
     bool setValues(std::vector<std::string> &input);
     void setDefaultValues(bool sendMessages = false);
     const CANSignal *getSignal(const std::string &key);
     const CANMessage *getMessage(const std::string &key);
     const CANMessage *getMessage(std::uint32_t id);
-    const std::map<std::uint32_t, CANMessage> &getMessages() const;
+    const std::vector<CANMessage> &getMessages() const;
     const std::set<std::string> &getVariables() const;
     bool sendCANMessage(std::uint32_t id, bool forceSend = false);
     bool sendCANMessage(const std::string &key, bool forceSend = false);
     bool sendCANMessages(bool sendAll = false);
+    bool queueCANMessage(const std::string &key, bool forceSend = false);
+    std::size_t flushCANMessages();
     void startCANReaderThread();
     void startCANSenderThread();
     void stopCANThreads();
+    const threadConfig &getReaderThreadConfig() const;
+    bool setReaderThreadConfig(const threadConfig &config);
+    const threadConfig &getSenderThreadConfig() const;
+    bool setSenderThreadConfig(const threadConfig &config);
+    bool lockMemory();
     int getCANBitrate();
-    Queue<std::shared_ptr<CANMessage>> *getMessageQueue();
+    int getCANDataBitrate();
+    Queue<MessageSnapshot *> *getMessageQueue();
+    void releaseSnapshot(MessageSnapshot *snapshot);
     std::map<std::uint64_t, canFrameQueueItem> *getFrameQueue();
     bool setMessageFilterState(std::uint32_t id, bool filterState);
     bool isMessageFiltered(std::uint32_t id);
     bool initializeMessageFilterList(std::vector<std::string> *ids, bool filterState, bool reset = false);
+    bool setKernelFilters(bool countUnknown);
     struct errorMetrics getErrorMetrics() const;
+    const LatencyHistogram &getSchedulingLateness() const;
+    const LatencyHistogram &getLoopDuration() const;
+    const LatencyHistogram *getPeriodError(std::uint32_t id) const;
 
 private:
     int m_interval;
     int m_runTime;
     bool m_sendTime;
+    bool m_sendTimeEnabled;
     bool m_useUTCTime;
     bool m_threadsRunning;
     static bool m_useNativeUnits;
-    Configuration *m_config;
-    Queue<std::shared_ptr<CANMessage>> m_messageQueue;
+    std::vector<canBus *> m_buses;
+    std::vector<signalRoute> m_routes;
+    Queue<MessageSnapshot *> m_messageQueue;
+    MessageSnapshotPool m_snapshotPool;
+    SendScheduler m_scheduler;
+    MonotonicClock m_monotonicClock;
+    Clock *m_clock;
+    Reactor m_receiveReactor;
+    Reactor m_sendReactor;
+    std::mutex m_sendBatchMutex;
     std::thread m_senderThread;
     std::thread m_readerThread;
+    threadConfig m_senderThreadConfig;
+    threadConfig m_readerThreadConfig;
+    bool m_memoryLocked;
     std::mutex m_inputMutex;
     std::map<std::uint32_t, bool> m_filterList;
     struct errorMetrics m_errorMetrics;
+    LatencyHistogram m_schedulingLateness;
+    LatencyHistogram m_loopDuration;
 
     ASCReader *m_ascReader;
-    CANTransceiver *m_canTransceiver;
 
     bool m_simulationRunning;
     uint64_t m_simulationTime;
 
     // Do not copy CANSimulatorCore
-    CANSimulatorCore(const CANSimulatorCore&) { }
+    CANSimulatorCore(const CANSimulatorCore&);
+    void clearMessageQueue();
+    bool openInterface(canBus &bus, const std::string &socketName);
+    unsigned int resolveBus(const std::string &key, std::string &variable) const;
+    bool isMessageFiltered(unsigned int bus, std::uint32_t id);
+    int getCANBitrate(const canBus &bus);
+    int getCANDataBitrate(const canBus &bus);
+    void routeSignals(unsigned int bus, std::uint32_t id);
     void CANReaderThread();
     void CANSenderThread();
-    std::uint32_t readCANMessage();
-    void updateTime(std::chrono::time_point<std::chrono::system_clock> &timeSendCounter,
-                    std::chrono::time_point<std::chrono::system_clock> &now,
-                    std::chrono::duration<int,std::milli> &timeSendInterval);
+    void CANSimulationLoop();
+    bool admitFrame(canBus &bus, std::uint32_t id, std::size_t length, bool canfd, bool bitRateSwitch);
+    bool sendCANMessage(unsigned int bus, CANMessage *message, bool forceSend);
+    bool queueCANMessage(unsigned int bus, CANMessage *message, bool forceSend, CANFrameBatch &batch);
+    std::uint32_t readCANMessage(unsigned int bus, canfd_frame &frame, bool canfd);
+    std::size_t readCANMessages(unsigned int bus, bool sampled = false);
+    bool sendChangedMessage(unsigned int bus, CANMessage *msg, std::uint64_t now, std::uint64_t interval);
+    bool sendScheduledMessage(unsigned int bus, CANMessage *msg, std::uint64_t now, std::uint64_t cycleTime = 0);
+    void flushSenderBatch(canBus &bus);
+    void recordPeriod(periodMetrics &period, bool sent, std::uint64_t now, std::uint64_t cycleTime);
+    void updateTime(std::uint64_t &nextUpdate, std::uint64_t now);
 };
 
 #endif // CANSIMULATORCORE_H
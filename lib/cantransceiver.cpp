@@ -4,9 +4,12 @@
 */
 
 #include "cantransceiver.h"
+#include "canfd.h"
 #include "logger.h"
+#include <algorithm>
 #include <cstring>
 #include <iostream>
+#include <iterator>
 #include <libsocketcan.h>
 #include <sys/capability.h>
 #include <sys/types.h>
@@ -24,6 +27,8 @@ const char *CANTransceiverException::what() const throw()
  * \param bitrate: CAN bus bitrate to set
  */
 CANTransceiver::CANTransceiver(const std::string &socketName, int bitrate) :
+    m_samplingSocket(-1),
+    m_interfaceIndex(0),
     m_socketName(socketName)
 {
     if (!m_socketName.compare(0, 4, "vcan")) {
@@ -36,6 +41,32 @@ CANTransceiver::CANTransceiver(const std::string &socketName, int bitrate) :
     }
 }
 
+/*!
+ * \brief CANTransceiver::CANTransceiver
+ * Constructor, use an already open datagram socket instead of a CAN interface,
+ * for example one end of a socketpair. The socket is closed by the destructor.
+ * \param canSocket: Open socket
+ * \param canfd: True if CAN FD frames may be sent
+ * \param samplingSocket: Open socket used as the sampling socket, -1 if not used
+ */
+CANTransceiver::CANTransceiver(int canSocket, bool canfd, int samplingSocket) :
+    m_canfd(canfd),
+    m_vcan(true),
+    m_canSocket(canSocket),
+    m_samplingSocket(samplingSocket),
+    m_interfaceIndex(0)
+{
+    if (m_canSocket < 0) {
+        throw CANTransceiverException();
+    }
+    int enable_sockopt = 1;
+    if (setsockopt(m_canSocket, SOL_SOCKET, SO_TIMESTAMPNS, &enable_sockopt, sizeof(enable_sockopt)) != 0 ||
+        (m_samplingSocket >= 0 &&
+         setsockopt(m_samplingSocket, SOL_SOCKET, SO_TIMESTAMPNS, &enable_sockopt, sizeof(enable_sockopt)) != 0)) {
+        LOG(LOG_WARN, "warning=2 Unable to enable receive timestamps\n");
+    }
+}
+
 /*!
  * \brief CANTransceiver::~CANTransceiver
  * Destructor.
@@ -120,6 +151,7 @@ bool CANTransceiver::initCAN(int bitrate)
 
     addr.can_family  = AF_CAN;
     addr.can_ifindex = ifr.ifr_ifindex;
+    m_interfaceIndex = ifr.ifr_ifindex;
 
     // If user has permission try to initialize CAN interface
     if (interfacePermissions) {
@@ -152,6 +184,11 @@ bool CANTransceiver::initCAN(int bitrate)
         m_canfd = false;
     }
 
+    // Receive times of frames from the kernel, the time of reading is used as fallback
+    if (setsockopt(m_canSocket, SOL_SOCKET, SO_TIMESTAMPNS, &enable_sockopt, sizeof(enable_sockopt)) != 0) {
+        LOG(LOG_WARN, "warning=2 Unable to enable receive timestamps\n");
+    }
+
     can_err_mask_t err_mask = CAN_ERR_MASK;
     if (setsockopt(m_canSocket, SOL_CAN_RAW, CAN_RAW_ERR_FILTER, &err_mask, sizeof(err_mask)) != 0) {
         LOG(LOG_ERR, "warning=2 Unable to enable error filter\n");
@@ -174,6 +211,168 @@ void CANTransceiver::closeCAN()
     if (m_canSocket >= 0) {
         close(m_canSocket);
     }
+    if (m_samplingSocket >= 0) {
+        close(m_samplingSocket);
+    }
+}
+
+/*!
+ * \brief canFilterMask
+ * Get mask of the CAN ID bits of a frame format
+ * \param extended: True for extended frame format
+ * \return CAN_EFF_MASK or CAN_SFF_MASK
+ */
+static std::uint32_t canFilterMask(bool extended)
+{
+    return extended ? CAN_EFF_MASK : CAN_SFF_MASK;
+}
+
+/*!
+ * \brief buildCANFilters
+ * Build kernel receive filters matching the given CAN IDs. Aligned blocks of
+ * consecutive IDs are merged into a single masked filter. If more than maxFilters
+ * filters remain, neighbouring filters are merged to masks also matching IDs
+ * between them, choosing the merges adding the fewest extra IDs.
+ * \param ids: CAN IDs, with CAN_EFF_FLAG for extended frames
+ * \param maxFilters: Maximum number of filters
+ * \return Filters for CAN_RAW_FILTER, matching data frames of at least the given IDs
+ */
+std::vector<can_filter> buildCANFilters(const std::set<std::uint32_t> &ids, std::size_t maxFilters)
+{
+    // Filters as base ID and number of ignored low bits, sorted by frame format and ID
+    std::vector<std::pair<std::uint32_t, unsigned int>> blocks;
+    for (auto it = ids.begin(); it != ids.end();) {
+        std::uint32_t id = *it & canFilterMask(*it & CAN_EFF_FLAG);
+        std::uint32_t format = *it & CAN_EFF_FLAG;
+        // Count consecutive IDs
+        std::uint32_t run = 1;
+        for (auto next = std::next(it); next != ids.end() && *next == *it + run &&
+             (*next & CAN_EFF_FLAG) == format; ++next) {
+            ++run;
+        }
+        // Largest aligned block starting from the ID and covered by the run
+        unsigned int bits = 0;
+        while (bits < 29 && !(id & (1U << bits)) && (2U << bits) <= run) {
+            ++bits;
+        }
+        blocks.push_back(std::make_pair(*it, bits));
+        std::advance(it, 1U << bits);
+    }
+    while (blocks.size() > maxFilters && maxFilters > 0) {
+        // Merge the neighbours whose common prefix is the longest
+        std::size_t best = blocks.size();
+        unsigned int bestBits = 32;
+        for (std::size_t index = 0; index + 1 < blocks.size(); ++index) {
+            if ((blocks[index].first & CAN_EFF_FLAG) != (blocks[index + 1].first & CAN_EFF_FLAG)) {
+                continue;
+            }
+            unsigned int bits = std::max(blocks[index].second, blocks[index + 1].second);
+            while ((blocks[index].first >> bits) != (blocks[index + 1].first >> bits)) {
+                ++bits;
+            }
+            if (bits < bestBits) {
+                best = index;
+                bestBits = bits;
+            }
+        }
+        if (best == blocks.size()) {
+            break;
+        }
+        blocks[best].first &= ~((1U << bestBits) - 1);
+        blocks[best].second = bestBits;
+        blocks.erase(blocks.begin() + best + 1);
+    }
+    std::vector<can_filter> filters;
+    for (auto it = blocks.begin(); it != blocks.end(); ++it) {
+        can_filter filter;
+        std::uint32_t mask = canFilterMask(it->first & CAN_EFF_FLAG);
+        filter.can_id = it->first;
+        // Match frame format and data frames only
+        filter.can_mask = CAN_EFF_FLAG | CAN_RTR_FLAG | (mask & ~((1U << it->second) - 1));
+        filters.push_back(filter);
+    }
+    return filters;
+}
+
+/*!
+ * \brief CANTransceiver::setReceiveFilters
+ * Let the kernel deliver only frames matching the filters, error frames are still received
+ * \param filters: Receive filters, see buildCANFilters
+ * \param sampleOthers: Receive frames of unknown messages with a separate sampling socket
+ * \param knownFilters: Filters of all messages of the bus including sent messages, not sampled
+ * \return True on success, false otherwise
+ */
+bool CANTransceiver::setReceiveFilters(const std::vector<can_filter> &filters, bool sampleOthers,
+                                       const std::vector<can_filter> &knownFilters)
+{
+    if (m_canSocket < 0) {
+        LOG(LOG_ERR, "error=2 CAN socket not ready\n");
+        return false;
+    }
+    if (setsockopt(m_canSocket, SOL_CAN_RAW, CAN_RAW_FILTER, filters.empty() ? NULL : filters.data(),
+                   filters.size() * sizeof(can_filter)) != 0) {
+        LOG(LOG_WARN, "warning=2 Unable to set CAN receive filters\n");
+        return false;
+    }
+    if (sampleOthers) {
+        // Frames sent by the simulator are looped back, they are excluded with the sent messages
+        return openSamplingSocket(knownFilters);
+    }
+    return true;
+}
+
+/*!
+ * \brief CANTransceiver::openSamplingSocket
+ * Open socket receiving the frames not matching any of the filters
+ * \param filters: Filters of the known messages
+ * \return True on success, false otherwise
+ */
+bool CANTransceiver::openSamplingSocket(const std::vector<can_filter> &filters)
+{
+    if (m_samplingSocket >= 0) {
+        close(m_samplingSocket);
+    }
+    if ((m_samplingSocket = socket(PF_CAN, SOCK_RAW, CAN_RAW)) < 0) {
+        LOG(LOG_ERR, "error=2 Unable to open CAN sampling socket\n");
+        return false;
+    }
+    int enable_sockopt = 1;
+    if (m_canfd) {
+        setsockopt(m_samplingSocket, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable_sockopt, sizeof(enable_sockopt));
+    }
+    setsockopt(m_samplingSocket, SOL_SOCKET, SO_TIMESTAMPNS, &enable_sockopt, sizeof(enable_sockopt));
+    if (!filters.empty()) {
+        // Frames matching none of the filters, inverted filters have to match all
+        std::vector<can_filter> inverted(filters);
+        for (auto it = inverted.begin(); it != inverted.end(); ++it) {
+            it->can_id |= CAN_INV_FILTER;
+        }
+#ifdef CAN_RAW_JOIN_FILTERS
+        bool joined = setsockopt(m_samplingSocket, SOL_CAN_RAW, CAN_RAW_JOIN_FILTERS,
+                                 &enable_sockopt, sizeof(enable_sockopt)) == 0 &&
+                      setsockopt(m_samplingSocket, SOL_CAN_RAW, CAN_RAW_FILTER,
+                                 inverted.data(), inverted.size() * sizeof(can_filter)) == 0;
+#else
+        bool joined = false;
+#endif
+        if (!joined) {
+            LOG(LOG_WARN, "warning=2 Unable to set CAN sampling filters\n");
+            close(m_samplingSocket);
+            m_samplingSocket = -1;
+            return false;
+        }
+    }
+    struct sockaddr_can addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = m_interfaceIndex;
+    if (bind(m_samplingSocket, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        LOG(LOG_ERR, "error=2 Unable to bind CAN sampling socket\n");
+        close(m_samplingSocket);
+        m_samplingSocket = -1;
+        return false;
+    }
+    return true;
 }
 
 /*!
@@ -186,6 +385,16 @@ const int &CANTransceiver::getCANSocket() const
     return m_canSocket;
 }
 
+/*!
+ * \brief CANTransceiver::getSamplingSocket
+ * Get the socket receiving frames dropped by the receive filters, only to be used for polling
+ * \return Reference to sampling socket descriptor, negative if not opened
+ */
+const int &CANTransceiver::getSamplingSocket() const
+{
+    return m_samplingSocket;
+}
+
 /*!
  * \brief CANTransceiver::readCANFrame
  * Read a CAN (FD) frame
@@ -203,8 +412,10 @@ bool CANTransceiver::readCANFrame(canfd_frame *frame, bool *canfd)
     if ((nbytes = read(m_canSocket, frame, CANFD_MTU)) >= 0) {
         if (nbytes == CANFD_MTU) {
             *canfd = true;
+            frame->flags |= CANFD_FDF;
         } else if (nbytes == CAN_MTU) {
             *canfd = false;
+            frame->flags = 0;
         } else {
             LOG(LOG_WARN, "warning=2 Incomplete CAN frame received\n");
             return false;
@@ -214,6 +425,95 @@ bool CANTransceiver::readCANFrame(canfd_frame *frame, bool *canfd)
     return false;
 }
 
+/*!
+ * \brief compactCANFrames
+ * Take receive times of frames read with recvmmsg, drop incomplete frames and
+ * compact the rest to the beginning of the array
+ * \param frames: Received frames, in the order of the messages
+ * \param messages: Headers of the received messages
+ * \param received: Number of received messages
+ * \return Number of frames left in the array
+ */
+std::size_t compactCANFrames(receivedCANFrame *frames, const struct mmsghdr *messages, std::size_t received)
+{
+    std::chrono::time_point<std::chrono::system_clock> now = std::chrono::system_clock::now();
+    std::size_t valid = 0;
+    for (std::size_t index = 0; index < received; ++index) {
+        receivedCANFrame &item = frames[valid];
+        if (valid != index) {
+            item.frame = frames[index].frame;
+        }
+        if (messages[index].msg_len == CANFD_MTU) {
+            item.canfd = true;
+            item.frame.flags |= CANFD_FDF;
+        } else if (messages[index].msg_len == CAN_MTU) {
+            item.canfd = false;
+            item.frame.flags = 0;
+        } else {
+            LOG(LOG_WARN, "warning=2 Incomplete CAN frame received\n");
+            continue;
+        }
+        item.timestamp = now;
+        const struct msghdr &header = messages[index].msg_hdr;
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&header); cmsg; cmsg = CMSG_NXTHDR(const_cast<struct msghdr *>(&header), cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                struct timespec ts;
+                memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                item.timestamp = std::chrono::time_point<std::chrono::system_clock>(
+                    std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                        std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec)));
+            }
+        }
+        ++valid;
+    }
+    return valid;
+}
+
+/*!
+ * \brief CANTransceiver::readCANFrames
+ * Read all available CAN (FD) frames without blocking, up to the given count
+ * \param frames: Array for the received frames and their receive times
+ * \param count: Size of the array
+ * \param sampled: Read frames of unknown messages from the sampling socket instead of the CAN socket
+ * \param received: Set to the number of frames read from the socket including dropped frames, if not NULL
+ * \return Number of valid frames in the array
+ */
+std::size_t CANTransceiver::readCANFrames(receivedCANFrame *frames, std::size_t count, bool sampled, std::size_t *received)
+{
+    if (received) {
+        *received = 0;
+    }
+    int canSocket = sampled ? m_samplingSocket : m_canSocket;
+    if (canSocket < 0) {
+        LOG(LOG_ERR, "error=2 CAN socket not ready\n");
+        return 0;
+    }
+    if (count > CAN_RECEIVE_BATCH_SIZE) {
+        count = CAN_RECEIVE_BATCH_SIZE;
+    }
+
+    struct mmsghdr messages[CAN_RECEIVE_BATCH_SIZE];
+    struct iovec vectors[CAN_RECEIVE_BATCH_SIZE];
+    char control[CAN_RECEIVE_BATCH_SIZE][CMSG_SPACE(sizeof(struct timespec))];
+    for (std::size_t index = 0; index < count; ++index) {
+        vectors[index].iov_base = &frames[index].frame;
+        vectors[index].iov_len = CANFD_MTU;
+        memset(&messages[index], 0, sizeof(messages[index]));
+        messages[index].msg_hdr.msg_iov = &vectors[index];
+        messages[index].msg_hdr.msg_iovlen = 1;
+        messages[index].msg_hdr.msg_control = control[index];
+        messages[index].msg_hdr.msg_controllen = sizeof(control[index]);
+    }
+    int read = recvmmsg(canSocket, messages, count, MSG_DONTWAIT, NULL);
+    if (read <= 0) {
+        return 0;
+    }
+    if (received) {
+        *received = read;
+    }
+    return compactCANFrames(frames, messages, read);
+}
+
 /*!
  * \brief CANTransceiver::sendCANFrame
  * Send a CAN (FD) frame
@@ -227,10 +527,104 @@ bool CANTransceiver::sendCANFrame(const canfd_frame *frame)
         return false;
     }
 
-    int retval = write(m_canSocket, frame, m_canfd ? CANFD_MTU : CAN_MTU);
+    // Classic CAN frames are always sent as such, CAN FD frames require CAN FD socket
+    bool canfd = isCANFDFrame(frame);
+    if (canfd && !m_canfd) {
+        LOG(LOG_WARN, "warning=2 CAN FD frame %#x not supported by CAN interface\n", frame->can_id);
+        return false;
+    }
+    int retval = write(m_canSocket, frame, canfd ? CANFD_MTU : CAN_MTU);
     return retval >= 0;
 }
 
+/*!
+ * \brief CANTransceiver::sendCANFrames
+ * Send CAN (FD) frames with as few system calls as possible
+ * \param frames: Array of CAN (FD) frames to be sent in order
+ * \param count: Number of frames
+ * \return Number of frames sent, sending stops at the first frame which fails
+ */
+std::size_t CANTransceiver::sendCANFrames(const canfd_frame *frames, std::size_t count)
+{
+    if (m_canSocket < 0) {
+        LOG(LOG_ERR, "error=2 CAN socket not ready\n");
+        return 0;
+    }
+
+    struct mmsghdr messages[CAN_SEND_BATCH_SIZE];
+    struct iovec vectors[CAN_SEND_BATCH_SIZE];
+    std::size_t sent = 0;
+    while (sent < count) {
+        std::size_t batch = 0;
+        while (batch < CAN_SEND_BATCH_SIZE && sent + batch < count) {
+            const canfd_frame *frame = &frames[sent + batch];
+            // Classic CAN frames are always sent as such, CAN FD frames require CAN FD socket
+            bool canfd = isCANFDFrame(frame);
+            if (canfd && !m_canfd) {
+                if (!batch) {
+                    LOG(LOG_WARN, "warning=2 CAN FD frame %#x not supported by CAN interface\n", frame->can_id);
+                    return sent;
+                }
+                break;
+            }
+            vectors[batch].iov_base = const_cast<canfd_frame *>(frame);
+            vectors[batch].iov_len = canfd ? CANFD_MTU : CAN_MTU;
+            memset(&messages[batch], 0, sizeof(messages[batch]));
+            messages[batch].msg_hdr.msg_iov = &vectors[batch];
+            messages[batch].msg_hdr.msg_iovlen = 1;
+            ++batch;
+        }
+        int retval = sendmmsg(m_canSocket, messages, batch, 0);
+        if (retval <= 0) {
+            return sent;
+        }
+        sent += retval;
+        if ((std::size_t)retval < batch) {
+            return sent;
+        }
+    }
+    return sent;
+}
+
+/*!
+ * \brief CANTransceiver::sendCANBatch
+ * Send queued frames and update transfer state of their messages. Frames which
+ * fail are skipped and their messages stay modified. The batch is cleared.
+ * \param batch: Queued frames
+ * \param written: Set to true for each sent frame and false for each skipped frame in batch order, if not NULL
+ * \return Number of frames sent
+ */
+std::size_t CANTransceiver::sendCANBatch(CANFrameBatch &batch, std::vector<bool> *written)
+{
+    std::size_t total = 0;
+    std::size_t index = 0;
+    std::size_t count = batch.m_frames.size();
+    if (written) {
+        written->assign(count, false);
+    }
+    while (index < count) {
+        std::size_t sent = sendCANFrames(&batch.m_frames[index], count - index);
+        for (std::size_t end = index + sent; index < end; ++index) {
+            if (CANMessage *message = batch.m_messages[index]) {
+                message->updateTransfer(true);
+                message->setModified(false);
+            }
+            if (written) {
+                (*written)[index] = true;
+            }
+        }
+        total += sent;
+        if (index < count) {
+            if (CANMessage *message = batch.m_messages[index]) {
+                message->updateTransfer(false);
+            }
+            ++index;
+        }
+    }
+    batch.clear();
+    return total;
+}
+
 /*!
  * \brief CANTransceiver::sendCANMessage
  * Send a CAN message
@@ -269,3 +663,25 @@ int CANTransceiver::getCANBitrate()
         return bt.bitrate;
     }
 }
+
+/*!
+ * \brief CANFrameBatch::add
+ * Queue frame for sending
+ * \param frame: CAN (FD) frame, copied to the batch
+ * \param message: CAN message of the frame, or NULL
+ */
+void CANFrameBatch::add(const canfd_frame &frame, CANMessage *message)
+{
+    m_frames.push_back(frame);
+    m_messages.push_back(message);
+}
+
+/*!
+ * \brief CANFrameBatch::clear
+ * Remove all queued frames
+ */
+void CANFrameBatch::clear()
+{
+    m_frames.clear();
+    m_messages.clear();
+}
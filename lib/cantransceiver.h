@@ -7,8 +7,13 @@
 #define CANTRANSCEIVER_H
 
 #include "canmessage.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <exception>
+#include <set>
 #include <string>
+#include <vector>
 
 extern "C" {
 #include <linux/can.h>
@@ -18,6 +23,25 @@ extern "C" {
 #include <sys/ioctl.h>
 }
 
+// Maximum number of frames sent with a single sendmmsg call
+#define CAN_SEND_BATCH_SIZE 64
+// Maximum number of frames read with a single recvmmsg call
+#define CAN_RECEIVE_BATCH_SIZE 64
+// Maximum number of kernel receive filters, CAN_RAW_FILTER_MAX of the kernel
+#define CAN_RECEIVE_FILTER_MAX 512
+
+/*!
+ * Received CAN (FD) frame with its kernel receive timestamp
+ */
+struct receivedCANFrame {
+    canfd_frame frame;
+    bool canfd;                                                     // True if received as CAN FD frame
+    std::chrono::time_point<std::chrono::system_clock> timestamp;   // Receive time of the frame
+};
+
+std::vector<can_filter> buildCANFilters(const std::set<std::uint32_t> &ids, std::size_t maxFilters = CAN_RECEIVE_FILTER_MAX);
+std::size_t compactCANFrames(receivedCANFrame *frames, const struct mmsghdr *messages, std::size_t received);
+
 class CANTransceiverException : public std::exception
 {
   public:
@@ -25,14 +49,40 @@ class CANTransceiverException : public std::exception
   virtual const char *what() const throw();
 };
 
+/*!
+ * Frames queued for sending in a single batch.
+ * Frames of CAN messages update the transfer state of the message when the batch is sent.
+ */
+class CANFrameBatch
+{
+    friend class CANTransceiver;
+
+public:
+    void add(const canfd_frame &frame, CANMessage *message = NULL);
+    void clear();
+    bool empty() const { return m_frames.empty(); }
+    std::size_t size() const { return m_frames.size(); }
+
+private:
+    std::vector<canfd_frame> m_frames;
+    std::vector<CANMessage *> m_messages;
+};
+
 class CANTransceiver
 {
 public:
     CANTransceiver(const std::string &socketName, int bitrate);
+    CANTransceiver(int canSocket, bool canfd, int samplingSocket = -1);
     ~CANTransceiver();
     const int &getCANSocket() const;
+    const int &getSamplingSocket() const;
+    bool setReceiveFilters(const std::vector<can_filter> &filters, bool sampleOthers,
+                           const std::vector<can_filter> &knownFilters);
     bool readCANFrame(canfd_frame *frame, bool *canfd);
+    std::size_t readCANFrames(receivedCANFrame *frames, std::size_t count, bool sampled = false, std::size_t *received = NULL);
     bool sendCANFrame(const canfd_frame *frame);
+    std::size_t sendCANFrames(const canfd_frame *frames, std::size_t count);
+    std::size_t sendCANBatch(CANFrameBatch &batch, std::vector<bool> *written = NULL);
     bool sendCANMessage(CANMessage *message);
     int getCANBitrate();
 
@@ -40,9 +90,12 @@ private:
     bool m_canfd;
     bool m_vcan;
     int m_canSocket;
+    int m_samplingSocket;
+    int m_interfaceIndex;
     std::string m_socketName;
 
     bool initCAN(int bitrate);
+    bool openSamplingSocket(const std::vector<can_filter> &filters);
     bool isCANInterfaceUp() const;
     static bool userHasInterfacePermissions();
     void closeCAN();
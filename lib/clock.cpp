@@ -0,0 +1,99 @@
+/*!
+* \file
+* \brief clock.cpp foo
+*/
+
+#include "clock.h"
+#include <cerrno>
+#include <ctime>
+
+/*!
+ * \brief MonotonicClock::now
+ * Get current time
+ * \return CLOCK_MONOTONIC time in nanoseconds
+ */
+std::uint64_t MonotonicClock::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (std::uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*!
+ * \brief MonotonicClock::wallTime
+ * Get calendar time
+ * \return CLOCK_REALTIME time in nanoseconds since the Unix epoch
+ */
+std::uint64_t MonotonicClock::wallTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (std::uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*!
+ * \brief MonotonicClock::sleepUntil
+ * Sleep until absolute time
+ * \param deadline: CLOCK_MONOTONIC time in nanoseconds
+ */
+void MonotonicClock::sleepUntil(std::uint64_t deadline)
+{
+    struct timespec ts;
+    ts.tv_sec = deadline / 1000000000ULL;
+    ts.tv_nsec = deadline % 1000000000ULL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+/*!
+ * \brief VirtualClock::VirtualClock
+ * Constructor, the clock starts at VIRTUAL_CLOCK_START
+ * \param epoch: Calendar time at start in nanoseconds since the Unix epoch
+ */
+VirtualClock::VirtualClock(std::uint64_t epoch) :
+    m_now(VIRTUAL_CLOCK_START),
+    m_epoch(epoch)
+{
+}
+
+/*!
+ * \brief VirtualClock::now
+ * Get current logical time
+ * \return Time in nanoseconds
+ */
+std::uint64_t VirtualClock::now()
+{
+    return m_now.load();
+}
+
+/*!
+ * \brief VirtualClock::wallTime
+ * Get calendar time from the epoch and the elapsed logical time
+ * \return Time in nanoseconds since the Unix epoch
+ */
+std::uint64_t VirtualClock::wallTime()
+{
+    return m_epoch + (m_now.load() - VIRTUAL_CLOCK_START);
+}
+
+/*!
+ * \brief VirtualClock::sleepUntil
+ * Move time to the deadline without sleeping, time never moves backwards
+ * \param deadline: Time in nanoseconds
+ */
+void VirtualClock::sleepUntil(std::uint64_t deadline)
+{
+    std::uint64_t current = m_now.load();
+    while (deadline > current && !m_now.compare_exchange_weak(current, deadline)) {
+    }
+}
+
+/*!
+ * \brief VirtualClock::advance
+ * Move time forward
+ * \param duration: Time in nanoseconds
+ */
+void VirtualClock::advance(std::uint64_t duration)
+{
+    m_now.fetch_add(duration);
+}
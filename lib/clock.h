@@ -0,0 +1,68 @@
+/*!
+* \file
+* \brief clock.h foo
+*/
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <atomic>
+#include <cstdint>
+
+// First time of a virtual clock in nanoseconds, above zero which marks unknown times
+#define VIRTUAL_CLOCK_START 1000000000ULL
+
+/*!
+ * Time source of the simulator.
+ * now() is a monotonic time in nanoseconds used for send deadlines, replay and
+ * metrics, wallTime() is the calendar time in nanoseconds since the Unix epoch
+ * used for time signals. sleepUntil() returns once now() has reached the
+ * deadline.
+ */
+class Clock
+{
+public:
+    virtual ~Clock() {}
+    virtual std::uint64_t now() = 0;
+    virtual std::uint64_t wallTime() = 0;
+    virtual void sleepUntil(std::uint64_t deadline) = 0;
+    virtual bool isVirtual() const = 0;
+};
+
+/*!
+ * Real time clock, CLOCK_MONOTONIC with calendar time from CLOCK_REALTIME
+ */
+class MonotonicClock : public Clock
+{
+public:
+    std::uint64_t now();
+    std::uint64_t wallTime();
+    void sleepUntil(std::uint64_t deadline);
+    bool isVirtual() const { return false; }
+};
+
+/*!
+ * Logical clock for faster than real time runs.
+ * Time only moves when a thread sleeps or advance() is called, sleeping jumps
+ * to the deadline at once. Runs driven only by the clock are repeatable, the
+ * calendar time starts from a fixed epoch.
+ */
+class VirtualClock : public Clock
+{
+public:
+    explicit VirtualClock(std::uint64_t epoch = 0);
+    std::uint64_t now();
+    std::uint64_t wallTime();
+    void sleepUntil(std::uint64_t deadline);
+    bool isVirtual() const { return true; }
+    void advance(std::uint64_t duration);
+
+private:
+    std::atomic<std::uint64_t> m_now;
+    std::uint64_t m_epoch;
+
+    // Do not copy VirtualClock
+    VirtualClock(const VirtualClock&);
+};
+
+#endif // CLOCK_H
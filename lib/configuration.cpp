@@ -6,6 +6,8 @@
 #include "configuration.h"
 #include "logger.h"
 #include <can-dbcparser/header/dbciterator.hpp>
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <iomanip>
 #include <sstream>
@@ -49,11 +51,21 @@ Configuration::Configuration(const std::string &cfg, const std::string &dbc, boo
     }
 
     initMessageDirections();
+    // Messages are stored in CAN ID order and the store is never resized after this,
+    // so pointers to the messages stay valid for the lifetime of the configuration
+    std::size_t count = 0;
     for (auto it = m_dbcIterator->begin(); it != m_dbcIterator->end(); ++it) {
         if (m_sendIDs.count(it->second.getId()) || m_receiveIDs.count(it->second.getId())) {
-            m_messages.insert({it->second.getId(), CANMessage(it->second)});
+            ++count;
         }
     }
+    m_messages.reserve(count);
+    for (auto it = m_dbcIterator->begin(); it != m_dbcIterator->end(); ++it) {
+        if (m_sendIDs.count(it->second.getId()) || m_receiveIDs.count(it->second.getId())) {
+            m_messages.emplace_back(it->second);
+        }
+    }
+    initMessageIndex();
     // Copy global attributes
     DBCIterator::attributesMap attributes = m_dbcIterator->getAttributes();
     for (const auto &attribute : attributes) {
@@ -62,6 +74,7 @@ Configuration::Configuration(const std::string &cfg, const std::string &dbc, boo
         }
     }
     initSignalSettings();
+    initMessageSettings();
     setDefaultValues();
     initCANMessageDirections();
 
@@ -156,6 +169,39 @@ void Configuration::initSignalSettings()
     }
 }
 
+/*!
+ * \brief Configuration::initMessageSettings
+ * Initialize message settings from configuration file
+ */
+void Configuration::initMessageSettings()
+{
+    json_t *messages = json_object_get(m_canMapping, "messages");
+    if (messages) {
+        const char *key;
+        json_t *value;
+        json_object_foreach(messages, key, value) {
+            char *end = NULL;
+            std::uint32_t msgId = strtoul(key, &end, 0);
+            if (!*key || *end) {
+                LOG(LOG_WARN, "warning=1 Incorrect message ID '%s'\n", key);
+                continue;
+            }
+            std::uint32_t entry = findIndexEntry(msgId);
+            if (entry == MESSAGE_INDEX_NONE) {
+                LOG(LOG_WARN, "warning=3 Message %u (%#x) not found in dbc file\n", msgId, msgId);
+                continue;
+            }
+            if (json_t *offset = json_object_get(value, "offset")) {
+                if (json_is_integer(offset) && json_integer_value(offset) >= 0) {
+                    m_messages[entry & MESSAGE_INDEX_MASK].setSendOffset(json_integer_value(offset));
+                } else {
+                    LOG(LOG_WARN, "warning=1 Incorrect offset for message '%s'\n", key);
+                }
+            }
+        }
+    }
+}
+
 /*!
  * \brief Configuration::initMessageDirections
  * Initialize lists of message directions
@@ -243,6 +289,79 @@ bool Configuration::setValue(const std::string &key, std::string value)
     return false;
 }
 
+/*!
+ * \brief Configuration::getSignalHandle
+ * Resolve variable name to a handle for repeated access
+ * \param key: Variable name
+ * \return Handle of the variable, invalid if variable is not found
+ */
+SignalHandle Configuration::getSignalHandle(const std::string &key)
+{
+    SignalHandle handle;
+    std::uint32_t msgId;
+    if (getMessageId(key, msgId)) {
+        handle.m_message = getMessage(msgId);
+        handle.m_signal = getSignal(key);
+        if (!handle.m_message || !handle.m_signal) {
+            return SignalHandle();
+        }
+        handle.m_outgoing = (m_sendIDs.count(msgId) > 0);
+    }
+    return handle;
+}
+
+/*!
+ * \brief Configuration::getValue
+ * Get the value of a variable
+ * \param handle: Handle of the variable
+ * \return Current Value of the variable
+ */
+Value Configuration::getValue(const SignalHandle &handle) const
+{
+    if (handle.m_signal) {
+        return handle.m_signal->getValue();
+    }
+    return Value();
+}
+
+/*!
+ * \brief Configuration::setValue
+ * Set a value for a variable
+ * \param handle: Handle of the variable
+ * \param value: Value for the variable
+ * \return True if successful, false otherwise.
+ */
+bool Configuration::setValue(const SignalHandle &handle, Value value)
+{
+    if (!handle.m_signal) {
+        return false;
+    }
+    if (!handle.m_outgoing) {
+        LOG(LOG_WARN, "warning=1 Not setting variable '%s'. Variable not defined as outgoing\n", handle.m_signal->getVariableName().c_str());
+        return false;
+    }
+    return handle.m_message->setValue(*handle.m_signal, value);
+}
+
+/*!
+ * \brief Configuration::setValue
+ * Set a value for a variable from string
+ * \param handle: Handle of the variable
+ * \param value: Value as a string
+ * \return True if successful, false otherwise.
+ */
+bool Configuration::setValue(const SignalHandle &handle, const std::string &value)
+{
+    if (!handle.m_signal) {
+        return false;
+    }
+    if (!handle.m_outgoing) {
+        LOG(LOG_WARN, "warning=1 Not setting variable '%s'. Variable not defined as outgoing\n", handle.m_signal->getVariableName().c_str());
+        return false;
+    }
+    return handle.m_message->setValue(*handle.m_signal, value);
+}
+
 /*!
  * \brief Configuration::getDefaultValue
  * Get the default value for a variable name
@@ -264,7 +383,7 @@ Value Configuration::getDefaultValue(const std::string &key)
 void Configuration::setDefaultValues()
 {
     for (auto it = m_messages.begin(); it != m_messages.end(); ++it) {
-        it->second.resetValues(m_suppressDefaults);
+        it->resetValues(m_suppressDefaults);
     }
 }
 
@@ -355,15 +474,34 @@ CANSignal *Configuration::getSignal(const std::string &key)
  */
 CANMessage *Configuration::getMessage(const std::uint32_t &msgId)
 {
-    std::map<std::uint32_t, CANMessage>::iterator msg = m_messages.find(msgId);
-    if (msg != m_messages.end()) {
-        return &msg->second;
+    std::uint32_t entry = findIndexEntry(msgId);
+    if (entry != MESSAGE_INDEX_NONE) {
+        return &m_messages[entry & MESSAGE_INDEX_MASK];
     } else {
         LOG(LOG_WARN, "warning=3 Message %u (%#x) not found in dbc file\n", msgId, msgId);
         return NULL;
     }
 }
 
+/*!
+ * \brief Configuration::findMessage
+ * Get CANMessage and its configured directions by CAN ID with a single index lookup
+ * \param canId: CAN ID as received from the bus
+ * \param send: Set true if message is configured as outgoing
+ * \param receive: Set true if message is configured as incoming
+ * \return Pointer to CANMessage object, or NULL if message is not configured
+ */
+CANMessage *Configuration::findMessage(std::uint32_t canId, bool &send, bool &receive)
+{
+    std::uint32_t entry = findIndexEntry(canId);
+    send = entry & MESSAGE_INDEX_SEND;
+    receive = entry & MESSAGE_INDEX_RECEIVE;
+    if (entry != MESSAGE_INDEX_NONE) {
+        return &m_messages[entry & MESSAGE_INDEX_MASK];
+    }
+    return NULL;
+}
+
 /*!
  * \brief Configuration::getMessage
  * Get CANMessage by variable name
@@ -438,6 +576,52 @@ void Configuration::initCANMessageDirections()
     }
 }
 
+/*!
+ * \brief Configuration::initMessageIndex
+ * Build the CAN ID index of the message store. Standard IDs are looked up directly
+ * from a table covering the whole 11-bit ID space, other IDs by binary search.
+ * Each entry holds the message position in the store and its configured directions.
+ */
+void Configuration::initMessageIndex()
+{
+    m_standardIndex.assign(CAN_SFF_MASK + 1, MESSAGE_INDEX_NONE);
+    m_extendedIndex.clear();
+    for (std::size_t i = 0; i < m_messages.size(); ++i) {
+        std::uint32_t id = m_messages[i].getId();
+        std::uint32_t entry = i;
+        if (m_sendIDs.count(id)) {
+            entry |= MESSAGE_INDEX_SEND;
+        }
+        if (m_receiveIDs.count(id)) {
+            entry |= MESSAGE_INDEX_RECEIVE;
+        }
+        if (id <= CAN_SFF_MASK) {
+            m_standardIndex[id] = entry;
+        } else {
+            // Store is in CAN ID order, so the extended index is sorted as well
+            m_extendedIndex.push_back(std::make_pair(id, entry));
+        }
+    }
+}
+
+/*!
+ * \brief Configuration::findIndexEntry
+ * Look up CAN ID from the message index
+ * \param canId: CAN ID
+ * \return Index entry, or MESSAGE_INDEX_NONE if message is not configured
+ */
+std::uint32_t Configuration::findIndexEntry(std::uint32_t canId) const
+{
+    if (canId <= CAN_SFF_MASK) {
+        return m_standardIndex[canId];
+    }
+    auto it = std::lower_bound(m_extendedIndex.begin(), m_extendedIndex.end(), std::make_pair(canId, (std::uint32_t)0));
+    if (it != m_extendedIndex.end() && it->first == canId) {
+        return it->second;
+    }
+    return MESSAGE_INDEX_NONE;
+}
+
 /*!
  * \brief Configuration::createFilterList
  * Add all messages to filter list
@@ -446,9 +630,32 @@ void Configuration::initCANMessageDirections()
  */
 bool Configuration::createFilterList(std::map<std::uint32_t, bool> &list)
 {
-    std::map<std::uint32_t, CANMessage>::iterator messages;
-    for (messages = m_messages.begin(); messages != m_messages.end(); ++messages) {
-        list.insert(std::pair<std::uint32_t, bool>(messages->first, false));
+    for (auto it = m_messages.begin(); it != m_messages.end(); ++it) {
+        list.insert(std::pair<std::uint32_t, bool>(it->getId(), false));
     }
     return (list.size() > 0);
 }
+
+/*!
+ * \brief Configuration::loadCodecs
+ * Use generated codecs for configured messages
+ * \param codecs: Array of generated codecs
+ * \param count: Number of codecs in array
+ * \return Number of codecs taken into use
+ */
+std::size_t Configuration::loadCodecs(const FrameCodec *codecs, std::size_t count)
+{
+    std::size_t loaded = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        std::uint32_t entry = findIndexEntry(codecs[i].id);
+        if (entry == MESSAGE_INDEX_NONE) {
+            continue;
+        }
+        if (m_messages[entry & MESSAGE_INDEX_MASK].setCodec(&codecs[i])) {
+            ++loaded;
+        } else {
+            LOG(LOG_WARN, "warning=1 Generated codec does not match CAN message %u (%#x)\n", codecs[i].id, codecs[i].id);
+        }
+    }
+    return loaded;
+}
@@ -9,13 +9,22 @@
 #include <can-dbcparser/header/attribute.hpp>
 #include "canmessage.h"
 #include "cansignal.h"
+#include "framecodec.h"
+#include "signalhandle.h"
 #include "value.h"
 #include <exception>
 #include <jansson.h>
 #include <map>
 #include <set>
 #include <string>
-#include <map>
+#include <utility>
+#include <vector>
+
+// Entries of the CAN ID index: position in the message store and configured directions
+#define MESSAGE_INDEX_NONE      0x00000000U
+#define MESSAGE_INDEX_MASK      0x3fffffffU
+#define MESSAGE_INDEX_RECEIVE   0x40000000U
+#define MESSAGE_INDEX_SEND      0x80000000U
 
 class ConfigurationException : public std::exception
 {
@@ -35,12 +44,17 @@ public:
     CANSignal *getSignal(const std::string &key);
     CANMessage *getMessage(const std::string &key);
     CANMessage *getMessage(const std::uint32_t &msgId);
+    CANMessage *findMessage(std::uint32_t canId, bool &send, bool &receive);
     bool isVariableSupported(const std::string &key);
     void setDefaultValues();
     Value getDefaultValue(const std::string &key);
     Value getValue(const std::string &key);
     bool setValue(const std::string &key, Value value);
     bool setValue(const std::string &key, std::string value);
+    SignalHandle getSignalHandle(const std::string &key);
+    Value getValue(const SignalHandle &handle) const;
+    bool setValue(const SignalHandle &handle, Value value);
+    bool setValue(const SignalHandle &handle, const std::string &value);
     bool getMessageId(const std::string &key, std::uint32_t &msgId);
     const std::set<std::uint32_t> &getSendIDs() const;
     const std::set<std::uint32_t> &getReceiveIDs() const;
@@ -50,8 +64,9 @@ public:
     const std::map<std::string, Attribute> &getAttributes() const {
         return m_attributes;
     }
-    const std::map<std::uint32_t, CANMessage> &getMessages() const { return m_messages; }
+    const std::vector<CANMessage> &getMessages() const { return m_messages; }
     bool createFilterList(std::map<std::uint32_t, bool> &list);
+    std::size_t loadCodecs(const FrameCodec *codecs, std::size_t count);
 
 private:
     std::string m_cfgFile;
@@ -62,13 +77,18 @@ private:
     std::set<std::uint32_t> m_sendIDs;
     std::set<std::uint32_t> m_receiveIDs;
     std::set<std::string> m_variables;
-    std::map<std::uint32_t, CANMessage> m_messages;
+    std::vector<CANMessage> m_messages;
+    std::vector<std::uint32_t> m_standardIndex;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> m_extendedIndex;
     std::map<std::string, Attribute> m_attributes;
 
     void initSignalSettings();
+    void initMessageSettings();
     void initMessageDirections();
     bool getSignalName(const std::string &key, std::string &SignalName);
     void initCANMessageDirections();
+    void initMessageIndex();
+    std::uint32_t findIndexEntry(std::uint32_t canId) const;
 };
 
 #endif // CONFIGURATION_H
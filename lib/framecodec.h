@@ -0,0 +1,97 @@
+/*!
+* \file
+* \brief framecodec.h foo
+*/
+
+#ifndef FRAMECODEC_H
+#define FRAMECODEC_H
+
+#include <can-dbcparser/header/signal.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <endian.h>
+
+/*!
+ * Specialised codec of a single CAN message, generated by dbc2cpp.
+ * Raw values are ordered as the signals in CANMessage::getSignals() and
+ * signed values are sign extended to 64 bits.
+ */
+struct FrameCodec
+{
+    std::uint32_t id;                       // CAN message ID
+    std::uint8_t dlc;                       // Length of the message payload
+    const char *name;                       // Name of the message
+    std::size_t signalCount;                // Number of signals in the message
+    const char *const *signalNames;         // Names of the signals in raw value order
+    void (*encode)(const std::uint64_t *rawValues, std::uint8_t *data);
+    void (*decode)(const std::uint8_t *data, std::uint64_t *rawValues);
+};
+
+/*!
+ * \brief frameCodecLoad
+ * Load 64-bit word from payload in signal byte order
+ * \param data: Pointer to payload
+ * \return Loaded word in host byte order
+ */
+template<ByteOrder Order, unsigned int WordOffset>
+inline std::uint64_t frameCodecLoad(const std::uint8_t *data)
+{
+    std::uint64_t word;
+    memcpy(&word, data + WordOffset, sizeof(word));
+    return (Order == ByteOrder::INTEL) ? le64toh(word) : be64toh(word);
+}
+
+/*!
+ * \brief frameCodecStore
+ * Store 64-bit word to payload in signal byte order
+ * \param data: Pointer to payload
+ * \param word: Word in host byte order
+ */
+template<ByteOrder Order, unsigned int WordOffset>
+inline void frameCodecStore(std::uint8_t *data, std::uint64_t word)
+{
+    word = (Order == ByteOrder::INTEL) ? htole64(word) : htobe64(word);
+    memcpy(data + WordOffset, &word, sizeof(word));
+}
+
+/*!
+ * \brief frameCodecExtract
+ * Extract raw signal value from payload
+ * \param data: Pointer to payload
+ * \return Raw value of the signal
+ */
+template<ByteOrder Order, unsigned int WordOffset, unsigned int Shift, std::uint64_t Mask>
+inline std::uint64_t frameCodecExtract(const std::uint8_t *data)
+{
+    return (frameCodecLoad<Order, WordOffset>(data) >> Shift) & Mask;
+}
+
+/*!
+ * \brief frameCodecInsert
+ * Insert raw signal value to payload
+ * \param data: Pointer to payload
+ * \param rawValue: Raw value of the signal
+ */
+template<ByteOrder Order, unsigned int WordOffset, unsigned int Shift, std::uint64_t Mask>
+inline void frameCodecInsert(std::uint8_t *data, std::uint64_t rawValue)
+{
+    std::uint64_t word = frameCodecLoad<Order, WordOffset>(data);
+    word = (word & ~(Mask << Shift)) | ((rawValue & Mask) << Shift);
+    frameCodecStore<Order, WordOffset>(data, word);
+}
+
+/*!
+ * \brief frameCodecSignExtend
+ * Sign extend raw value of given width to 64 bits
+ * \param rawValue: Raw value of the signal
+ * \return Sign extended value
+ */
+template<unsigned int Bits>
+inline std::uint64_t frameCodecSignExtend(std::uint64_t rawValue)
+{
+    return (Bits == 0 || Bits >= 64) ? rawValue :
+        (rawValue ^ (1ULL << ((Bits - 1) & 63))) - (1ULL << ((Bits - 1) & 63));
+}
+
+#endif // FRAMECODEC_H
@@ -0,0 +1,131 @@
+/*!
+* \file
+* \brief latencyhistogram.cpp foo
+*/
+
+#include "latencyhistogram.h"
+
+// Number of sub-buckets of each power of two above the exact range
+#define LATENCY_HALF_BUCKETS (1 << (LATENCY_SUB_BUCKET_BITS - 1))
+
+/*!
+ * \brief LatencyHistogram::LatencyHistogram
+ * Constructor
+ */
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+/*!
+ * \brief LatencyHistogram::bucketIndex
+ * Get bucket of a value
+ * \param value: Value in nanoseconds, below 2^LATENCY_MAX_BITS
+ * \return Bucket index
+ */
+unsigned int LatencyHistogram::bucketIndex(std::uint64_t value)
+{
+    if (value < (1 << LATENCY_SUB_BUCKET_BITS)) {
+        return value;
+    }
+    // Shift leaving the value in the upper half of the sub-bucket range
+    unsigned int shift = (63 - __builtin_clzll(value)) - (LATENCY_SUB_BUCKET_BITS - 1);
+    return (1 << LATENCY_SUB_BUCKET_BITS) + (shift - 1) * LATENCY_HALF_BUCKETS +
+           ((value >> shift) - LATENCY_HALF_BUCKETS);
+}
+
+/*!
+ * \brief LatencyHistogram::bucketHighest
+ * Get largest value counted in a bucket
+ * \param index: Bucket index
+ * \return Value in nanoseconds
+ */
+std::uint64_t LatencyHistogram::bucketHighest(unsigned int index)
+{
+    if (index < (1 << LATENCY_SUB_BUCKET_BITS)) {
+        return index;
+    }
+    unsigned int shift = (index - (1 << LATENCY_SUB_BUCKET_BITS)) / LATENCY_HALF_BUCKETS + 1;
+    std::uint64_t subBucket = (index - (1 << LATENCY_SUB_BUCKET_BITS)) % LATENCY_HALF_BUCKETS + LATENCY_HALF_BUCKETS;
+    return ((subBucket + 1) << shift) - 1;
+}
+
+/*!
+ * \brief LatencyHistogram::record
+ * Count a value, values beyond the range are counted in the last bucket
+ * \param value: Value in nanoseconds
+ */
+void LatencyHistogram::record(std::uint64_t value)
+{
+    const std::uint64_t largest = (1ULL << LATENCY_MAX_BITS) - 1;
+    if (value > largest) {
+        value = largest;
+    }
+    m_counts[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    std::uint64_t max = m_max.load(std::memory_order_relaxed);
+    while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+/*!
+ * \brief LatencyHistogram::reset
+ * Remove all counted values
+ */
+void LatencyHistogram::reset()
+{
+    for (unsigned int index = 0; index < LATENCY_BUCKET_COUNT; ++index) {
+        m_counts[index].store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+/*!
+ * \brief LatencyHistogram::getCount
+ * Get number of counted values
+ * \return Number of values
+ */
+std::uint64_t LatencyHistogram::getCount() const
+{
+    return m_count.load(std::memory_order_relaxed);
+}
+
+/*!
+ * \brief LatencyHistogram::getMax
+ * Get largest counted value
+ * \return Value in nanoseconds, 0 if nothing was counted
+ */
+std::uint64_t LatencyHistogram::getMax() const
+{
+    return m_max.load(std::memory_order_relaxed);
+}
+
+/*!
+ * \brief LatencyHistogram::getPercentile
+ * Get value below or equal to the given share of counted values
+ * \param percentile: Percentile, for example 99.9
+ * \return Highest value of the bucket reaching the percentile in nanoseconds, at most the maximum,
+ * 0 if nothing was counted
+ */
+std::uint64_t LatencyHistogram::getPercentile(double percentile) const
+{
+    std::uint64_t count = getCount();
+    if (!count) {
+        return 0;
+    }
+    std::uint64_t target = (std::uint64_t)(percentile / 100.0 * count + 0.5);
+    if (target < 1) {
+        target = 1;
+    }
+    std::uint64_t max = getMax();
+    std::uint64_t cumulative = 0;
+    for (unsigned int index = 0; index < LATENCY_BUCKET_COUNT; ++index) {
+        cumulative += m_counts[index].load(std::memory_order_relaxed);
+        if (cumulative >= target) {
+            std::uint64_t value = bucketHighest(index);
+            return value < max ? value : max;
+        }
+    }
+    return max;
+}
@@ -0,0 +1,48 @@
+/*!
+* \file
+* \brief latencyhistogram.h foo
+*/
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+
+// Linear sub-buckets per power of two are 2^(LATENCY_SUB_BUCKET_BITS - 1), relative error below 1/32
+#define LATENCY_SUB_BUCKET_BITS 6
+// Largest recorded value is 2^LATENCY_MAX_BITS - 1 nanoseconds, about 36 minutes
+#define LATENCY_MAX_BITS 41
+#define LATENCY_BUCKET_COUNT ((1 << LATENCY_SUB_BUCKET_BITS) + \
+                              (LATENCY_MAX_BITS - LATENCY_SUB_BUCKET_BITS) * (1 << (LATENCY_SUB_BUCKET_BITS - 1)))
+
+/*!
+ * Log-linear histogram of durations in nanoseconds, in the style of HdrHistogram.
+ * Values below 2^LATENCY_SUB_BUCKET_BITS are counted exactly, larger values in
+ * buckets whose width grows with each power of two. Recording is lock-free and
+ * may run concurrently with reading, which sees a consistent enough view for
+ * reporting.
+ */
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+    void record(std::uint64_t value);
+    void reset();
+    std::uint64_t getCount() const;
+    std::uint64_t getMax() const;
+    std::uint64_t getPercentile(double percentile) const;
+
+private:
+    std::atomic<std::uint64_t> m_counts[LATENCY_BUCKET_COUNT];
+    std::atomic<std::uint64_t> m_count;
+    std::atomic<std::uint64_t> m_max;
+
+    static unsigned int bucketIndex(std::uint64_t value);
+    static std::uint64_t bucketHighest(unsigned int index);
+
+    // Do not copy LatencyHistogram
+    LatencyHistogram(const LatencyHistogram&);
+};
+
+#endif // LATENCYHISTOGRAM_H
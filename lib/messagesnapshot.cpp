@@ -0,0 +1,99 @@
+/*!
+* \file
+* \brief messagesnapshot.cpp foo
+*/
+
+#include "messagesnapshot.h"
+#include "cansignal.h"
+#include <cstring>
+
+/*!
+ * \brief MessageSnapshot::MessageSnapshot
+ * Constructor
+ */
+MessageSnapshot::MessageSnapshot() :
+    m_message(NULL),
+    m_id(0),
+    m_length(0),
+    m_pooled(false)
+{
+    memset(m_payload, 0, sizeof(m_payload));
+    memset(m_changed, 0, sizeof(m_changed));
+}
+
+/*!
+ * \brief MessageSnapshot::isChanged
+ * Check whether signal value changed in the frame of the snapshot
+ * \param index: Index of the signal in CANMessage::getSignals()
+ * \return True if signal value changed, false otherwise. Signals beyond
+ * MESSAGE_SNAPSHOT_MAX_SIGNALS are always reported as changed.
+ */
+bool MessageSnapshot::isChanged(std::size_t index) const
+{
+    if (index >= MESSAGE_SNAPSHOT_MAX_SIGNALS) {
+        return true;
+    }
+    return (m_changed[index / 64] >> (index % 64)) & 1;
+}
+
+/*!
+ * \brief MessageSnapshot::getValue
+ * Decode signal value from the payload of the snapshot
+ * \param signal: Signal of the snapshot message
+ * \return Value of the signal. Multiplexed signals have a meaningful value
+ * only when their page was active in the frame.
+ */
+Value MessageSnapshot::getValue(const CANSignal &signal) const
+{
+    const SignalLayout &layout = signal.getLayout();
+    return signal.rawToValue(layout.signExtend(layout.extract(m_payload)));
+}
+
+/*!
+ * \brief MessageSnapshotPool::MessageSnapshotPool
+ * Constructor
+ * \param capacity: Number of preallocated snapshots
+ */
+MessageSnapshotPool::MessageSnapshotPool(std::size_t capacity) :
+    m_snapshots(capacity)
+{
+    m_free.reserve(capacity);
+    for (auto it = m_snapshots.begin(); it != m_snapshots.end(); ++it) {
+        it->m_pooled = true;
+        m_free.push_back(&*it);
+    }
+}
+
+/*!
+ * \brief MessageSnapshotPool::acquire
+ * Take free snapshot from the pool, or allocate a new one if the pool is exhausted
+ * \return Pointer to snapshot
+ */
+MessageSnapshot *MessageSnapshotPool::acquire()
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (m_free.empty()) {
+        return new MessageSnapshot();
+    }
+    MessageSnapshot *snapshot = m_free.back();
+    m_free.pop_back();
+    return snapshot;
+}
+
+/*!
+ * \brief MessageSnapshotPool::release
+ * Give snapshot back to the pool
+ * \param snapshot: Snapshot returned by acquire()
+ */
+void MessageSnapshotPool::release(MessageSnapshot *snapshot)
+{
+    if (!snapshot) {
+        return;
+    }
+    if (!snapshot->m_pooled) {
+        delete snapshot;
+        return;
+    }
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_free.push_back(snapshot);
+}
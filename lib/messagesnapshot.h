@@ -0,0 +1,75 @@
+/*!
+* \file
+* \brief messagesnapshot.h foo
+*/
+
+#ifndef MESSAGESNAPSHOT_H
+#define MESSAGESNAPSHOT_H
+
+#include "signallayout.h"
+#include "value.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+class CANMessage;
+class CANSignal;
+
+// Number of signals tracked individually in the changed signal mask
+#define MESSAGE_SNAPSHOT_MAX_SIGNALS 512
+#define MESSAGE_SNAPSHOT_MASK_WORDS (MESSAGE_SNAPSHOT_MAX_SIGNALS / 64)
+
+/*!
+ * Received message content at one point of time.
+ * Snapshot holds the raw payload and the mask of changed signals, indexed in the
+ * order of CANMessage::getSignals(). Names, layouts and conversions are taken
+ * from the configured message, so values are decoded only when requested.
+ */
+class MessageSnapshot
+{
+    friend class CANMessage;
+    friend class MessageSnapshotPool;
+
+public:
+    MessageSnapshot();
+    const CANMessage *getMessage() const { return m_message; }
+    std::uint32_t getId() const { return m_id; }
+    const std::chrono::time_point<std::chrono::system_clock> &getTimestamp() const { return m_timestamp; }
+    const std::uint8_t *getPayload() const { return m_payload; }
+    std::uint8_t getLength() const { return m_length; }
+    bool isChanged(std::size_t index) const;
+    Value getValue(const CANSignal &signal) const;
+
+private:
+    const CANMessage *m_message;
+    std::uint32_t m_id;
+    std::chrono::time_point<std::chrono::system_clock> m_timestamp;
+    std::uint8_t m_length;
+    std::uint8_t m_payload[SIGNAL_LAYOUT_PAYLOAD_SIZE];
+    std::uint64_t m_changed[MESSAGE_SNAPSHOT_MASK_WORDS];
+    bool m_pooled;
+};
+
+/*!
+ * Preallocated snapshots shared between the reader thread and the consumers.
+ * Snapshots are taken with acquire() and must be given back with release().
+ */
+class MessageSnapshotPool
+{
+public:
+    explicit MessageSnapshotPool(std::size_t capacity);
+    MessageSnapshot *acquire();
+    void release(MessageSnapshot *snapshot);
+
+private:
+    std::mutex m_mutex;
+    std::vector<MessageSnapshot> m_snapshots;
+    std::vector<MessageSnapshot *> m_free;
+
+    // Do not copy MessageSnapshotPool
+    MessageSnapshotPool(const MessageSnapshotPool&);
+};
+
+#endif // MESSAGESNAPSHOT_H
@@ -4,7 +4,7 @@
  */
 
 #include "metrics.h"
-#include <chrono>
+#include "canfd.h"
 #include <cstring>
 #include <fstream>
 #include <iomanip>
@@ -12,9 +12,6 @@
 #include <string.h>
 #include <time.h>
 
-// Previously calculated CAN frame size standard
-#define FRAME_SIZE 33
-
 const char *MetricsCollectorException::what() const throw()
 {
      return "MetricsCollectorException";
@@ -44,8 +41,9 @@ MetricsCollector::MetricsCollector(CANSimulatorCore *canSimulator, const std::st
     memset(&m_burstMetrics, 0, sizeof(struct burstMetrics));
 
     m_bitrate = canSimulator->getCANBitrate();
+    m_dataBitrate = canSimulator->getCANDataBitrate();
     m_burstMetrics.min = -1;
-    m_start = std::chrono::high_resolution_clock::now();
+    m_start = canSimulator->getClock().now();
 }
 
 /*!
@@ -76,14 +74,16 @@ void MetricsCollector::updateMessage(const CANMessage *message)
         // Set message false direction count
         newMessage.falseDirection = message->getFalseDirection();
 
-        // Calculate message bitsize
-        newMessage.messageSize = FRAME_SIZE + (message->getDlc() * 8) + ((newMessage.std) ? CAN_SFF_ID_BITS : CAN_EFF_ID_BITS);
+        // Calculate message bitsize, CAN FD data phase may use faster data bitrate
+        canFrameBits bits = canFrameBitCount(!newMessage.std, message->getDlc(), message->isCANFD(), message->getBitRateSwitch());
+        newMessage.messageSize = bits.nominal + bits.data;
+        float nominalBits = canFrameNominalBits(bits, m_bitrate, m_dataBitrate);
         // Calculate time message will take to send (if no bitrate, assume 1usec/bit)
         float uSecFactor = (m_bitrate > 0) ? ((1000000 / (float)m_bitrate)) : 1;
-        newMessage.messageTime = newMessage.messageSize * uSecFactor;
+        newMessage.messageTime = nominalBits * uSecFactor;
         // Calculate possible idle sending time (only with sending messages)
         if ((m_rateFactor > 0 || m_delayTime > 0) && (message->getDirection() == MessageDirection::SEND)) {
-            newMessage.idleTime = ((m_rateFactor > 0) ? (newMessage.messageSize * m_rateFactor) : m_delayTime) - newMessage.messageTime;
+            newMessage.idleTime = ((m_rateFactor > 0) ? (nominalBits * m_rateFactor) : m_delayTime) - newMessage.messageTime;
             // As idle time may be below zero, no idle time needed
             if (newMessage.idleTime < 0) {
                 newMessage.idleTime = 0;
@@ -313,10 +313,53 @@ bool MetricsCollector::writeErrorData(std::ofstream &file) const
             "Total unknown" + m_valueSeparator +
             "Unknown time (usec)\n";
         float uSecFactor = (m_bitrate > 0) ? ((1000000 / (float)m_bitrate)) : 1;
+        canFrameBits unknownBits;
+        unknownBits.nominal = error.unknownSize;
+        unknownBits.data = error.unknownDataSize;
         writer << error.errorMessages << m_valueSeparator
             << (error.errorSize * uSecFactor) << m_valueSeparator
             << error.unknownMessages << m_valueSeparator
-            << (error.unknownSize * uSecFactor) << '\n';
+            << (canFrameNominalBits(unknownBits, m_bitrate, m_dataBitrate) * uSecFactor) << '\n';
+        file << writer.str();
+        return true;
+    }
+    return false;
+}
+
+/*!
+ * \brief MetricsCollector::writeTimingData
+ * Write sender timing percentiles to a given file
+ * \param file: reference to previously opened target file
+ * \return true if wrote data, false if didn't
+ */
+bool MetricsCollector::writeTimingData(std::ofstream &file) const
+{
+    std::stringstream writer;
+    if (file.is_open()) {
+        file << std::string("\nTIMING DATA\n") +
+            "Metric" + m_valueSeparator +
+            "Count" + m_valueSeparator +
+            "p50 (usec)" + m_valueSeparator +
+            "p99 (usec)" + m_valueSeparator +
+            "p99.9 (usec)" + m_valueSeparator +
+            "Max (usec)\n";
+        auto writeRow = [&](const std::string &name, const struct latencyMetrics &latency) {
+            writer << name << m_valueSeparator
+                << latency.count << m_valueSeparator
+                << (latency.p50 / 1000.0) << m_valueSeparator
+                << (latency.p99 / 1000.0) << m_valueSeparator
+                << (latency.p999 / 1000.0) << m_valueSeparator
+                << (latency.max / 1000.0) << '\n';
+        };
+        writeRow("Scheduling lateness", getSchedulingLateness());
+        writeRow("Loop duration", getLoopDuration());
+        const std::vector<CANMessage> &messages = m_canSimulator->getMessages();
+        for (auto it = messages.begin(); it != messages.end(); ++it) {
+            struct latencyMetrics period;
+            if (getPeriodError(it->getId(), period) && period.count > 0) {
+                writeRow("Period error " + std::to_string(it->getId()), period);
+            }
+        }
         file << writer.str();
         return true;
     }
@@ -343,6 +386,9 @@ bool MetricsCollector::writeToFile(std::string target, bool test)
         updateTotal();
         success = success && writeTotalData(file);
         success = success && writeErrorData(file);
+        if (m_canSimulator->getSchedulingLateness().getCount() > 0) {
+            success = success && writeTimingData(file);
+        }
 
         if (m_burstMetrics.totalCount > 0) {
             updateBurstIdleTime();
@@ -371,6 +417,60 @@ struct totalMetrics &MetricsCollector::getTotalMetrics(bool test)
     return m_totalMetrics;
 }
 
+/*!
+ * \brief MetricsCollector::summarize
+ * Get percentiles of a histogram
+ * \param histogram: Histogram of durations in nanoseconds
+ * \return latencyMetrics structure
+ */
+struct latencyMetrics MetricsCollector::summarize(const LatencyHistogram &histogram)
+{
+    struct latencyMetrics latency;
+    latency.count = histogram.getCount();
+    latency.p50 = histogram.getPercentile(50);
+    latency.p99 = histogram.getPercentile(99);
+    latency.p999 = histogram.getPercentile(99.9);
+    latency.max = histogram.getMax();
+    return latency;
+}
+
+/*!
+ * \brief MetricsCollector::getSchedulingLateness
+ * Get percentiles of how late the sender handled scheduled sends
+ * \return latencyMetrics structure
+ */
+struct latencyMetrics MetricsCollector::getSchedulingLateness() const
+{
+    return summarize(m_canSimulator->getSchedulingLateness());
+}
+
+/*!
+ * \brief MetricsCollector::getLoopDuration
+ * Get percentiles of time used by each round of the sender
+ * \return latencyMetrics structure
+ */
+struct latencyMetrics MetricsCollector::getLoopDuration() const
+{
+    return summarize(m_canSimulator->getLoopDuration());
+}
+
+/*!
+ * \brief MetricsCollector::getPeriodError
+ * Get percentiles of deviations of send intervals from the cycle time of a cyclic message
+ * \param id: ID of the wanted message
+ * \param period: Set to percentiles of the message
+ * \return true if message has been sent cyclically, false otherwise
+ */
+bool MetricsCollector::getPeriodError(std::uint32_t id, struct latencyMetrics &period) const
+{
+    const LatencyHistogram *histogram = m_canSimulator->getPeriodError(id);
+    if (!histogram) {
+        return false;
+    }
+    period = summarize(*histogram);
+    return true;
+}
+
 /*!
  * \brief MetricsCollector::getBurstMetrics
  * Get reference to burst metrics
@@ -427,22 +527,21 @@ std::map<std::uint32_t, messageMetrics> &MetricsCollector::getMessageMetrics(boo
  */
 void MetricsCollector::updateMessages()
 {
-    std::map<std::uint32_t, CANMessage> const messages = m_canSimulator->getMessages();
+    const std::vector<CANMessage> &messages = m_canSimulator->getMessages();
     for (auto it = messages.begin(); it != messages.end(); ++it) {
-        updateMessage(&it->second);
+        updateMessage(&*it);
     }
 }
 
 /*!
  * \brief MetricsCollector::getCurrentTime
- * Get current time as a string
+ * Get current time of the simulator clock as a string
  * \return string to current time
  */
-std::string MetricsCollector::getCurrentTime()
+std::string MetricsCollector::getCurrentTime() const
 {
-    time_t rawtime;
+    time_t rawtime = m_canSimulator->getClock().wallTime() / 1000000000ULL;
     struct tm ptm;
-    time(&rawtime);
     std::stringstream ret;
 
     localtime_r(&rawtime, &ptm);
@@ -483,7 +582,5 @@ void MetricsCollector::updateTotal()
         m_totalMetrics.totalMessages += it->second.successful + it->second.failed + it->second.falseDirection;
         m_totalMetrics.totalFalseDirection += it->second.falseDirection;
     }
-    hires_timer now = std::chrono::high_resolution_clock::now();
-    auto elapsed = now - m_start;
-    m_totalMetrics.totalRuntime = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    m_totalMetrics.totalRuntime = (m_canSimulator->getClock().now() - m_start) / 1000;
 }
@@ -8,14 +8,11 @@
 
 #include "canmessage.h"
 #include "cansimulatorcore.h"
-#include <chrono>
 #include <cstdint>
 #include <exception>
 #include <map>
 #include <string>
 
-typedef std::chrono::high_resolution_clock::time_point hires_timer;
-
 class MetricsCollectorException : public std::exception
 {
 public:
@@ -61,6 +58,14 @@ struct burstMetrics {
     int count;                  // Current burst send counter (if more than 0, not yet added to totalCount)
 };
 
+struct latencyMetrics {
+    std::uint64_t count;        // Number of recorded values
+    std::uint64_t p50;          // Median in nanoseconds
+    std::uint64_t p99;          // 99th percentile in nanoseconds
+    std::uint64_t p999;         // 99.9th percentile in nanoseconds
+    std::uint64_t max;          // Maximum in nanoseconds
+};
+
 class MetricsCollector
 {
 public:
@@ -81,35 +86,41 @@ public:
     struct burstMetrics &getBurstMetrics(bool test = false);
     struct messageMetrics *getSingleMessageMetrics(std::uint32_t id, bool test = false);
     std::map<std::uint32_t, messageMetrics> &getMessageMetrics(bool test = false);
+    struct latencyMetrics getSchedulingLateness() const;
+    struct latencyMetrics getLoopDuration() const;
+    bool getPeriodError(std::uint32_t id, struct latencyMetrics &period) const;
+    static struct latencyMetrics summarize(const LatencyHistogram &histogram);
 
     void updateMessages();
     void updateMessage(const CANMessage *message);
 
     // For testing only
-    void forceBitrate(int bitrate) { m_bitrate = bitrate; }
+    void forceBitrate(int bitrate, int dataBitrate = 0) { m_bitrate = bitrate; m_dataBitrate = dataBitrate; }
 private:
     struct totalMetrics m_totalMetrics;
     struct burstMetrics m_burstMetrics;
 
     // CAN information
     int m_bitrate;
+    int m_dataBitrate;
     float m_rateFactor;
     int m_delayTime;
     char m_valueSeparator;
     CANSimulatorCore *m_canSimulator;
 
-    hires_timer m_start;
+    std::uint64_t m_start;
     std::string m_outputFile;
 
     std::map<std::uint32_t, messageMetrics> m_messageMetrics;
 
-    static std::string getCurrentTime();
+    std::string getCurrentTime() const;
     void updateTotal();
 
     bool writeMessageData(std::ofstream &file) const;
     bool writeTotalData(std::ofstream &file) const;
     bool writeBurstData(std::ofstream &file) const;
     bool writeErrorData(std::ofstream &file) const;
+    bool writeTimingData(std::ofstream &file) const;
 };
 
 #endif // METRICS_H
@@ -26,7 +26,7 @@ public:
      */
     Queue()
     {
-        m_eventFd = eventfd(0, 0);
+        m_eventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
     }
 
     /*!
@@ -0,0 +1,173 @@
+/*!
+* \file
+* \brief reactor.cpp foo
+*/
+
+#include "reactor.h"
+#include "logger.h"
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+/*!
+ * \brief Reactor::Reactor
+ * Constructor
+ */
+Reactor::Reactor() :
+    m_stopped(false)
+{
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_shutdownFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_epollFd < 0 || m_shutdownFd < 0) {
+        LOG(LOG_ERR, "error=2 Cannot create event loop\n");
+        return;
+    }
+    struct epoll_event event = {};
+    event.events = EPOLLIN | EPOLLET;
+    event.data.fd = m_shutdownFd;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_shutdownFd, &event) < 0) {
+        LOG(LOG_ERR, "error=2 Cannot add shutdown event to event loop\n");
+    }
+}
+
+/*!
+ * \brief Reactor::~Reactor
+ * Destructor
+ */
+Reactor::~Reactor()
+{
+    if (m_epollFd >= 0) {
+        close(m_epollFd);
+    }
+    if (m_shutdownFd >= 0) {
+        close(m_shutdownFd);
+    }
+}
+
+/*!
+ * \brief Reactor::add
+ * Register file descriptor, events are edge triggered
+ * \param fd: File descriptor
+ * \param events: epoll events to wait for, such as EPOLLIN
+ * \param handler: Function called with the occurred events
+ * \return True if successful, false otherwise, errno is set by epoll_ctl.
+ */
+bool Reactor::add(int fd, std::uint32_t events, const Handler &handler)
+{
+    if (m_epollFd < 0 || fd < 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(m_mutex);
+    struct epoll_event event = {};
+    event.events = events | EPOLLET;
+    event.data.fd = fd;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        // Keep errno of epoll_ctl for the caller
+        int error = errno;
+        LOG(LOG_ERR, "error=2 Cannot add file descriptor %d to event loop\n", fd);
+        errno = error;
+        return false;
+    }
+    m_handlers[fd] = handler;
+    return true;
+}
+
+/*!
+ * \brief Reactor::remove
+ * Unregister file descriptor
+ * \param fd: File descriptor
+ * \return True if successful, false otherwise.
+ */
+bool Reactor::remove(int fd)
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (!m_handlers.erase(fd)) {
+        return false;
+    }
+    return epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, NULL) == 0;
+}
+
+/*!
+ * \brief Reactor::dispatch
+ * Wait for events and call their handlers
+ * \param timeout: Maximum time to wait in milliseconds, -1 to wait until an event or signal
+ * \return Number of handled events, 0 if interrupted by a signal, -1 on error or when stopped
+ */
+int Reactor::dispatch(int timeout)
+{
+    if (m_epollFd < 0 || m_stopped) {
+        return -1;
+    }
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    int count = epoll_wait(m_epollFd, events, REACTOR_MAX_EVENTS, timeout);
+    if (count < 0) {
+        if (errno == EINTR) {
+            return 0;
+        }
+        LOG(LOG_ERR, "error=2 Waiting for events failed\n");
+        return -1;
+    }
+    int handled = 0;
+    for (int index = 0; index < count && !m_stopped; ++index) {
+        int fd = events[index].data.fd;
+        if (fd == m_shutdownFd) {
+            continue;
+        }
+        Handler handler;
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            auto it = m_handlers.find(fd);
+            if (it == m_handlers.end()) {
+                continue;
+            }
+            handler = it->second;
+        }
+        handler(events[index].events);
+        ++handled;
+    }
+    return m_stopped ? -1 : handled;
+}
+
+/*!
+ * \brief Reactor::run
+ * Handle events until stopped
+ * \return True if stopped, false on error.
+ */
+bool Reactor::run()
+{
+    if (m_epollFd < 0) {
+        return false;
+    }
+    while (!m_stopped) {
+        if (dispatch() < 0 && !m_stopped) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief Reactor::stop
+ * Stop the event loop, wakes up a thread waiting for events
+ */
+void Reactor::stop()
+{
+    m_stopped = true;
+    if (m_shutdownFd >= 0) {
+        // Only async-signal-safe calls here, failure means the loop is already woken up
+        std::uint64_t value = 1;
+        ssize_t written = write(m_shutdownFd, &value, sizeof(value));
+        (void)written;
+    }
+}
+
+/*!
+ * \brief Reactor::isStopped
+ * Check whether the event loop has been stopped
+ * \return True if stopped, false otherwise.
+ */
+bool Reactor::isStopped() const
+{
+    return m_stopped;
+}
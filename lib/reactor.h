@@ -0,0 +1,50 @@
+/*!
+* \file
+* \brief reactor.h foo
+*/
+
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+
+// Maximum number of events handled per epoll_wait call
+#define REACTOR_MAX_EVENTS 16
+
+/*!
+ * Edge triggered epoll event loop.
+ * File descriptors are registered with a handler which is called in the thread
+ * running the loop. Handlers must consume all available input, since they are
+ * called again only when new input arrives. stop() is safe to call from other
+ * threads and from signal handlers.
+ */
+class Reactor
+{
+public:
+    typedef std::function<void(std::uint32_t events)> Handler;
+
+    Reactor();
+    ~Reactor();
+    bool add(int fd, std::uint32_t events, const Handler &handler);
+    bool remove(int fd);
+    int dispatch(int timeout = -1);
+    bool run();
+    void stop();
+    bool isStopped() const;
+
+private:
+    int m_epollFd;
+    int m_shutdownFd;
+    std::atomic<bool> m_stopped;
+    std::mutex m_mutex;
+    std::map<int, Handler> m_handlers;
+
+    // Do not copy Reactor
+    Reactor(const Reactor&);
+};
+
+#endif // REACTOR_H
@@ -0,0 +1,144 @@
+/*!
+* \file
+* \brief ringbuffer.h foo
+*/
+
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/*!
+ * Bounded queue between one producer and one consumer thread.
+ * Items are stored in preallocated slots, push() waits while the buffer is
+ * full and pop() waits while it is empty. The producer close()s the buffer
+ * after its last item, the consumer cancel()s it to stop the producer.
+ */
+template <typename T>
+class RingBuffer
+{
+public:
+    /*!
+     * \brief RingBuffer::RingBuffer
+     * Constructor
+     * \param capacity: Maximum number of buffered items, at least one
+     */
+    explicit RingBuffer(std::size_t capacity) :
+        m_items(capacity ? capacity : 1),
+        m_head(0),
+        m_count(0),
+        m_closed(false),
+        m_cancelled(false)
+    {
+    }
+
+    /*!
+     * \brief RingBuffer::push
+     * Add item to end of buffer, waits while the buffer is full
+     * \param item: Item to copy into the buffer
+     * \return True if added, false if the buffer was cancelled.
+     */
+    bool push(const T &item)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (m_count == m_items.size() && !m_cancelled) {
+            m_notFull.wait(lock);
+        }
+        if (m_cancelled) {
+            return false;
+        }
+        m_items[(m_head + m_count) % m_items.size()] = item;
+        ++m_count;
+        lock.unlock();
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    /*!
+     * \brief RingBuffer::pop
+     * Take first item of buffer, waits while the buffer is empty and not closed
+     * \param item: Set to the first item
+     * \return True if an item was taken, false if closed and empty or cancelled.
+     */
+    bool pop(T &item)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_count && !m_closed && !m_cancelled) {
+            m_notEmpty.wait(lock);
+        }
+        if (!m_count || m_cancelled) {
+            return false;
+        }
+        item = m_items[m_head];
+        m_head = (m_head + 1) % m_items.size();
+        --m_count;
+        lock.unlock();
+        m_notFull.notify_one();
+        return true;
+    }
+
+    /*!
+     * \brief RingBuffer::close
+     * Mark end of items, pop() returns false once the buffer is empty
+     */
+    void close()
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_closed = true;
+        m_notEmpty.notify_all();
+    }
+
+    /*!
+     * \brief RingBuffer::cancel
+     * Stop both threads, waiting push() and pop() calls return false
+     */
+    void cancel()
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_cancelled = true;
+        m_notFull.notify_all();
+        m_notEmpty.notify_all();
+    }
+
+    /*!
+     * \brief RingBuffer::reset
+     * Remove all items and open the buffer again, only when no thread is using it
+     */
+    void reset()
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_head = 0;
+        m_count = 0;
+        m_closed = false;
+        m_cancelled = false;
+    }
+
+    /*!
+     * \brief RingBuffer::size
+     * Get number of buffered items
+     * \return Number of items
+     */
+    std::size_t size()
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        return m_count;
+    }
+
+private:
+    std::vector<T> m_items;
+    std::size_t m_head;
+    std::size_t m_count;
+    bool m_closed;
+    bool m_cancelled;
+    std::mutex m_mutex;
+    std::condition_variable m_notFull;
+    std::condition_variable m_notEmpty;
+
+    // Do not copy RingBuffer
+    RingBuffer(const RingBuffer&);
+};
+
+#endif // RINGBUFFER_H
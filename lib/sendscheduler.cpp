@@ -0,0 +1,292 @@
+/*!
+* \file
+* \brief sendscheduler.cpp foo
+*/
+
+#include "sendscheduler.h"
+#include "logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+/*!
+ * \brief SendScheduler::SendScheduler
+ * Constructor
+ */
+SendScheduler::SendScheduler()
+{
+    m_timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    m_eventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_timerFd < 0 || m_eventFd < 0) {
+        LOG(LOG_WARN, "warning=2 Cannot create send scheduler timer, falling back to sleeping\n");
+    }
+}
+
+/*!
+ * \brief SendScheduler::~SendScheduler
+ * Destructor
+ */
+SendScheduler::~SendScheduler()
+{
+    if (m_timerFd >= 0) {
+        close(m_timerFd);
+    }
+    if (m_eventFd >= 0) {
+        close(m_eventFd);
+    }
+}
+
+/*!
+ * \brief SendScheduler::now
+ * Get current time of the scheduler clock
+ * \return CLOCK_MONOTONIC time in nanoseconds
+ */
+std::uint64_t SendScheduler::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (std::uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*!
+ * \brief SendScheduler::schedule
+ * Add deadline of a message
+ * \param id: CAN message ID
+ * \param deadline: Absolute time in nanoseconds
+ * \param event: Reason of the send
+ * \param bus: Index of the bus sending the message
+ */
+void SendScheduler::schedule(std::uint32_t id, std::uint64_t deadline, SendEvent event, unsigned int bus)
+{
+    m_deadlines.push(entry(deadline, id, event, bus));
+}
+
+/*!
+ * \brief SendScheduler::popDue
+ * Take earliest deadline if it has been reached
+ * \param now: Current time in nanoseconds
+ * \param id: Set to CAN message ID of the deadline
+ * \param deadline: Set to the deadline
+ * \param event: Set to reason of the send
+ * \return True if a deadline was due, false otherwise.
+ */
+bool SendScheduler::popDue(std::uint64_t now, std::uint32_t &id, std::uint64_t &deadline, SendEvent &event)
+{
+    unsigned int bus;
+    return popDue(now, id, deadline, event, bus);
+}
+
+/*!
+ * \brief SendScheduler::popDue
+ * Take earliest deadline of any bus if it has been reached
+ * \param now: Current time in nanoseconds
+ * \param id: Set to CAN message ID of the deadline
+ * \param deadline: Set to the deadline
+ * \param event: Set to reason of the send
+ * \param bus: Set to index of the bus sending the message
+ * \return True if a deadline was due, false otherwise.
+ */
+bool SendScheduler::popDue(std::uint64_t now, std::uint32_t &id, std::uint64_t &deadline, SendEvent &event,
+                           unsigned int &bus)
+{
+    if (m_deadlines.empty() || std::get<0>(m_deadlines.top()) > now) {
+        return false;
+    }
+    deadline = std::get<0>(m_deadlines.top());
+    id = std::get<1>(m_deadlines.top());
+    event = std::get<2>(m_deadlines.top());
+    bus = std::get<3>(m_deadlines.top());
+    m_deadlines.pop();
+    return true;
+}
+
+/*!
+ * \brief SendScheduler::nextDeadline
+ * Get earliest deadline
+ * \return Absolute time in nanoseconds, SEND_SCHEDULER_NEVER if nothing is scheduled
+ */
+std::uint64_t SendScheduler::nextDeadline() const
+{
+    return m_deadlines.empty() ? SEND_SCHEDULER_NEVER : std::get<0>(m_deadlines.top());
+}
+
+/*!
+ * \brief SendScheduler::clear
+ * Remove all deadlines
+ */
+void SendScheduler::clear()
+{
+    m_deadlines = std::priority_queue<entry, std::vector<entry>, std::greater<entry>>();
+}
+
+/*!
+ * \brief SendScheduler::wait
+ * Sleep until absolute deadline or until notified
+ * \param deadline: Absolute time in nanoseconds, SEND_SCHEDULER_NEVER to wait only for notification
+ * \return True if woken by notify(), false otherwise.
+ */
+bool SendScheduler::wait(std::uint64_t deadline)
+{
+    if (m_timerFd < 0 || m_eventFd < 0) {
+        if (deadline == SEND_SCHEDULER_NEVER) {
+            // Nothing to notify with, poll for changes at 10 millisecond intervals
+            deadline = now() + 10000000ULL;
+        }
+        struct timespec ts;
+        ts.tv_sec = deadline / 1000000000ULL;
+        ts.tv_nsec = deadline % 1000000000ULL;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        }
+        return false;
+    }
+
+    arm(deadline);
+    struct pollfd fds[2];
+    fds[0].fd = m_timerFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_eventFd;
+    fds[1].events = POLLIN;
+    if (poll(fds, 2, -1) <= 0) {
+        return false;
+    }
+    return acknowledge();
+}
+
+/*!
+ * \brief SendScheduler::arm
+ * Set timer file descriptor to become readable at absolute deadline
+ * \param deadline: Absolute time in nanoseconds, SEND_SCHEDULER_NEVER to disarm
+ */
+void SendScheduler::arm(std::uint64_t deadline)
+{
+    if (m_timerFd < 0) {
+        return;
+    }
+    struct itimerspec timer = {};
+    if (deadline != SEND_SCHEDULER_NEVER) {
+        timer.it_value.tv_sec = deadline / 1000000000ULL;
+        timer.it_value.tv_nsec = deadline % 1000000000ULL;
+        if (!timer.it_value.tv_sec && !timer.it_value.tv_nsec) {
+            // Zero would disarm the timer
+            timer.it_value.tv_nsec = 1;
+        }
+    }
+    timerfd_settime(m_timerFd, TFD_TIMER_ABSTIME, &timer, NULL);
+}
+
+/*!
+ * \brief SendScheduler::acknowledge
+ * Consume pending timer expiration and notifications
+ * \return True if notified with notify(), false otherwise.
+ */
+bool SendScheduler::acknowledge()
+{
+    std::uint64_t value;
+    if (m_timerFd >= 0 && read(m_timerFd, &value, sizeof(value)) < 0) {
+        value = 0;
+    }
+    return m_eventFd >= 0 && read(m_eventFd, &value, sizeof(value)) > 0;
+}
+
+/*!
+ * \brief SendScheduler::notify
+ * Wake up thread sleeping in wait()
+ */
+void SendScheduler::notify()
+{
+    if (m_eventFd >= 0) {
+        std::uint64_t value = 1;
+        if (write(m_eventFd, &value, sizeof(value)) < 0) {
+            LOG(LOG_DBG, "Send scheduler already notified\n");
+        }
+    }
+}
+
+/*!
+ * \brief comparePhases
+ * Order messages for offset assignment: shortest cycle first, then longest frame, then CAN ID
+ * \param a: First message
+ * \param b: Second message
+ * \return True if a is assigned before b
+ */
+static bool comparePhases(const SendPhase *a, const SendPhase *b)
+{
+    if (a->cycleTime != b->cycleTime) {
+        return a->cycleTime < b->cycleTime;
+    }
+    if (a->bits != b->bits) {
+        return a->bits > b->bits;
+    }
+    return a->id < b->id;
+}
+
+/*!
+ * \brief assignPhaseOffsets
+ * Assign offsets to cyclic messages so that their sends are spread over the cycle.
+ * Bus load is tracked in 1 millisecond slots over the least common multiple of
+ * cycle times (at most SEND_PHASE_HORIZON), and each message is placed greedily
+ * at the offset which minimises the peak load of the slots it occupies.
+ * Configured offsets are kept and taken into account for the other messages.
+ * \param messages: Cyclic messages, offsets are updated in place
+ */
+void assignPhaseOffsets(std::vector<SendPhase> &messages)
+{
+    std::uint64_t horizon = 1;
+    for (auto it = messages.begin(); it != messages.end(); ++it) {
+        if (it->cycleTime == 0) {
+            continue;
+        }
+        std::uint64_t a = horizon;
+        std::uint64_t b = it->cycleTime;
+        while (b) {
+            std::uint64_t t = a % b;
+            a = b;
+            b = t;
+        }
+        horizon = std::min<std::uint64_t>(horizon / a * it->cycleTime, SEND_PHASE_HORIZON);
+    }
+    std::vector<std::uint64_t> load(horizon, 0);
+
+    // Configured offsets first, then the rest by priority
+    std::vector<SendPhase *> order;
+    for (auto it = messages.begin(); it != messages.end(); ++it) {
+        if (it->cycleTime == 0) {
+            it->offset = 0;
+            continue;
+        }
+        if (it->offset >= 0) {
+            it->offset %= it->cycleTime;
+            for (std::uint64_t slot = it->offset; slot < horizon; slot += it->cycleTime) {
+                load[slot] += it->bits;
+            }
+        } else {
+            order.push_back(&*it);
+        }
+    }
+    std::sort(order.begin(), order.end(), comparePhases);
+
+    for (auto it = order.begin(); it != order.end(); ++it) {
+        SendPhase &phase = **it;
+        std::uint64_t candidates = std::min<std::uint64_t>(phase.cycleTime, horizon);
+        std::uint64_t bestPeak = UINT64_MAX;
+        std::uint64_t bestOffset = 0;
+        for (std::uint64_t offset = 0; offset < candidates; ++offset) {
+            std::uint64_t peak = 0;
+            for (std::uint64_t slot = offset; slot < horizon && peak < bestPeak; slot += phase.cycleTime) {
+                peak = std::max(peak, load[slot]);
+            }
+            if (peak < bestPeak) {
+                bestPeak = peak;
+                bestOffset = offset;
+            }
+        }
+        phase.offset = bestOffset;
+        for (std::uint64_t slot = bestOffset; slot < horizon; slot += phase.cycleTime) {
+            load[slot] += phase.bits;
+        }
+    }
+}
@@ -0,0 +1,78 @@
+/*!
+* \file
+* \brief sendscheduler.h foo
+*/
+
+#ifndef SENDSCHEDULER_H
+#define SENDSCHEDULER_H
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+// Deadline which is never reached
+#define SEND_SCHEDULER_NEVER UINT64_MAX
+// Longest load pattern considered when assigning phase offsets, in milliseconds
+#define SEND_PHASE_HORIZON 10000
+
+/*!
+ * Cyclic message for phase offset assignment
+ */
+struct SendPhase {
+    std::uint32_t id;           // CAN message ID
+    unsigned int cycleTime;     // Cycle time in milliseconds
+    unsigned int bits;          // Frame length in bits
+    int offset;                 // Offset in milliseconds from start of cycle, negative to assign automatically
+};
+
+// Reason of a scheduled send
+enum class SendEvent {
+    CYCLIC = 0,     // Cycle time of a cyclic message
+    IF_ACTIVE,      // Fast cycle time of a message sent while active
+    REPETITION,     // Fast cycle time of repetitions after a change
+    DELAYED,        // Change postponed by the minimum delay time
+    RETRY           // Send held back by the bus load limit
+};
+
+void assignPhaseOffsets(std::vector<SendPhase> &messages);
+
+/*!
+ * Deadline queue of scheduled CAN message sends.
+ * Deadlines are absolute CLOCK_MONOTONIC times in nanoseconds. The sender thread
+ * sleeps in wait() until the earliest deadline, other threads can wake it with
+ * notify() when on change messages need to be sent. Event loops can instead
+ * wait for the timer and event file descriptors, arm() the timer and
+ * acknowledge() the events themselves. Messages of several buses share the
+ * queue, each deadline carries the index of its bus.
+ */
+class SendScheduler
+{
+public:
+    SendScheduler();
+    ~SendScheduler();
+    static std::uint64_t now();
+    void schedule(std::uint32_t id, std::uint64_t deadline, SendEvent event = SendEvent::CYCLIC, unsigned int bus = 0);
+    bool popDue(std::uint64_t now, std::uint32_t &id, std::uint64_t &deadline, SendEvent &event);
+    bool popDue(std::uint64_t now, std::uint32_t &id, std::uint64_t &deadline, SendEvent &event, unsigned int &bus);
+    std::uint64_t nextDeadline() const;
+    void clear();
+    bool wait(std::uint64_t deadline);
+    void notify();
+    int getTimerFd() const { return m_timerFd; }
+    int getEventFd() const { return m_eventFd; }
+    void arm(std::uint64_t deadline);
+    bool acknowledge();
+
+private:
+    typedef std::tuple<std::uint64_t, std::uint32_t, SendEvent, unsigned int> entry;
+    std::priority_queue<entry, std::vector<entry>, std::greater<entry>> m_deadlines;
+    int m_timerFd;
+    int m_eventFd;
+
+    // Do not copy SendScheduler
+    SendScheduler(const SendScheduler&);
+};
+
+#endif // SENDSCHEDULER_H
@@ -0,0 +1,39 @@
+/*!
+* \file
+* \brief signalhandle.h foo
+*/
+
+#ifndef SIGNALHANDLE_H
+#define SIGNALHANDLE_H
+
+#include <cstddef>
+
+class CANMessage;
+class CANSignal;
+class Configuration;
+
+/*!
+ * Resolved variable of the configuration.
+ * Handles are obtained once by variable name with Configuration::getSignalHandle()
+ * and used for getting and setting values without name lookups. A handle stays
+ * valid as long as the configuration it was obtained from. Handles obtained with
+ * CANSimulatorCore::getSignalHandle() also refer to the bus of the variable.
+ */
+class SignalHandle
+{
+    friend class Configuration;
+    friend class CANSimulatorCore;
+
+public:
+    SignalHandle() : m_message(NULL), m_signal(NULL), m_outgoing(false), m_bus(0) {}
+    bool isValid() const { return m_signal != NULL; }
+    bool isOutgoing() const { return m_outgoing; }
+
+private:
+    CANMessage *m_message;
+    CANSignal *m_signal;
+    bool m_outgoing;
+    unsigned int m_bus;     // Index of the bus in CANSimulatorCore, primary bus for other handles
+};
+
+#endif // SIGNALHANDLE_H
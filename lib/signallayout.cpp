@@ -0,0 +1,136 @@
+/*!
+* \file
+* \brief signallayout.cpp foo
+*/
+
+#include "signallayout.h"
+
+/*!
+ * \brief SignalLayout::SignalLayout
+ * Constructor for an empty layout
+ */
+SignalLayout::SignalLayout() :
+    order(ByteOrder::INTEL),
+    singleWord(true),
+    wordOffset(0),
+    shift(0),
+    length(0),
+    signBits(0),
+    firstByte(0),
+    lastByte(0),
+    mask(0),
+    maskWord(0),
+    payloadMask(),
+    m_lsbPosition(0)
+{
+}
+
+/*!
+ * \brief SignalLayout::SignalLayout
+ * Constructor, compile layout of a signal
+ * \param byteOrder: Byte order of the signal
+ * \param startBit: Start bit of the signal as defined in dbc file
+ * \param bitLength: Length of the signal in bits
+ * \param sign: Signedness of the signal
+ */
+SignalLayout::SignalLayout(ByteOrder byteOrder, unsigned int startBit, unsigned int bitLength, Sign sign) :
+    order(byteOrder),
+    singleWord(false),
+    wordOffset(0),
+    shift(0),
+    length(bitLength),
+    signBits((sign == Sign::SIGNED) ? bitLength : 0),
+    firstByte(0),
+    lastByte(0),
+    mask(0),
+    maskWord(0),
+    payloadMask(),
+    m_lsbPosition(0)
+{
+    if (bitLength == 0 || bitLength > 64) {
+        length = 0;
+        signBits = 0;
+        singleWord = true;
+        return;
+    }
+    mask = (bitLength == 64) ? ~0ULL : ((1ULL << bitLength) - 1);
+
+    // Position of the signal in the payload bit string. Intel signals are
+    // numbered from the least significant bit of the first byte, Motorola
+    // signals from the most significant bit of the first byte.
+    unsigned int firstPosition;
+    unsigned int lastPosition;
+    if (order == ByteOrder::INTEL) {
+        firstPosition = startBit;
+        lastPosition = startBit + bitLength - 1;
+        m_lsbPosition = firstPosition;
+    } else {
+        firstPosition = (startBit / 8) * 8 + (7 - startBit % 8);
+        lastPosition = firstPosition + bitLength - 1;
+        m_lsbPosition = lastPosition;
+    }
+    if (lastPosition >= SIGNAL_LAYOUT_PAYLOAD_SIZE * 8) {
+        // Signal does not fit to the payload, leave it empty
+        length = 0;
+        signBits = 0;
+        mask = 0;
+        singleWord = true;
+        return;
+    }
+    firstByte = firstPosition / 8;
+    lastByte = lastPosition / 8;
+
+    // Load the word starting from the first byte, unless it would overrun the payload
+    wordOffset = (firstByte + 8 > SIGNAL_LAYOUT_PAYLOAD_SIZE) ? SIGNAL_LAYOUT_PAYLOAD_SIZE - 8 : firstByte;
+    singleWord = lastByte < wordOffset + 8;
+    if (order == ByteOrder::INTEL) {
+        shift = firstPosition - wordOffset * 8;
+    } else {
+        shift = 63 - (lastPosition - wordOffset * 8);
+    }
+    initPayloadMask();
+}
+
+/*!
+ * \brief SignalLayout::initPayloadMask
+ * Compute bits of the signal in native 64-bit payload words for change detection
+ */
+void SignalLayout::initPayloadMask()
+{
+    uint8_t payload[(SIGNAL_LAYOUT_DIFF_WORDS) * 8] = {0};
+    insert(payload, ~0ULL);
+    maskWord = firstByte / 8;
+    memcpy(payloadMask, payload + maskWord * 8, sizeof(payloadMask));
+}
+
+/*!
+ * \brief SignalLayout::extractBits
+ * Extract raw value of the signal bit by bit, used when signal spans over nine bytes
+ * \param data: Pointer to payload
+ * \return Raw value of the signal
+ */
+uint64_t SignalLayout::extractBits(const uint8_t *data) const
+{
+    uint64_t value = 0;
+    for (unsigned int i = 0; i < length; ++i) {
+        unsigned int position = (order == ByteOrder::INTEL) ? m_lsbPosition + i : m_lsbPosition - i;
+        unsigned int bit = (order == ByteOrder::INTEL) ? position % 8 : 7 - position % 8;
+        value |= (uint64_t)((data[position / 8] >> bit) & 1) << i;
+    }
+    return value;
+}
+
+/*!
+ * \brief SignalLayout::insertBits
+ * Insert raw value of the signal bit by bit, used when signal spans over nine bytes
+ * \param data: Pointer to payload
+ * \param rawValue: Raw value of the signal
+ */
+void SignalLayout::insertBits(uint8_t *data, uint64_t rawValue) const
+{
+    for (unsigned int i = 0; i < length; ++i) {
+        unsigned int position = (order == ByteOrder::INTEL) ? m_lsbPosition + i : m_lsbPosition - i;
+        unsigned int bit = (order == ByteOrder::INTEL) ? position % 8 : 7 - position % 8;
+        data[position / 8] = (data[position / 8] & ~(1 << bit)) | (((rawValue >> i) & 1) << bit);
+    }
+}
@@ -0,0 +1,113 @@
+/*!
+* \file
+* \brief signallayout.h foo
+*/
+
+#ifndef SIGNALLAYOUT_H
+#define SIGNALLAYOUT_H
+
+#include <can-dbcparser/header/signal.hpp>
+#include <cstdint>
+#include <cstring>
+#include <endian.h>
+
+// Size of the payload buffer the layouts operate on (CAN FD maximum)
+#define SIGNAL_LAYOUT_PAYLOAD_SIZE 64
+// Number of native 64-bit words in payload difference given to isChanged()
+#define SIGNAL_LAYOUT_DIFF_WORDS (SIGNAL_LAYOUT_PAYLOAD_SIZE / 8 + 1)
+
+/*!
+ * Precompiled bit layout of a signal inside a CAN payload.
+ * The layout describes a single 64-bit word load from the payload, after which
+ * the raw value is found with one shift and one mask. Signals which span nine
+ * bytes (unaligned signals longer than 57 bits) cannot be reached with a single
+ * word and are handled bit by bit.
+ */
+struct SignalLayout
+{
+    SignalLayout();
+    SignalLayout(ByteOrder byteOrder, unsigned int startBit, unsigned int bitLength, Sign sign);
+
+    /*!
+     * \brief SignalLayout::extract
+     * Extract raw value of the signal from payload
+     * \param data: Pointer to SIGNAL_LAYOUT_PAYLOAD_SIZE bytes of payload
+     * \return Raw value of the signal, not sign extended
+     */
+    uint64_t extract(const uint8_t *data) const
+    {
+        if (!singleWord) {
+            return extractBits(data);
+        }
+        uint64_t word;
+        memcpy(&word, data + wordOffset, sizeof(word));
+        word = (order == ByteOrder::INTEL) ? le64toh(word) : be64toh(word);
+        return (word >> shift) & mask;
+    }
+
+    /*!
+     * \brief SignalLayout::insert
+     * Insert raw value of the signal to payload
+     * \param data: Pointer to SIGNAL_LAYOUT_PAYLOAD_SIZE bytes of payload
+     * \param rawValue: Raw value of the signal
+     */
+    void insert(uint8_t *data, uint64_t rawValue) const
+    {
+        if (!singleWord) {
+            insertBits(data, rawValue);
+            return;
+        }
+        uint64_t word;
+        memcpy(&word, data + wordOffset, sizeof(word));
+        word = (order == ByteOrder::INTEL) ? le64toh(word) : be64toh(word);
+        word = (word & ~(mask << shift)) | ((rawValue & mask) << shift);
+        word = (order == ByteOrder::INTEL) ? htole64(word) : htobe64(word);
+        memcpy(data + wordOffset, &word, sizeof(word));
+    }
+
+    /*!
+     * \brief SignalLayout::signExtend
+     * Sign extend raw value using the sign extension width of the signal
+     * \param rawValue: Raw value as returned by extract()
+     * \return Raw value sign extended to 64 bits
+     */
+    uint64_t signExtend(uint64_t rawValue) const
+    {
+        if (signBits == 0 || signBits >= 64) {
+            return rawValue;
+        }
+        uint64_t signMask = 1ULL << (signBits - 1);
+        return (rawValue ^ signMask) - signMask;
+    }
+
+    /*!
+     * \brief SignalLayout::isChanged
+     * Check whether any bit of the signal differs between two payloads
+     * \param diff: XOR of the payloads as SIGNAL_LAYOUT_DIFF_WORDS native 64-bit words
+     * \return True if signal bits differ, false otherwise.
+     */
+    bool isChanged(const uint64_t *diff) const
+    {
+        return (diff[maskWord] & payloadMask[0]) | (diff[maskWord + 1] & payloadMask[1]);
+    }
+
+    ByteOrder order;        // Byte order of the word load
+    bool singleWord;        // Signal is reachable with a single 64-bit word load
+    uint8_t wordOffset;     // Byte offset of the 64-bit word load in payload
+    uint8_t shift;          // Right shift of the loaded word to reach signal LSB
+    uint8_t length;         // Length of the signal in bits
+    uint8_t signBits;       // Sign extension width, 0 for unsigned signals
+    uint8_t firstByte;      // First payload byte touched by the signal
+    uint8_t lastByte;       // Last payload byte touched by the signal
+    uint64_t mask;          // Mask of the signal value after shift
+    uint8_t maskWord;       // First native 64-bit payload word touched by the signal
+    uint64_t payloadMask[2]; // Bits of the signal in native payload words maskWord and maskWord + 1
+
+private:
+    unsigned int m_lsbPosition; // Position of the signal LSB in the payload bit string
+    void initPayloadMask();
+    uint64_t extractBits(const uint8_t *data) const;
+    void insertBits(uint8_t *data, uint64_t rawValue) const;
+};
+
+#endif // SIGNALLAYOUT_H
@@ -0,0 +1,178 @@
+/*!
+* \file
+* \brief threadconfig.cpp foo
+*/
+
+#include "threadconfig.h"
+#include "logger.h"
+#include "stringtools.h"
+#include <cerrno>
+#include <cstring>
+#include <pthread.h>
+#include <stdexcept>
+#include <sys/capability.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+/*!
+ * \brief parseThreadConfig
+ * Parse thread configuration in format CPU[,POLICY[,PRIORITY]], where CPU may be empty
+ * for any CPU, POLICY is other, fifo or rr and PRIORITY defaults to the lowest real-time priority
+ * \param text: Thread configuration
+ * \param config: Parsed configuration
+ * \return True if successful, false otherwise.
+ */
+bool parseThreadConfig(const std::string &text, threadConfig &config)
+{
+    std::vector<std::string> items = split(text, ',');
+    threadConfig parsed;
+    if (items.empty() || items.size() > 3) {
+        return false;
+    }
+    try {
+        if (!items[0].empty()) {
+            std::size_t end;
+            parsed.cpu = std::stoi(items[0], &end);
+            if (end != items[0].size()) {
+                return false;
+            }
+        }
+        if (items.size() > 1) {
+            if (items[1] == "other") {
+                parsed.policy = SCHED_OTHER;
+            } else if (items[1] == "fifo") {
+                parsed.policy = SCHED_FIFO;
+            } else if (items[1] == "rr") {
+                parsed.policy = SCHED_RR;
+            } else {
+                return false;
+            }
+            parsed.priority = sched_get_priority_min(parsed.policy);
+        }
+        if (items.size() > 2) {
+            std::size_t end;
+            parsed.priority = std::stoi(items[2], &end);
+            if (end != items[2].size()) {
+                return false;
+            }
+        }
+    }
+    catch (const std::logic_error &) {
+        return false;
+    }
+    if (!isValidThreadConfig(parsed)) {
+        return false;
+    }
+    config = parsed;
+    return true;
+}
+
+/*!
+ * \brief isValidThreadConfig
+ * Check that the CPU exists and the priority is valid for the policy
+ * \param config: Thread configuration
+ * \return True if valid, false otherwise.
+ */
+bool isValidThreadConfig(const threadConfig &config)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_CONF);
+    if (config.cpu < -1 || config.cpu >= CPU_SETSIZE || (cpus > 0 && config.cpu >= cpus)) {
+        return false;
+    }
+    if (config.policy != SCHED_OTHER && config.policy != SCHED_FIFO && config.policy != SCHED_RR) {
+        return false;
+    }
+    return config.priority >= sched_get_priority_min(config.policy) &&
+           config.priority <= sched_get_priority_max(config.policy);
+}
+
+/*!
+ * \brief userHasSchedulingPermissions
+ * Check if user has permissions to set real-time scheduling
+ * \return True if user had needed permissions, otherwise false
+ */
+bool userHasSchedulingPermissions()
+{
+    cap_t caps;
+    caps = cap_get_proc();
+    bool ret = true;
+
+    if (caps == NULL) {
+        LOG(LOG_WARN, "warning=2 Unable read capabilities\n");
+        ret = false;
+    } else {
+        cap_flag_value_t val;
+        cap_get_flag(caps, CAP_SYS_NICE, CAP_PERMITTED, &val);
+        if (val != CAP_SET) {
+            ret = false;
+        }
+        cap_free(caps);
+    }
+    return ret;
+}
+
+/*!
+ * \brief prefaultStack
+ * Touch stack pages of the calling thread, locked memory keeps them resident
+ */
+static void __attribute__((noinline)) prefaultStack()
+{
+    unsigned char stack[THREAD_STACK_PREFAULT_SIZE];
+    memset(stack, 0, sizeof(stack));
+    // Keep the compiler from removing the writes
+    __asm__ __volatile__("" : : "r"(stack) : "memory");
+}
+
+/*!
+ * \brief applyThreadConfig
+ * Pin the calling thread to its CPU and set its scheduling policy
+ * \param config: Thread configuration
+ * \param prefault: Touch stack pages before the thread starts its work
+ * \return True if successful, false if any setting failed.
+ */
+bool applyThreadConfig(const threadConfig &config, bool prefault)
+{
+    bool ret = true;
+    if (config.cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(config.cpu, &cpus);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus)) {
+            LOG(LOG_WARN, "warning=2 Unable to pin thread to CPU %d\n", config.cpu);
+            ret = false;
+        }
+    }
+    if (config.policy != SCHED_OTHER) {
+        // Only try real-time scheduling with permission, like CAN interface control
+        if (!userHasSchedulingPermissions()) {
+            LOG(LOG_WARN, "warning=2 No permission to set real-time scheduling (CAP_SYS_NICE)\n");
+            ret = false;
+        } else {
+            struct sched_param param = {};
+            param.sched_priority = config.priority;
+            if (pthread_setschedparam(pthread_self(), config.policy, &param)) {
+                LOG(LOG_WARN, "warning=2 Unable to set thread scheduling policy\n");
+                ret = false;
+            }
+        }
+    }
+    if (prefault) {
+        prefaultStack();
+    }
+    return ret;
+}
+
+/*!
+ * \brief lockProcessMemory
+ * Lock current and future pages of the process in memory
+ * \return True if successful, false otherwise.
+ */
+bool lockProcessMemory()
+{
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+        LOG(LOG_WARN, "warning=2 Unable to lock memory: %s\n", strerror(errno));
+        return false;
+    }
+    return true;
+}
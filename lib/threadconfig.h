@@ -0,0 +1,36 @@
+/*!
+* \file
+* \brief threadconfig.h foo
+*/
+
+#ifndef THREADCONFIG_H
+#define THREADCONFIG_H
+
+#include <sched.h>
+#include <string>
+
+// Stack touched by a configured thread before it starts, so page faults do not stall its first rounds
+#define THREAD_STACK_PREFAULT_SIZE (256 * 1024)
+
+/*!
+ * CPU placement and scheduling of a simulator thread
+ */
+struct threadConfig {
+    int cpu;            // CPU the thread is pinned to, -1 for any CPU
+    int policy;         // Scheduling policy SCHED_OTHER, SCHED_FIFO or SCHED_RR
+    int priority;       // Static priority of SCHED_FIFO and SCHED_RR, 0 for SCHED_OTHER
+
+    threadConfig() : cpu(-1), policy(SCHED_OTHER), priority(0) {}
+};
+
+bool parseThreadConfig(const std::string &text, threadConfig &config);
+
+bool isValidThreadConfig(const threadConfig &config);
+
+bool userHasSchedulingPermissions();
+
+bool applyThreadConfig(const threadConfig &config, bool prefault);
+
+bool lockProcessMemory();
+
+#endif // THREADCONFIG_H
@@ -189,3 +189,45 @@ TEST(CLI_commandline_parser, filterModes) {
     ASSERT_TRUE(params.filterExclude);
     cleanup_testcase();
 }
+
+TEST(CLI_commandline_parser, bus_load) {
+    Logger::getLogger().setVerbosity(0);
+    char* argv[] = {strdup("test"), strdup("--cfg=foo.cfg"), strdup("--dbc=foo.dbc"), strdup("--bus-load=40"),
+        strdup("prompt"), NULL};
+    ASSERT_TRUE(parseCommandLineArguments(5, argv));
+    ASSERT_EQ(40, params.busLoad);
+    cleanup_testcase();
+
+    // Invalid and out of range values are rejected
+    const char *invalid[] = {"--bus-load=x", "--bus-load=101", "--bus-load=-1", "--bus-load=99999999999"};
+    for (const char *value : invalid) {
+        argv[3] = strdup(value);
+        ASSERT_FALSE(parseCommandLineArguments(5, argv)) << value;
+        cleanup_testcase();
+    }
+}
+
+TEST(CLI_commandline_parser, virtual_time) {
+    Logger::getLogger().setVerbosity(0);
+    char* argv[] = {strdup("test"), strdup("--cfg=foo.cfg"), strdup("--dbc=foo.dbc"), strdup("--virtual-time=1588000000"),
+        strdup("prompt"), NULL};
+    ASSERT_TRUE(parseCommandLineArguments(5, argv));
+    ASSERT_TRUE(params.virtualTime);
+    ASSERT_EQ(1588000000, params.virtualEpoch);
+    cleanup_testcase();
+
+    argv[3] = strdup("--virtual-time");
+    ASSERT_TRUE(parseCommandLineArguments(5, argv));
+    ASSERT_TRUE(params.virtualTime);
+    ASSERT_EQ(0, params.virtualEpoch);
+    cleanup_testcase();
+
+    // Negative values and values overflowing nanoseconds are rejected
+    const char *invalid[] = {"--virtual-time=x", "--virtual-time=-1", "--virtual-time=9223372037",
+                             "--virtual-time=99999999999999999999"};
+    for (const char *value : invalid) {
+        argv[3] = strdup(value);
+        ASSERT_FALSE(parseCommandLineArguments(5, argv)) << value;
+        cleanup_testcase();
+    }
+}
@@ -6,6 +6,8 @@
 #include "dummy_logger.h"
 
 #include "../lib/ascreader.cpp"
+#include "../lib/asctokenizer.cpp"
+#include "../lib/canfd.cpp"
 #include "../lib/stringtools.cpp"
 #include <linux/can.h>
 #include <gtest/gtest.h>
@@ -245,3 +247,130 @@ TEST(LIB_ascreader, missing_previous_file) {
     // Test missing previous log
     ASSERT_THROW(ASCReader *reader = new ASCReader("tests_missing.asc"), ASCReaderException);
 }
+
+TEST(LIB_ascreader, ascreader_canfd) {
+    ASCReader *reader = NULL;
+    ASSERT_NO_THROW(reader = new ASCReader("tests_canfd.asc"));
+    std::map<std::uint64_t, canFrameQueueItem> queue = reader->getFrameQueue();
+    ASSERT_EQ(4, queue.size());
+    std::map<std::uint64_t, canFrameQueueItem>::iterator it = queue.begin();
+    ASSERT_EQ(2501, it->second.timestamp);
+    ASSERT_EQ(0x128, it->second.frame.can_id);
+    ASSERT_EQ(8, it->second.frame.len);
+    ASSERT_EQ(0, it->second.frame.flags);
+    ++it;
+    ASSERT_EQ(2502, it->second.timestamp);
+    ASSERT_EQ(true, it->second.in);
+    ASSERT_EQ(0x129, it->second.frame.can_id);
+    ASSERT_EQ(12, it->second.frame.len);
+    ASSERT_EQ(CANFD_FDF | CANFD_BRS, it->second.frame.flags);
+    ASSERT_EQ(0, it->second.frame.data[0]);
+    ASSERT_EQ(0x0b, it->second.frame.data[11]);
+    ++it;
+    ASSERT_EQ(2503, it->second.timestamp);
+    ASSERT_EQ(false, it->second.in);
+    ASSERT_EQ(0x800000a8, it->second.frame.can_id);
+    ASSERT_EQ(64, it->second.frame.len);
+    ASSERT_EQ(CANFD_FDF | CANFD_ESI, it->second.frame.flags);
+    ASSERT_EQ(0x3f, it->second.frame.data[63]);
+    ++it;
+    ASSERT_EQ(2504, it->second.timestamp);
+    ASSERT_EQ(0x12a, it->second.frame.can_id);
+    ASSERT_EQ(5, it->second.frame.len);
+    ASSERT_EQ(CANFD_FDF | CANFD_BRS, it->second.frame.flags);
+    ASSERT_EQ(5, it->second.frame.data[4]);
+    ++it;
+    ASSERT_EQ(queue.end(), it);
+
+    delete reader;
+}
+
+TEST(LIB_ascreader, ascreader_streaming) {
+    ASCReader *reader = NULL;
+    // Prefetch smaller than the log makes the producer wait for the consumer
+    ASSERT_NO_THROW(reader = new ASCReader("tests_relative_second.asc", 1));
+    canFrameQueueItem item;
+    ASSERT_FALSE(reader->readFrame(item));
+    ASSERT_TRUE(reader->startStreaming());
+    std::map<std::uint64_t, canFrameQueueItem> queue = reader->getFrameQueue();
+    ASSERT_EQ(4, queue.size());
+    for (auto it = queue.begin(); it != queue.end(); ++it) {
+        ASSERT_TRUE(reader->readFrame(item));
+        ASSERT_EQ(it->second.timestamp, item.timestamp);
+        ASSERT_EQ(it->second.in, item.in);
+        ASSERT_EQ(0, memcmp(&it->second.frame, &item.frame, sizeof(item.frame)));
+    }
+    ASSERT_FALSE(reader->readFrame(item));
+
+    // Restarting streams again from the first frame, also when stopped early
+    ASSERT_TRUE(reader->startStreaming());
+    ASSERT_TRUE(reader->readFrame(item));
+    ASSERT_EQ(2501, item.timestamp);
+    ASSERT_TRUE(reader->startStreaming());
+    ASSERT_TRUE(reader->readFrame(item));
+    ASSERT_EQ(2501, item.timestamp);
+    reader->stopStreaming();
+    ASSERT_FALSE(reader->readFrame(item));
+
+    std::map<std::uint32_t, bool> ids;
+    ASSERT_TRUE(reader->createFilterList(ids));
+    ASSERT_EQ(2, ids.size());
+    ASSERT_EQ(1, ids.count(0x128));
+    delete reader;
+}
+
+static bool parseLine(const std::string &line, ascFormat &format, canFrameQueueItem &item) {
+    return ASCTokenizer::parseFrame(line.data(), line.data() + line.size(), format, item);
+}
+
+TEST(LIB_ascreader, asc_tokenizer) {
+    ascFormat format = {true, true, 0};
+    canFrameQueueItem item;
+    ASSERT_TRUE(parseLine("2.5009 1  128              Rx   d 8 00 01 02 03 04 05 06 07\r", format, item));
+    ASSERT_EQ(2501, item.timestamp);
+    ASSERT_TRUE(item.in);
+    ASSERT_EQ(0x128, item.frame.can_id);
+    ASSERT_EQ(8, item.frame.len);
+    ASSERT_EQ(7, item.frame.data[7]);
+    ASSERT_TRUE(parseLine("1.5\t1 1Fx Tx d 2 aA Bb", format, item));
+    ASSERT_EQ(1500, item.timestamp);
+    ASSERT_FALSE(item.in);
+    ASSERT_EQ(0x1f | CAN_EFF_FLAG, item.frame.can_id);
+    ASSERT_EQ(0xaa, item.frame.data[0]);
+    ASSERT_EQ(0xbb, item.frame.data[1]);
+    ASSERT_TRUE(parseLine("2.5020 CANFD   1 Rx        129  TEST_FD   1 0 9 12 00 01 02 03 04 05 06 07 08 09 0a 0b   130000  130",
+                          format, item));
+    ASSERT_EQ(0x129, item.frame.can_id);
+    ASSERT_EQ(12, item.frame.len);
+    ASSERT_EQ(CANFD_FDF | CANFD_BRS, item.frame.flags);
+    ASSERT_EQ(0x0b, item.frame.data[11]);
+    // Symbolic names starting with characters sorting before digits
+    ASSERT_TRUE(parseLine("2.5030 CANFD   1 Tx        12a  $TEST.FD   0 1 8 8 01 02 03 04 05 06 07 08", format, item));
+    ASSERT_EQ(0x12a, item.frame.can_id);
+    ASSERT_EQ(8, item.frame.len);
+    ASSERT_EQ(CANFD_FDF | CANFD_ESI, item.frame.flags);
+    ASSERT_EQ(0x08, item.frame.data[7]);
+    ASSERT_TRUE(parseLine("2.5031 CANFD   1 Tx        12a  -   1 0 2 2 01 02", format, item));
+    ASSERT_EQ(2, item.frame.len);
+    ASSERT_EQ(CANFD_FDF | CANFD_BRS, item.frame.flags);
+
+    // Lines other than data frames
+    ASSERT_FALSE(parseLine("", format, item));
+    ASSERT_FALSE(parseLine("End TriggerBlock", format, item));
+    ASSERT_FALSE(parseLine("2.7000 Start measurement", format, item));
+    ASSERT_FALSE(parseLine("2.7006 CAN 1 Status:chip status error active", format, item));
+    ASSERT_FALSE(parseLine("2.7100 1 Statistic: D 0 R 0 XD 0 XR 0 E 0 O 0 B 0.0%", format, item));
+    ASSERT_FALSE(parseLine("2.7020 1  ErrorFrame", format, item));
+    ASSERT_FALSE(parseLine("2.7020 1  128 Rx r", format, item));
+    ASSERT_FALSE(parseLine("2.7020 1  128 Rx d 8 00 01", format, item));
+    ASSERT_FALSE(parseLine("2.5040 CANFD 1 Rx 12a 1 0 5 8 01 02 03 04 05", format, item));
+
+    // Decimal IDs and relative timestamps
+    format.hexId = false;
+    format.absoluteTimestamps = false;
+    ASSERT_TRUE(parseLine("0.25 1 100 Rx d 0", format, item));
+    ASSERT_TRUE(parseLine("0.5 1 100 Rx d 0", format, item));
+    ASSERT_EQ(750, item.timestamp);
+    ASSERT_EQ(100, item.frame.can_id);
+    ASSERT_FALSE(parseLine("0.5 1 1a0 Rx d 0", format, item));
+}
@@ -0,0 +1,105 @@
+/*!
+* \file
+* \brief test_LIB_batchdecoder.cpp foo
+*/
+
+#include "dummy_logger.h"
+
+#include "../lib/admissioncontroller.cpp"
+#include "../lib/ascreader.cpp"
+#include "../lib/asctokenizer.cpp"
+#include "../lib/batchdecoder.cpp"
+#include "../lib/canfd.cpp"
+#include "../lib/canmessage.cpp"
+#include "../lib/cansignal.cpp"
+#include "../lib/clock.cpp"
+#include "../lib/cansimulatorcore.cpp"
+#include "../lib/cantransceiver.cpp"
+#include "../lib/configuration.cpp"
+#include "../lib/can-dbcparser/attribute.cpp"
+#include "../lib/can-dbcparser/dbciterator.cpp"
+#include "../lib/can-dbcparser/message.cpp"
+#include "../lib/can-dbcparser/signal.cpp"
+#include "../lib/latencyhistogram.cpp"
+#include "../lib/messagesnapshot.cpp"
+#include "../lib/reactor.cpp"
+#include "../lib/sendscheduler.cpp"
+#include "../lib/signallayout.cpp"
+#include "../lib/stringtools.cpp"
+#include "../lib/threadconfig.cpp"
+#include "../lib/unitconversion.cpp"
+#include "../lib/value.cpp"
+#include <linux/can.h>
+#include <gtest/gtest.h>
+
+std::vector<canfd_frame> random_canframes(std::uint32_t id, std::size_t count) {
+    std::vector<canfd_frame> frames(count);
+    for (auto it = frames.begin(); it != frames.end(); ++it) {
+        memset(&(*it), 0, sizeof(struct canfd_frame));
+        it->can_id = id;
+        for (int i = 0; i < 8; ++i) {
+            it->data[i] = rand() & 0xff;
+        }
+    }
+    return frames;
+}
+
+TEST(LIB_batchdecoder, test_decode) {
+    srand(testing::UnitTest::GetInstance()->random_seed());
+    Configuration *config = NULL;
+    ASSERT_NO_THROW(config = new Configuration("tests.cfg", "tests.dbc"));
+
+    for (auto it = config->getMessages().begin(); it != config->getMessages().end(); ++it) {
+        CANMessage *message = config->getMessage(it->getId());
+        // Odd count to exercise the scalar tail of the vector kernels
+        std::vector<canfd_frame> frames = random_canframes(it->getId(), 103);
+        BatchDecoder scalar(*message, BatchDecoderKernel::SCALAR);
+        BatchDecoder sse(*message, BatchDecoderKernel::SSE);
+        BatchDecoder avx2(*message);
+        ASSERT_EQ(BatchDecoderKernel::SCALAR, scalar.getKernel());
+        ASSERT_EQ(frames.size(), scalar.decode(frames.data(), frames.size()));
+        ASSERT_EQ(frames.size(), sse.decode(frames.data(), frames.size()));
+        ASSERT_EQ(frames.size(), avx2.decode(frames.data(), frames.size()));
+        ASSERT_EQ(message->getSignals().size(), scalar.getSignalCount());
+
+        std::size_t index = 0;
+        for (auto sig = message->getSignals().begin(); sig != message->getSignals().end(); ++sig, ++index) {
+            ASSERT_EQ(sig->first, scalar.getSignalName(index));
+            const SignalLayout &layout = sig->second.getLayout();
+            for (std::size_t i = 0; i < frames.size(); ++i) {
+                std::uint64_t expected = layout.signExtend(layout.extract(frames[i].data));
+                ASSERT_EQ(expected, scalar.getRawColumn(index)[i]);
+                ASSERT_EQ(expected, sse.getRawColumn(index)[i]);
+                ASSERT_EQ(expected, avx2.getRawColumn(index)[i]);
+                ASSERT_DOUBLE_EQ(scalar.getPhysicalColumn(index)[i], avx2.getPhysicalColumn(index)[i]);
+            }
+        }
+    }
+}
+
+TEST(LIB_batchdecoder, test_physical) {
+    Configuration *config = NULL;
+    ASSERT_NO_THROW(config = new Configuration("tests.cfg", "tests.dbc"));
+
+    std::vector<canfd_frame> frames(5);
+    for (auto it = frames.begin(); it != frames.end(); ++it) {
+        memset(&(*it), 0, sizeof(struct canfd_frame));
+        it->can_id = 3;
+    }
+    frames[4].data[0] = 0x80;
+    frames[4].data[1] = 0x00;
+    frames[4].data[2] = 0x80;
+    frames[4].data[5] = 0x80;
+    frames[4].data[6] = 0x00;
+    frames[4].data[7] = 0x80;
+
+    BatchDecoder decoder(*config->getMessage(3));
+    ASSERT_EQ(5, decoder.decode(frames.data(), frames.size()));
+    ASSERT_EQ(5, decoder.size());
+    ASSERT_DOUBLE_EQ(0, decoder.getPhysicalColumn(0)[3]);
+    ASSERT_DOUBLE_EQ(-128, decoder.getPhysicalColumn(0)[4]);
+    ASSERT_DOUBLE_EQ(-32768, decoder.getPhysicalColumn(1)[4]);
+    ASSERT_DOUBLE_EQ(0, decoder.getPhysicalColumn(2)[4]);
+    ASSERT_DOUBLE_EQ(-12.8, decoder.getPhysicalColumn(3)[4]);
+    ASSERT_DOUBLE_EQ(-3276.8, decoder.getPhysicalColumn(4)[4]);
+}
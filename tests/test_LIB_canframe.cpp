@@ -5,9 +5,13 @@
 
 #include "dummy_logger.h"
 
+#include "../lib/admissioncontroller.cpp"
 #include "../lib/ascreader.cpp"
+#include "../lib/asctokenizer.cpp"
+#include "../lib/canfd.cpp"
 #include "../lib/canmessage.cpp"
 #include "../lib/cansignal.cpp"
+#include "../lib/clock.cpp"
 #include "../lib/cansimulatorcore.cpp"
 #include "../lib/cantransceiver.cpp"
 #include "../lib/configuration.cpp"
@@ -15,9 +19,16 @@
 #include "../lib/can-dbcparser/dbciterator.cpp"
 #include "../lib/can-dbcparser/message.cpp"
 #include "../lib/can-dbcparser/signal.cpp"
+#include "../lib/latencyhistogram.cpp"
+#include "../lib/messagesnapshot.cpp"
+#include "../lib/reactor.cpp"
+#include "../lib/sendscheduler.cpp"
+#include "../lib/signallayout.cpp"
 #include "../lib/stringtools.cpp"
+#include "../lib/threadconfig.cpp"
 #include "../lib/unitconversion.cpp"
 #include "../lib/value.cpp"
+#include <fcntl.h>
 #include <linux/can.h>
 #include <gtest/gtest.h>
 
@@ -461,3 +472,357 @@ TEST(LIB_canframe, test_parse_assemble) {
     ASSERT_EQ(frame_out.data[6], frame_in.data[6]);
     ASSERT_EQ(frame_out.data[7], frame_in.data[7]);
 }
+
+TEST(LIB_canframe, test_signal_layout) {
+    uint8_t data[SIGNAL_LAYOUT_PAYLOAD_SIZE];
+
+    // Signed Intel signal with length other than 8, 16 or 32 bits
+    memset(data, 0, sizeof(data));
+    SignalLayout intel(ByteOrder::INTEL, 4, 12, Sign::SIGNED);
+    intel.insert(data, (uint64_t)-5);
+    ASSERT_EQ(0xb0, data[0]);
+    ASSERT_EQ(0xff, data[1]);
+    ASSERT_EQ(0, data[2]);
+    ASSERT_EQ(0xffb, intel.extract(data));
+    ASSERT_EQ(-5, (int64_t)intel.signExtend(intel.extract(data)));
+
+    // Motorola signal crossing byte boundary
+    memset(data, 0, sizeof(data));
+    SignalLayout motorola(ByteOrder::MOTOROLA, 3, 12, Sign::UNSIGNED);
+    motorola.insert(data, 0xabc);
+    ASSERT_EQ(0x0a, data[0]);
+    ASSERT_EQ(0xbc, data[1]);
+    ASSERT_EQ(0xabc, motorola.extract(data));
+    ASSERT_EQ(0xabc, motorola.signExtend(motorola.extract(data)));
+
+    // Signal at the end of CAN FD payload
+    memset(data, 0, sizeof(data));
+    SignalLayout end(ByteOrder::INTEL, 500, 12, Sign::UNSIGNED);
+    end.insert(data, 0xfff);
+    ASSERT_EQ(0xf0, data[62]);
+    ASSERT_EQ(0xff, data[63]);
+    ASSERT_EQ(0xfff, end.extract(data));
+
+    // Signal spanning over nine bytes
+    memset(data, 0, sizeof(data));
+    SignalLayout wide(ByteOrder::INTEL, 4, 64, Sign::UNSIGNED);
+    ASSERT_FALSE(wide.singleWord);
+    wide.insert(data, 0x0123456789abcdefULL);
+    ASSERT_EQ(0xf0, data[0]);
+    ASSERT_EQ(0x00, data[8] & 0xf0);
+    ASSERT_EQ(0x0123456789abcdefULL, wide.extract(data));
+}
+
+TEST(LIB_canframe, test_change_detection) {
+    uint64_t diff[SIGNAL_LAYOUT_DIFF_WORDS] = {0};
+    uint8_t *bytes = reinterpret_cast<uint8_t *>(diff);
+
+    // Only bits of the signal are detected as changes
+    SignalLayout motorola(ByteOrder::MOTOROLA, 3, 12, Sign::UNSIGNED);
+    bytes[0] = 0xf0;
+    bytes[2] = 0xff;
+    ASSERT_FALSE(motorola.isChanged(diff));
+    bytes[1] = 0x01;
+    ASSERT_TRUE(motorola.isChanged(diff));
+
+    // Signal spanning over two payload words
+    memset(diff, 0, sizeof(diff));
+    SignalLayout wide(ByteOrder::INTEL, 60, 8, Sign::UNSIGNED);
+    bytes[7] = 0x0f;
+    bytes[8] = 0xf0;
+    ASSERT_FALSE(wide.isChanged(diff));
+    bytes[8] = 0x08;
+    ASSERT_TRUE(wide.isChanged(diff));
+
+    Configuration *config = NULL;
+    ASSERT_NO_THROW(config = new Configuration("tests.cfg", "tests.dbc"));
+    canfd_frame frame;
+    empty_canframe(frame);
+    frame.can_id = 1;
+    frame.data[0] = 0x01;
+    frame.data[4] = 0x10;
+    ASSERT_TRUE(config->getMessage("test1sig1")->parseCANFrame(&frame, false));
+    ASSERT_FALSE(config->getMessage("test1sig1")->parseCANFrame(&frame, false));
+
+    // Changed bits update only their signal
+    frame.data[1] = 0x01;
+    ASSERT_TRUE(config->getMessage("test1sig1")->parseCANFrame(&frame, false));
+    ASSERT_EQ(1, config->getSignal("test1sig1")->getValue().toInt());
+    ASSERT_EQ(64, config->getSignal("test1sig2")->getValue().toInt());
+    ASSERT_EQ(16, config->getSignal("test1sig4")->getValue().toUnsigned());
+    ASSERT_FALSE(config->getMessage("test1sig1")->parseCANFrame(&frame, false));
+
+    // Setting a value makes the next frame decode every signal
+    ASSERT_TRUE(config->setValue("test1sig4", "5"));
+    ASSERT_TRUE(config->getMessage("test1sig1")->parseCANFrame(&frame, false));
+    ASSERT_EQ(16, config->getSignal("test1sig4")->getValue().toUnsigned());
+    delete config;
+}
+
+TEST(LIB_canframe, test_multiplexed) {
+    Configuration *config = NULL;
+    ASSERT_NO_THROW(config = new Configuration("tests_multiplexed.cfg", "tests.dbc"));
+
+    canfd_frame frame;
+    empty_canframe(frame);
+    frame.can_id = 14;
+    frame.data[0] = 0x00;
+    frame.data[1] = 0x34;
+    frame.data[2] = 0x12;
+    frame.data[3] = 0xff;
+    frame.data[4] = 0x0f;
+    frame.data[7] = 0x05;
+    ASSERT_TRUE(config->getMessage("test14mux")->parseCANFrame(&frame, false));
+    ASSERT_EQ(0, config->getSignal("test14mux")->getValue().toInt());
+    ASSERT_EQ(0x1234, config->getSignal("test14sig1")->getValue().toInt());
+    ASSERT_EQ(0, config->getSignal("test14sig2")->getValue().toInt());
+    ASSERT_EQ(0, config->getSignal("test14sig3")->getValue().toInt());
+    ASSERT_EQ(5, config->getSignal("test14sig4")->getValue().toInt());
+
+    frame.data[0] = 0x01;
+    frame.data[1] = 0xfe;
+    frame.data[2] = 0xff;
+    ASSERT_TRUE(config->getMessage("test14mux")->parseCANFrame(&frame, false));
+    ASSERT_EQ(1, config->getSignal("test14mux")->getValue().toInt());
+    ASSERT_EQ(0x1234, config->getSignal("test14sig1")->getValue().toInt());
+    ASSERT_EQ(-2, config->getSignal("test14sig2")->getValue().toInt());
+    ASSERT_EQ(-1, config->getSignal("test14sig3")->getValue().toInt());
+    ASSERT_EQ(5, config->getSignal("test14sig4")->getValue().toInt());
+    ASSERT_FALSE(config->getMessage("test14mux")->parseCANFrame(&frame, false));
+
+    // Only signals of the active page are assembled
+    empty_canframe(frame);
+    config->getMessage("test14mux")->assembleCANFrame(&frame);
+    ASSERT_EQ(0x01, frame.data[0]);
+    ASSERT_EQ(0xfe, frame.data[1]);
+    ASSERT_EQ(0xff, frame.data[2]);
+    ASSERT_EQ(0xff, frame.data[3]);
+    ASSERT_EQ(0x0f, frame.data[4]);
+    ASSERT_EQ(0x05, frame.data[7]);
+
+    ASSERT_TRUE(config->setValue("test14mux", "0"));
+    empty_canframe(frame);
+    config->getMessage("test14mux")->assembleCANFrame(&frame);
+    ASSERT_EQ(0x00, frame.data[0]);
+    ASSERT_EQ(0x34, frame.data[1]);
+    ASSERT_EQ(0x12, frame.data[2]);
+    ASSERT_EQ(0x00, frame.data[3]);
+    ASSERT_EQ(0x00, frame.data[4]);
+    ASSERT_EQ(0x05, frame.data[7]);
+}
+
+TEST(LIB_canframe, test_fixed_point) {
+    Configuration *config = NULL;
+    ASSERT_NO_THROW(config = new Configuration("tests.cfg", "tests.dbc"));
+    ASSERT_TRUE(config->getSignal("test1sig4")->isFixedPoint());
+    ASSERT_TRUE(config->getSignal("test3sig5")->isFixedPoint());
+    ASSERT_TRUE(config->getSignal("test13sig2")->isFixedPoint());
+
+    // Full range of 32-bit value with factor 0.1 and offset converts exactly
+    canfd_frame frame;
+    empty_canframe(frame);
+    frame.can_id = 13;
+    frame.data[0] = 0xff;
+    frame.data[1] = 0xff;
+    frame.data[2] = 0xff;
+    frame.data[3] = 0xff;
+    frame.data[4] = 0xff;
+    frame.data[5] = 0xff;
+    frame.data[6] = 0xff;
+    frame.data[7] = 0xff;
+    ASSERT_TRUE(config->getMessage("test13sig1")->parseCANFrame(&frame, false));
+    ASSERT_EQ(2147483647, config->getSignal("test13sig1")->getValue().toInt());
+    ASSERT_EQ(214748364.7, config->getSignal("test13sig2")->getValue().toDouble());
+    ASSERT_EQ(0xffffffffU, config->getSignal("test13sig2")->getRawValue());
+
+    frame.data[4] = 0xfe;
+    ASSERT_TRUE(config->getMessage("test13sig1")->parseCANFrame(&frame, false));
+    ASSERT_EQ(214748364.6, config->getSignal("test13sig2")->getValue().toDouble());
+    ASSERT_EQ(0xfffffffeU, config->getSignal("test13sig2")->getRawValue());
+
+    // Integer values round half away from zero
+    ASSERT_TRUE(config->setValue("test3sig5", "-0.05"));
+    ASSERT_EQ(0xffffU, config->getSignal("test3sig5")->getRawValue());
+    ASSERT_TRUE(config->setValue("test3sig5", "0.05"));
+    ASSERT_EQ(1U, config->getSignal("test3sig5")->getRawValue());
+    delete config;
+}
+
+TEST(LIB_canframe, test_canfd_dlc) {
+    ASSERT_EQ(8, canfdDlcToLength(8));
+    ASSERT_EQ(12, canfdDlcToLength(9));
+    ASSERT_EQ(32, canfdDlcToLength(13));
+    ASSERT_EQ(64, canfdDlcToLength(15));
+    ASSERT_EQ(5, canfdLengthToDlc(5));
+    ASSERT_EQ(9, canfdLengthToDlc(9));
+    ASSERT_EQ(13, canfdLengthToDlc(32));
+    ASSERT_EQ(15, canfdLengthToDlc(64));
+    ASSERT_TRUE(isValidCANFDLength(0));
+    ASSERT_TRUE(isValidCANFDLength(20));
+    ASSERT_TRUE(isValidCANFDLength(48));
+    ASSERT_FALSE(isValidCANFDLength(9));
+    ASSERT_FALSE(isValidCANFDLength(63));
+    ASSERT_FALSE(isValidCANFDLength(65));
+
+    canFrameBits bits = canFrameBitCount(false, 8, false, false);
+    ASSERT_EQ(108, bits.nominal);
+    ASSERT_EQ(0, bits.data);
+    bits = canFrameBitCount(false, 16, true, true);
+    ASSERT_EQ(27, bits.nominal);
+    ASSERT_EQ(160, bits.data);
+    bits = canFrameBitCount(true, 64, true, true);
+    ASSERT_EQ(45, bits.nominal);
+    ASSERT_EQ(549, bits.data);
+    bits = canFrameBitCount(true, 64, true, false);
+    ASSERT_EQ(594, bits.nominal);
+    ASSERT_EQ(0, bits.data);
+    ASSERT_FLOAT_EQ(45 + 549 / 4.0f, canFrameNominalBits(canFrameBitCount(true, 64, true, true), 500000, 2000000));
+    ASSERT_FLOAT_EQ(594, canFrameNominalBits(canFrameBitCount(true, 64, true, true), 500000, 0));
+}
+
+TEST(LIB_canframe, test_canfd) {
+    Configuration *config = NULL;
+    ASSERT_NO_THROW(config = new Configuration("tests_canfd.cfg", "tests.dbc"));
+    ASSERT_TRUE(config->getMessage("test15sig1")->isCANFD());
+    ASSERT_TRUE(config->getMessage("test15sig1")->getBitRateSwitch());
+
+    canfd_frame frame;
+    empty_canframe(frame);
+    ASSERT_TRUE(config->setValue("test15sig1", "4660"));
+    ASSERT_TRUE(config->setValue("test15sig2", "43981"));
+    config->getMessage("test15sig1")->assembleCANFrame(&frame);
+    ASSERT_EQ(15, frame.can_id);
+    ASSERT_EQ(64, frame.len);
+    ASSERT_EQ(CANFD_FDF | CANFD_BRS, frame.flags);
+    ASSERT_TRUE(isCANFDFrame(&frame));
+    ASSERT_EQ(0x34, frame.data[0]);
+    ASSERT_EQ(0x12, frame.data[1]);
+    ASSERT_EQ(0xcd, frame.data[62]);
+    ASSERT_EQ(0xab, frame.data[63]);
+
+    frame.data[62] = 0x01;
+    frame.data[63] = 0x00;
+    ASSERT_TRUE(config->getMessage("test15sig1")->parseCANFrame(&frame, true));
+    ASSERT_EQ(4660, config->getSignal("test15sig1")->getValue().toInt());
+    ASSERT_EQ(1, config->getSignal("test15sig2")->getValue().toInt());
+
+    // Classic CAN messages are not flagged as CAN FD
+    Configuration *classic = NULL;
+    ASSERT_NO_THROW(classic = new Configuration("tests.cfg", "tests.dbc"));
+    ASSERT_FALSE(classic->getMessage("test1sig1")->isCANFD());
+    empty_canframe(frame);
+    classic->getMessage("test1sig1")->assembleCANFrame(&frame);
+    ASSERT_EQ(0, frame.flags);
+    ASSERT_FALSE(isCANFDFrame(&frame));
+    delete classic;
+    delete config;
+}
+
+TEST(LIB_canframe, test_send_type) {
+    Configuration *config = NULL;
+    ASSERT_NO_THROW(config = new Configuration("tests_sendtype.cfg", "tests_sendtype.dbc"));
+    ASSERT_EQ(SendType::CYCLIC, config->getMessage(1)->getSendType());
+    ASSERT_EQ(100, config->getMessage(1)->getCycleTime());
+    ASSERT_EQ(5, config->getMessage(1)->getSendOffset());
+    ASSERT_EQ(-1, config->getMessage(2)->getSendOffset());
+    ASSERT_EQ(SendType::ON_CHANGE, config->getMessage(2)->getSendType());
+    ASSERT_EQ(0, config->getMessage(2)->getCycleTime());
+    ASSERT_EQ(SendType::NONE, config->getMessage(3)->getSendType());
+    ASSERT_FALSE(config->getMessage(3)->isOnChangeSignal("SIGNALS_3_SIG_1"));
+    ASSERT_TRUE(config->getMessage(3)->isOnChangeSignal("SIGNALS_3_SIG_2"));
+    ASSERT_EQ(SendType::NONE, config->getMessage(4)->getSendType());
+    ASSERT_FALSE(config->getMessage(4)->isOnChangeSignal("NONE_4_SIG_1"));
+    ASSERT_EQ(0, config->getMessage(4)->getRepetitions());
+    ASSERT_EQ(0, config->getMessage(4)->getDelayTime());
+    ASSERT_EQ(SendType::ON_CHANGE_WITH_REPETITION, config->getMessage(5)->getSendType());
+    ASSERT_EQ(3, config->getMessage(5)->getRepetitions());
+    ASSERT_EQ(20, config->getMessage(5)->getCycleTimeFast());
+    ASSERT_EQ(50, config->getMessage(5)->getDelayTime());
+    ASSERT_EQ(SendType::IF_ACTIVE, config->getMessage(6)->getSendType());
+    ASSERT_EQ(10, config->getMessage(6)->getCycleTimeFast());
+
+    // Copies resolve the schedule from their own signals
+    CANMessage copy(*config->getMessage(3));
+    ASSERT_TRUE(copy.isOnChangeSignal("SIGNALS_3_SIG_2"));
+    delete config;
+}
+
+TEST(LIB_canframe, test_frame_batch) {
+    CANFrameBatch batch;
+    canfd_frame frame = {};
+    ASSERT_TRUE(batch.empty());
+    for (canid_t id = 1; id <= CAN_SEND_BATCH_SIZE + 1; ++id) {
+        frame.can_id = id;
+        batch.add(frame);
+    }
+    ASSERT_EQ(CAN_SEND_BATCH_SIZE + 1, batch.size());
+    batch.clear();
+    ASSERT_TRUE(batch.empty());
+    ASSERT_EQ(0, batch.size());
+}
+
+TEST(LIB_canframe, test_send_batch) {
+    Configuration *config = NULL;
+    ASSERT_NO_THROW(config = new Configuration("tests.cfg", "tests.dbc"));
+    CANMessage *first = config->getMessage(1);
+    CANMessage *second = config->getMessage(2);
+    CANMessage *third = config->getMessage(3);
+    int sockets[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_DGRAM, 0, sockets));
+    CANTransceiver *transceiver = new CANTransceiver(sockets[0], false);
+
+    // Frames which fail are skipped, their messages stay modified
+    ASSERT_TRUE(config->setValue("test1sig1", "1"));
+    ASSERT_TRUE(config->setValue("test2sig1", "1"));
+    ASSERT_TRUE(config->setValue("test3sig1", "1"));
+    CANFrameBatch batch;
+    canfd_frame frame;
+    first->assembleCANFrame(&frame);
+    batch.add(frame, first);
+    second->assembleCANFrame(&frame);
+    frame.flags = CANFD_FDF;
+    batch.add(frame, second);
+    third->assembleCANFrame(&frame);
+    batch.add(frame, third);
+    std::vector<bool> written;
+    ASSERT_EQ(2, transceiver->sendCANBatch(batch, &written));
+    std::vector<bool> expected = {true, false, true};
+    ASSERT_EQ(expected, written);
+    ASSERT_TRUE(batch.empty());
+    ASSERT_EQ(1, first->getSuccessful());
+    ASSERT_FALSE(first->isModified());
+    ASSERT_EQ(0, second->getSuccessful());
+    ASSERT_EQ(1, second->getFailed());
+    ASSERT_TRUE(second->isModified());
+    ASSERT_EQ(1, third->getSuccessful());
+    ASSERT_FALSE(third->isModified());
+    canfd_frame received;
+    ASSERT_EQ(CAN_MTU, recv(sockets[1], &received, sizeof(received), MSG_DONTWAIT));
+    ASSERT_EQ(1, received.can_id);
+    ASSERT_EQ(CAN_MTU, recv(sockets[1], &received, sizeof(received), MSG_DONTWAIT));
+    ASSERT_EQ(3, received.can_id);
+    ASSERT_GT(0, recv(sockets[1], &received, sizeof(received), MSG_DONTWAIT));
+
+    // Frames after a partial sendmmsg are retried, frames which still fail are counted
+    int bufferSize = 0;
+    ASSERT_EQ(0, setsockopt(sockets[0], SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize)));
+    ASSERT_EQ(0, fcntl(sockets[0], F_SETFL, O_NONBLOCK));
+    first->assembleCANFrame(&frame);
+    for (int index = 0; index < CAN_SEND_BATCH_SIZE; ++index) {
+        batch.add(frame, first);
+    }
+    std::size_t sent = transceiver->sendCANBatch(batch);
+    ASSERT_GT(sent, 0);
+    ASSERT_LT(sent, CAN_SEND_BATCH_SIZE);
+    ASSERT_EQ(1 + sent, first->getSuccessful());
+    ASSERT_EQ(CAN_SEND_BATCH_SIZE - sent, first->getFailed());
+    std::size_t count = 0;
+    while (recv(sockets[1], &received, sizeof(received), MSG_DONTWAIT) > 0) {
+        ++count;
+    }
+    ASSERT_EQ(sent, count);
+
+    delete transceiver;
+    close(sockets[1]);
+    delete config;
+}
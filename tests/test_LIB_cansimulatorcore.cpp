@@ -5,9 +5,13 @@
 
 #include "dummy_logger.h"
 
+#include "../lib/admissioncontroller.cpp"
 #include "../lib/ascreader.cpp"
+#include "../lib/asctokenizer.cpp"
+#include "../lib/canfd.cpp"
 #include "../lib/canmessage.cpp"
 #include "../lib/cansignal.cpp"
+#include "../lib/clock.cpp"
 #include "../lib/configuration.cpp"
 #include "../lib/cansimulatorcore.cpp"
 #include "../lib/cantransceiver.cpp"
@@ -15,10 +19,109 @@
 #include "../lib/can-dbcparser/dbciterator.cpp"
 #include "../lib/can-dbcparser/message.cpp"
 #include "../lib/can-dbcparser/signal.cpp"
+#include "../lib/latencyhistogram.cpp"
+#include "../lib/messagesnapshot.cpp"
+#include "../lib/reactor.cpp"
+#include "../lib/sendscheduler.cpp"
+#include "../lib/signallayout.cpp"
 #include "../lib/stringtools.cpp"
+#include "../lib/threadconfig.cpp"
 #include "../lib/unitconversion.cpp"
 #include "../lib/value.cpp"
+#include <condition_variable>
 #include <gtest/gtest.h>
+#include <mutex>
+
+/*!
+ * Virtual clock moved by the test. The sender thread sleeps until the test runs
+ * the clock to its deadline, so sends happen at exact and repeatable times.
+ */
+class SteppedClock : public Clock
+{
+public:
+  SteppedClock() : m_now(VIRTUAL_CLOCK_START), m_deadline(0), m_sleeping(false), m_stopped(false) {}
+
+  std::uint64_t now() {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return m_now;
+  }
+
+  std::uint64_t wallTime() {
+    return now();
+  }
+
+  void sleepUntil(std::uint64_t deadline) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_deadline = deadline;
+    m_sleeping = true;
+    m_condition.notify_all();
+    while (m_sleeping && !m_stopped) {
+      m_condition.wait(lock);
+    }
+    m_sleeping = false;
+  }
+
+  bool isVirtual() const {
+    return true;
+  }
+
+  // Wake the sleeping thread at each deadline up to time and finally at time
+  void runUntil(std::uint64_t time) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    bool last = false;
+    while (!last) {
+      while (!m_sleeping) {
+        m_condition.wait(lock);
+      }
+      last = m_deadline > time;
+      m_now = std::max(m_now, last ? time : m_deadline);
+      m_sleeping = false;
+      m_condition.notify_all();
+      while (!m_sleeping) {
+        m_condition.wait(lock);
+      }
+    }
+  }
+
+  // Let the sleeping thread run freely until it stops
+  void stop() {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_stopped = true;
+    m_condition.notify_all();
+  }
+
+private:
+  std::uint64_t m_now;
+  std::uint64_t m_deadline;
+  bool m_sleeping;
+  bool m_stopped;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+};
+
+// Sent frames by CAN ID, as milliseconds since start of the clock and first data byte
+typedef std::map<canid_t, std::vector<std::pair<int, int>>> sendLog;
+
+/*!
+ * \brief runSender
+ * Run the sender thread in steps of 1 ms and log the frames it sends. Values
+ * set before the call are sent at the current time.
+ * \param clock: Clock of the sender thread
+ * \param peer: Socket receiving the sent frames
+ * \param milliseconds: Time to run
+ * \param sends: Log of sent frames
+ */
+static void runSender(SteppedClock &clock, int peer, int milliseconds, sendLog &sends)
+{
+  for (int step = 0; step <= milliseconds; ++step) {
+    clock.runUntil(clock.now() + (step ? 1000000ULL : 0));
+    canfd_frame frame;
+    while (recv(peer, &frame, sizeof(frame), MSG_DONTWAIT) > 0) {
+      sends[frame.can_id].push_back(std::make_pair((int)((clock.now() - VIRTUAL_CLOCK_START) / 1000000ULL),
+                                                   (int)frame.data[0]));
+    }
+  }
+}
 
 TEST(LIB_cansimulatorcore, missing_files) {
   ASSERT_THROW(CANSimulatorCore *core = new CANSimulatorCore("", "", "", ""), CANSimulatorCoreException);
@@ -90,3 +193,456 @@ TEST(LIB_cansimulatorcore, test_set_values) {
   ASSERT_EQ(5, core->getSignal("test1sig2")->getValue().toInt());
   ASSERT_EQ(10, core->getSignal("test1sig3")->getValue().toInt());
 }
+
+TEST(LIB_cansimulatorcore, test_send_scheduler) {
+  SendScheduler scheduler;
+  std::uint32_t id;
+  std::uint64_t deadline;
+  SendEvent event;
+  std::uint64_t now = SendScheduler::now();
+  ASSERT_EQ(SEND_SCHEDULER_NEVER, scheduler.nextDeadline());
+  scheduler.schedule(2, now + 2000000);
+  scheduler.schedule(1, now + 1000000, SendEvent::REPETITION);
+  scheduler.schedule(3, now, SendEvent::DELAYED);
+  ASSERT_EQ(now, scheduler.nextDeadline());
+  ASSERT_TRUE(scheduler.popDue(now, id, deadline, event));
+  ASSERT_EQ(3, id);
+  ASSERT_EQ(SendEvent::DELAYED, event);
+  ASSERT_FALSE(scheduler.popDue(now, id, deadline, event));
+
+  // Sleeps until the absolute deadline
+  ASSERT_FALSE(scheduler.wait(scheduler.nextDeadline()));
+  ASSERT_GE(SendScheduler::now(), now + 1000000);
+  ASSERT_TRUE(scheduler.popDue(SendScheduler::now(), id, deadline, event));
+  ASSERT_EQ(1, id);
+  ASSERT_EQ(now + 1000000, deadline);
+  ASSERT_EQ(SendEvent::REPETITION, event);
+
+  // Deadlines of several buses share the queue
+  unsigned int bus;
+  scheduler.schedule(4, now, SendEvent::CYCLIC, 1);
+  ASSERT_TRUE(scheduler.popDue(SendScheduler::now(), id, deadline, event, bus));
+  ASSERT_EQ(4, id);
+  ASSERT_EQ(1, bus);
+
+  // Notification wakes up before the deadline
+  scheduler.notify();
+  ASSERT_TRUE(scheduler.wait(SendScheduler::now() + 1000000000ULL));
+  scheduler.clear();
+  ASSERT_EQ(SEND_SCHEDULER_NEVER, scheduler.nextDeadline());
+}
+
+TEST(LIB_cansimulatorcore, test_phase_offsets) {
+  std::vector<SendPhase> phases;
+  SendPhase phase;
+  phase.bits = 100;
+  phase.offset = -1;
+  // Four messages of the same cycle get separate slots
+  for (std::uint32_t id = 1; id <= 4; ++id) {
+    phase.id = id;
+    phase.cycleTime = 10;
+    phases.push_back(phase);
+  }
+  // Configured offset is kept
+  phase.id = 5;
+  phase.cycleTime = 20;
+  phase.offset = 25;
+  phases.push_back(phase);
+  // Longer cycle avoids slots used by the configured offset
+  phase.id = 6;
+  phase.cycleTime = 20;
+  phase.offset = -1;
+  phases.push_back(phase);
+  assignPhaseOffsets(phases);
+
+  std::set<int> offsets;
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_GE(phases[i].offset, 0);
+    ASSERT_LT(phases[i].offset, 10);
+    offsets.insert(phases[i].offset);
+  }
+  ASSERT_EQ(4, offsets.size());
+  ASSERT_EQ(5, phases[4].offset);
+  ASSERT_NE(5, phases[5].offset);
+  ASSERT_EQ(0, offsets.count(phases[5].offset % 10));
+}
+
+TEST(LIB_cansimulatorcore, test_admission_controller) {
+  AdmissionController admission;
+  canFrameBits bits = canFrameBitCount(false, 8, false, false);
+  ASSERT_FALSE(admission.isEnabled());
+  ASSERT_TRUE(admission.admit(0x200, bits, 1000));
+  ASSERT_FALSE(admission.configure(101, 500000));
+  ASSERT_FALSE(admission.configure(50, 0));
+  ASSERT_EQ(ADMISSION_NEVER, admission.getRetryTime());
+
+  // 50 % of 500 kbit/s allows 2500 bits in 10 ms bursts, 23 frames of 108 bits
+  ASSERT_TRUE(admission.configure(50, 500000));
+  ASSERT_EQ(50, admission.getTargetLoad());
+  int admitted = 0;
+  while (admission.admit(0x200, bits, 1000)) {
+    ++admitted;
+  }
+  ASSERT_EQ(23, admitted);
+  ASSERT_TRUE(admission.isReserved(0x200));
+
+  // Lower CAN ID takes over the reservation and blocks higher ones
+  ASSERT_FALSE(admission.admit(0x100, bits, 1000));
+  ASSERT_TRUE(admission.isReserved(0x100));
+  std::uint64_t retry = admission.getRetryTime();
+  ASSERT_GT(retry, 1000);
+  ASSERT_LE(retry, 1000 + 432000 + 1);
+  ASSERT_FALSE(admission.admit(0x200, bits, retry));
+  ASSERT_TRUE(admission.admit(0x100, bits, retry));
+  ASSERT_FALSE(admission.isReserved(0x100));
+  ASSERT_EQ(ADMISSION_NEVER, admission.getRetryTime());
+
+  // Extended frames lose arbitration to standard frames of the same base ID
+  ASSERT_FALSE(admission.admit(CAN_EFF_FLAG | (0x100 << 18), bits, retry));
+  ASSERT_FALSE(admission.admit(0x100, bits, retry));
+  ASSERT_TRUE(admission.isReserved(0x100));
+
+  ASSERT_TRUE(admission.configure(0, 0));
+  ASSERT_TRUE(admission.admit(0x200, bits, retry));
+}
+
+TEST(LIB_cansimulatorcore, test_multiple_buses) {
+  CANSimulatorCore *core = NULL;
+  ASSERT_NO_THROW(core = new CANSimulatorCore("tests.cfg", "tests.dbc", "", ""));
+  ASSERT_EQ(1, core->getBusCount());
+  ASSERT_FALSE(core->addBus("", "tests_sendtype.cfg", "tests_sendtype.dbc", ""));
+  ASSERT_FALSE(core->addBus("body.rear", "tests_sendtype.cfg", "tests_sendtype.dbc", ""));
+  ASSERT_FALSE(core->addBus("body", "missing.cfg", "tests_sendtype.dbc", ""));
+  ASSERT_TRUE(core->addBus("body", "tests_sendtype.cfg", "tests_sendtype.dbc", ""));
+  ASSERT_FALSE(core->addBus("body", "tests_sendtype.cfg", "tests_sendtype.dbc", ""));
+  ASSERT_EQ(2, core->getBusCount());
+
+  // Variables of added buses have the bus name as prefix
+  ASSERT_EQ(1, core->getMessage("test1sig1")->getId());
+  ASSERT_EQ(0, core->getMessage("cyclic1sig1"));
+  ASSERT_EQ(1, core->getMessage("body.cyclic1sig1")->getId());
+  ASSERT_EQ("REPETITION_5_SIG_1", core->getSignal("body.repetition5sig1")->getName());
+  ASSERT_EQ(0, core->getSignal("chassis.repetition5sig1"));
+  ASSERT_TRUE(core->setValue("body.cyclic1sig1", "1"));
+  ASSERT_EQ(1, core->getSignal("body.cyclic1sig1")->getValue().toInt());
+  ASSERT_EQ(0, core->getSignal("test1sig1")->getValue().toInt());
+  SignalHandle handle = core->getSignalHandle("body.onchange2sig1");
+  ASSERT_TRUE(handle.isValid());
+  ASSERT_TRUE(core->setValue(handle, Value(1)));
+  ASSERT_EQ(1, core->getValue(handle).toInt());
+  std::vector<std::string> input = {"test1sig2=3", "body.signals3sig1=2"};
+  ASSERT_TRUE(core->setValues(input));
+  ASSERT_EQ(3, core->getSignal("test1sig2")->getValue().toInt());
+  ASSERT_EQ(2, core->getSignal("body.signals3sig1")->getValue().toInt());
+
+  // Received signals are routed to outgoing signals
+  ASSERT_TRUE(core->addSignalRoute("test4sig2", "body.onchange2sig1"));
+  ASSERT_FALSE(core->addSignalRoute("body.onchange2sig1", "test4sig2"));
+  ASSERT_FALSE(core->addSignalRoute("wrong", "body.onchange2sig1"));
+  ASSERT_FALSE(core->addSignalRoute("test4sig2", "body.wrong"));
+  ASSERT_FALSE(core->addSignalRoute("test1sig1", "body.onchange2sig1"));
+  ASSERT_FALSE(core->addSignalRoute("body.test4sig2", "body.onchange2sig1"));
+  delete core;
+}
+
+TEST(LIB_cansimulatorcore, test_thread_config) {
+  threadConfig config;
+  ASSERT_TRUE(parseThreadConfig("0", config));
+  ASSERT_EQ(0, config.cpu);
+  ASSERT_EQ(SCHED_OTHER, config.policy);
+  ASSERT_TRUE(parseThreadConfig(",fifo,10", config));
+  ASSERT_EQ(-1, config.cpu);
+  ASSERT_EQ(SCHED_FIFO, config.policy);
+  ASSERT_EQ(10, config.priority);
+  ASSERT_TRUE(parseThreadConfig("0,rr", config));
+  ASSERT_EQ(SCHED_RR, config.policy);
+  ASSERT_EQ(sched_get_priority_min(SCHED_RR), config.priority);
+  ASSERT_FALSE(parseThreadConfig("", config));
+  ASSERT_FALSE(parseThreadConfig("x", config));
+  ASSERT_FALSE(parseThreadConfig("0,idle", config));
+  ASSERT_FALSE(parseThreadConfig("0,fifo,100", config));
+  ASSERT_FALSE(parseThreadConfig("0,other,1", config));
+  ASSERT_FALSE(parseThreadConfig("100000", config));
+  // Failed parsing keeps the previous configuration
+  ASSERT_EQ(SCHED_RR, config.policy);
+
+  CANSimulatorCore *core = NULL;
+  ASSERT_NO_THROW(core = new CANSimulatorCore("tests.cfg", "tests.dbc", "", ""));
+  ASSERT_EQ(-1, core->getSenderThreadConfig().cpu);
+  config.cpu = 100000;
+  ASSERT_FALSE(core->setSenderThreadConfig(config));
+  // Use a CPU the test is allowed to run on, CPU 0 may be excluded by cgroups or taskset
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(allowed), &allowed));
+  int allowedCpu = 0;
+  while (allowedCpu < CPU_SETSIZE && !CPU_ISSET(allowedCpu, &allowed)) {
+    ++allowedCpu;
+  }
+  ASSERT_LT(allowedCpu, CPU_SETSIZE);
+  ASSERT_TRUE(parseThreadConfig(std::to_string(allowedCpu), config));
+  ASSERT_TRUE(core->setReaderThreadConfig(config));
+  ASSERT_EQ(allowedCpu, core->getReaderThreadConfig().cpu);
+  delete core;
+
+  // Affinity does not need permissions
+  int cpu = -1;
+  std::thread pinned([&] {
+    applyThreadConfig(config, true);
+    cpu = sched_getcpu();
+  });
+  pinned.join();
+  ASSERT_EQ(allowedCpu, cpu);
+}
+
+TEST(LIB_cansimulatorcore, test_virtual_time) {
+  VirtualClock clock(86400ULL * 1000000000ULL);
+  ASSERT_TRUE(clock.isVirtual());
+  ASSERT_EQ(VIRTUAL_CLOCK_START, clock.now());
+  clock.sleepUntil(VIRTUAL_CLOCK_START + 5);
+  ASSERT_EQ(VIRTUAL_CLOCK_START + 5, clock.now());
+  // Time never moves backwards
+  clock.sleepUntil(VIRTUAL_CLOCK_START);
+  ASSERT_EQ(VIRTUAL_CLOCK_START + 5, clock.now());
+  clock.advance(1000000000ULL - 5);
+  ASSERT_EQ(86401ULL * 1000000000ULL, clock.wallTime());
+
+  CANSimulatorCore *core = NULL;
+  ASSERT_NO_THROW(core = new CANSimulatorCore("tests_sendtype.cfg", "tests_sendtype.dbc", "", ""));
+  ASSERT_FALSE(core->getClock().isVirtual());
+  core->setClock(&clock);
+  ASSERT_TRUE(core->getClock().isVirtual());
+  // An hour of cyclic sends runs without sleeping, exactly on time
+  const std::uint64_t end = clock.now() + 3600ULL * 1000000000ULL;
+  core->startCANSenderThread();
+  while (clock.now() < end) {
+    std::this_thread::yield();
+  }
+  core->stopCANThreads();
+  ASSERT_GE(core->getPeriodError(1)->getCount(), 35000);
+  ASSERT_EQ(0, core->getPeriodError(1)->getMax());
+  ASSERT_EQ(0, core->getSchedulingLateness().getMax());
+  delete core;
+  core = NULL;
+  ASSERT_NO_THROW(core = new CANSimulatorCore("tests_sendtype.cfg", "tests_sendtype.dbc", "", ""));
+  core->setClock(NULL);
+  ASSERT_FALSE(core->getClock().isVirtual());
+  delete core;
+}
+
+TEST(LIB_cansimulatorcore, test_send_semantics) {
+  int sockets[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, sockets));
+  SteppedClock clock;
+  CANSimulatorCore *core = NULL;
+  ASSERT_NO_THROW(core = new CANSimulatorCore("tests_sendtype.cfg", "tests_sendtype.dbc", "", ""));
+  ASSERT_TRUE(core->setTransceiver("", new CANTransceiver(sockets[0], true)));
+  ASSERT_FALSE(core->setTransceiver("body", NULL));
+  core->setClock(&clock);
+  core->startCANSenderThread();
+  // Initial sends and their repetitions
+  sendLog sends;
+  runSender(clock, sockets[1], 100, sends);
+  sends.clear();
+
+  // Changes during the delay time are sent once when it expires, with the latest value
+  ASSERT_TRUE(core->setValue("delayed7sig1", "1"));
+  runSender(clock, sockets[1], 10, sends);
+  ASSERT_TRUE(core->setValue("delayed7sig1", "2"));
+  runSender(clock, sockets[1], 10, sends);
+  ASSERT_TRUE(core->setValue("delayed7sig1", "3"));
+  runSender(clock, sockets[1], 60, sends);
+  std::vector<std::pair<int, int>> expected = {{100, 1}, {140, 3}};
+  ASSERT_EQ(expected, sends[7]);
+
+  // Changes are followed by the number of repetitions at the fast cycle time,
+  // a change during repetitions is sent at once and restarts the count
+  ASSERT_TRUE(core->setValue("repetition5sig1", "1"));
+  ASSERT_TRUE(core->setValue("repeated8sig1", "1"));
+  runSender(clock, sockets[1], 15, sends);
+  ASSERT_TRUE(core->setValue("repeated8sig1", "2"));
+  runSender(clock, sockets[1], 85, sends);
+  expected = {{180, 1}, {200, 1}, {220, 1}, {240, 1}};
+  ASSERT_EQ(expected, sends[5]);
+  expected = {{180, 1}, {190, 1}, {195, 2}, {200, 2}, {210, 2}};
+  ASSERT_EQ(expected, sends[8]);
+
+  // Cyclic sends continue meanwhile
+  ASSERT_EQ(2, sends[1].size());
+  clock.stop();
+  core->stopCANThreads();
+  delete core;
+  close(sockets[1]);
+}
+
+TEST(LIB_cansimulatorcore, test_dropped_sends) {
+  int sockets[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, sockets));
+  SteppedClock clock;
+  CANSimulatorCore *core = NULL;
+  ASSERT_NO_THROW(core = new CANSimulatorCore("tests_sendtype.cfg", "tests_sendtype.dbc", "", ""));
+  ASSERT_TRUE(core->setTransceiver("", new CANTransceiver(sockets[0], true)));
+  core->setClock(&clock);
+  core->startCANSenderThread();
+  sendLog sends;
+  runSender(clock, sockets[1], 250, sends);
+  ASSERT_EQ(3, sends[1].size());
+  ASSERT_EQ(2, core->getPeriodError(1)->getCount());
+
+  // Frames the batch fails to write are not counted as cyclic sends
+  close(sockets[1]);
+  for (int step = 0; step <= 300; ++step) {
+    clock.runUntil(clock.now() + 1000000ULL);
+  }
+  // Expected failures still stop the sender thread
+  EXPECT_EQ(2, core->getPeriodError(1)->getCount());
+  EXPECT_LE(3, core->getMessage(1)->getFailed());
+  clock.stop();
+  core->stopCANThreads();
+  delete core;
+}
+
+TEST(LIB_cansimulatorcore, test_read_batch) {
+  int sockets[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_DGRAM, 0, sockets));
+  CANSimulatorCore *core = NULL;
+  ASSERT_NO_THROW(core = new CANSimulatorCore("tests.cfg", "tests.dbc", "", ""));
+  ASSERT_TRUE(core->setTransceiver("", new CANTransceiver(sockets[0], true)));
+
+  // Batch of two frames of TEST_4 with an incomplete and an unknown frame between them
+  std::chrono::time_point<std::chrono::system_clock> start = std::chrono::system_clock::now();
+  canfd_frame frame = {};
+  frame.can_id = 4;
+  frame.len = 4;
+  std::uint32_t payload = 2 | (100 << 2) | (1000 << 14);
+  memcpy(frame.data, &payload, sizeof(payload));
+  ASSERT_EQ(CAN_MTU, send(sockets[1], &frame, CAN_MTU, 0));
+  ASSERT_EQ(5, send(sockets[1], &frame, 5, 0));
+  frame.can_id = 0x7ff;
+  ASSERT_EQ(CAN_MTU, send(sockets[1], &frame, CAN_MTU, 0));
+  frame.can_id = 4;
+  payload = 1 | (200 << 2) | (2000 << 14);
+  memcpy(frame.data, &payload, sizeof(payload));
+  ASSERT_EQ(CAN_MTU, send(sockets[1], &frame, CAN_MTU, 0));
+  std::chrono::time_point<std::chrono::system_clock> sent = std::chrono::system_clock::now();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  core->startCANReaderThread();
+  Queue<MessageSnapshot *> *queue = core->getMessageQueue();
+  MessageSnapshot *snapshots[2];
+  for (int index = 0; index < 2; ++index) {
+    snapshots[index] = queue->pop();
+  }
+  core->stopCANThreads();
+  const CANSignal *sig1 = core->getSignal("test4sig1");
+  const CANSignal *sig2 = core->getSignal("test4sig2");
+  const CANSignal *sig3 = core->getSignal("test4sig3");
+  ASSERT_EQ(4, snapshots[0]->getId());
+  ASSERT_EQ(2, snapshots[0]->getValue(*sig1).toInt());
+  ASSERT_EQ(-165, snapshots[0]->getValue(*sig2).toInt());
+  ASSERT_EQ(1010, snapshots[0]->getValue(*sig3).toInt());
+  ASSERT_EQ(4, snapshots[1]->getId());
+  ASSERT_EQ(1, snapshots[1]->getValue(*sig1).toInt());
+  ASSERT_EQ(-65, snapshots[1]->getValue(*sig2).toInt());
+  ASSERT_EQ(2010, snapshots[1]->getValue(*sig3).toInt());
+  // Kernel receive times, not the time of reading
+  for (int index = 0; index < 2; ++index) {
+    ASSERT_GE(snapshots[index]->getTimestamp(), start);
+    ASSERT_LE(snapshots[index]->getTimestamp(), sent);
+    core->releaseSnapshot(snapshots[index]);
+  }
+  ASSERT_LE(snapshots[0]->getTimestamp(), snapshots[1]->getTimestamp());
+  ASSERT_TRUE(queue->empty());
+  ASSERT_EQ(1, core->getErrorMetrics().unknownMessages);
+  delete core;
+  close(sockets[1]);
+}
+
+TEST(LIB_cansimulatorcore, test_signal_route) {
+  int sockets[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_DGRAM, 0, sockets));
+  CANSimulatorCore *core = NULL;
+  ASSERT_NO_THROW(core = new CANSimulatorCore("tests.cfg", "tests.dbc", "", ""));
+  ASSERT_TRUE(core->addBus("body", "tests_sendtype.cfg", "tests_sendtype.dbc", ""));
+  ASSERT_TRUE(core->setTransceiver("", new CANTransceiver(sockets[0], true)));
+  ASSERT_TRUE(core->addSignalRoute("test4sig1", "body.onchange2sig1"));
+  SignalHandle target = core->getSignalHandle("body.onchange2sig1");
+  ASSERT_EQ(0, core->getValue(target).toInt());
+
+  // Frame received on the primary bus sets the signal of the body bus
+  canfd_frame frame = {};
+  frame.can_id = 4;
+  frame.len = 4;
+  std::uint32_t payload = 2 | (100 << 2) | (1000 << 14);
+  memcpy(frame.data, &payload, sizeof(payload));
+  ASSERT_EQ(CAN_MTU, send(sockets[1], &frame, CAN_MTU, 0));
+  // Signals are routed after queueing the snapshot, the second frame is read after routing the first one
+  payload = 2 | (200 << 2) | (1000 << 14);
+  memcpy(frame.data, &payload, sizeof(payload));
+  ASSERT_EQ(CAN_MTU, send(sockets[1], &frame, CAN_MTU, 0));
+  core->startCANReaderThread();
+  for (int index = 0; index < 2; ++index) {
+    MessageSnapshot *snapshot = core->getMessageQueue()->pop();
+    ASSERT_EQ(4, snapshot->getId());
+    core->releaseSnapshot(snapshot);
+  }
+  ASSERT_EQ(2, core->getValue(target).toInt());
+  ASSERT_EQ(2, core->getSignal("body.onchange2sig1")->getValue().toInt());
+  ASSERT_EQ(2, core->getValue(core->getSignalHandle("test4sig1")).toInt());
+  core->stopCANThreads();
+  delete core;
+  close(sockets[1]);
+}
+
+TEST(LIB_cansimulatorcore, test_sampled_frames) {
+  int sockets[2];
+  int sampling[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_DGRAM, 0, sockets));
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_DGRAM, 0, sampling));
+  CANSimulatorCore *core = NULL;
+  ASSERT_NO_THROW(core = new CANSimulatorCore("tests.cfg", "tests.dbc", "", ""));
+  ASSERT_TRUE(core->setTransceiver("", new CANTransceiver(sockets[0], true, sampling[0])));
+
+  // Frame of an unconfigured message sent by another program of this host
+  canfd_frame frame = {};
+  frame.can_id = 0x7ff;
+  frame.len = 8;
+  ASSERT_EQ(CAN_MTU, send(sampling[1], &frame, CAN_MTU, 0));
+  core->startCANReaderThread();
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  while (core->getErrorMetrics().unknownMessages == 0 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  core->stopCANThreads();
+  ASSERT_EQ(1, core->getErrorMetrics().unknownMessages);
+  ASSERT_TRUE(core->getMessageQueue()->empty());
+  delete core;
+  close(sockets[1]);
+  close(sampling[1]);
+}
+
+TEST(LIB_cansimulatorcore, test_read_drain) {
+  int sockets[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_DGRAM, 0, sockets));
+  CANSimulatorCore *core = NULL;
+  ASSERT_NO_THROW(core = new CANSimulatorCore("tests.cfg", "tests.dbc", "", ""));
+  ASSERT_TRUE(core->setTransceiver("", new CANTransceiver(sockets[0], true)));
+
+  // Dropped incomplete frame in a full batch does not end reading before the socket is drained
+  canfd_frame frame = {};
+  frame.can_id = 0x7ff;
+  ASSERT_EQ(5, send(sockets[1], &frame, 5, 0));
+  for (int index = 0; index < CAN_RECEIVE_BATCH_SIZE; ++index) {
+    ASSERT_EQ(CAN_MTU, send(sockets[1], &frame, CAN_MTU, 0));
+  }
+  core->startCANReaderThread();
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  while (core->getErrorMetrics().unknownMessages < CAN_RECEIVE_BATCH_SIZE &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  core->stopCANThreads();
+  ASSERT_EQ(CAN_RECEIVE_BATCH_SIZE, core->getErrorMetrics().unknownMessages);
+  delete core;
+  close(sockets[1]);
+}
@@ -5,9 +5,13 @@
 
 #include "dummy_logger.h"
 
+#include "../lib/admissioncontroller.cpp"
 #include "../lib/ascreader.cpp"
+#include "../lib/asctokenizer.cpp"
+#include "../lib/canfd.cpp"
 #include "../lib/canmessage.cpp"
 #include "../lib/cansignal.cpp"
+#include "../lib/clock.cpp"
 #include "../lib/configuration.cpp"
 #include "../lib/cansimulatorcore.cpp"
 #include "../lib/cantransceiver.cpp"
@@ -15,7 +19,13 @@
 #include "../lib/can-dbcparser/dbciterator.cpp"
 #include "../lib/can-dbcparser/message.cpp"
 #include "../lib/can-dbcparser/signal.cpp"
+#include "../lib/latencyhistogram.cpp"
+#include "../lib/messagesnapshot.cpp"
+#include "../lib/reactor.cpp"
+#include "../lib/sendscheduler.cpp"
+#include "../lib/signallayout.cpp"
 #include "../lib/stringtools.cpp"
+#include "../lib/threadconfig.cpp"
 #include "../lib/unitconversion.cpp"
 #include "../lib/value.cpp"
 #include <gtest/gtest.h>
@@ -50,6 +60,28 @@ TEST(LIB_configuration, test_message) {
   ASSERT_EQ(0, config->getMessage("wrong"));
 }
 
+TEST(LIB_configuration, test_find_message) {
+  Configuration *config = NULL;
+  bool send;
+  bool receive;
+  ASSERT_NO_THROW(config = new Configuration("tests.cfg", "tests.dbc"));
+  ASSERT_EQ(config->getMessage(1), config->findMessage(1, send, receive));
+  ASSERT_TRUE(send);
+  ASSERT_FALSE(receive);
+  ASSERT_EQ(config->getMessage(4), config->findMessage(4, send, receive));
+  ASSERT_FALSE(send);
+  ASSERT_TRUE(receive);
+  ASSERT_EQ(0, config->findMessage(CAN_SFF_MASK, send, receive));
+  ASSERT_FALSE(send || receive);
+  ASSERT_EQ(0, config->findMessage(CAN_EFF_FLAG | 1, send, receive));
+  ASSERT_FALSE(send || receive);
+
+  ASSERT_NO_THROW(config = new Configuration("tests.cfg", "tests.dbc", false, true));
+  ASSERT_EQ(config->getMessage(4), config->findMessage(4, send, receive));
+  ASSERT_TRUE(send);
+  ASSERT_TRUE(receive);
+}
+
 TEST(LIB_configuration, test_signal) {
   Configuration *config = NULL;
   ASSERT_NO_THROW(config = new Configuration("tests.cfg", "tests.dbc"));
@@ -95,6 +127,34 @@ TEST(LIB_configuration, test_signal) {
   ASSERT_EQ(0.5f, config->getValue("test2sig4").toDouble());
 }
 
+TEST(LIB_configuration, test_signal_handle) {
+  Configuration *config = NULL;
+  ASSERT_NO_THROW(config = new Configuration("tests.cfg", "tests.dbc"));
+  ASSERT_FALSE(SignalHandle().isValid());
+  ASSERT_FALSE(config->getSignalHandle("wrong").isValid());
+  ASSERT_FALSE(config->setValue(config->getSignalHandle("wrong"), Value(1)));
+  ASSERT_EQ(0, config->getValue(config->getSignalHandle("wrong")).toInt());
+
+  SignalHandle handle = config->getSignalHandle("test1sig3");
+  ASSERT_TRUE(handle.isValid());
+  ASSERT_TRUE(handle.isOutgoing());
+  ASSERT_EQ(100, config->getValue(handle).toInt());
+  ASSERT_TRUE(config->setValue(handle, "1"));
+  ASSERT_EQ(1, config->getValue("test1sig3").toInt());
+  ASSERT_TRUE(config->setValue(handle, Value(2)));
+  ASSERT_EQ(2, config->getValue(handle).toInt());
+  ASSERT_TRUE(config->getMessage("test1sig3")->isModified());
+  ASSERT_FALSE(config->setValue(handle, "-1"));
+  ASSERT_EQ(2, config->getValue(handle).toInt());
+
+  SignalHandle incoming = config->getSignalHandle("test4sig2");
+  ASSERT_TRUE(incoming.isValid());
+  ASSERT_FALSE(incoming.isOutgoing());
+  ASSERT_EQ(-265, config->getValue(incoming).toInt());
+  ASSERT_FALSE(config->setValue(incoming, "1"));
+  delete config;
+}
+
 TEST(LIB_configuration, test_suppress_defaults) {
   Configuration *config = NULL;
   ASSERT_NO_THROW(config = new Configuration("tests.cfg", "tests.dbc", true));
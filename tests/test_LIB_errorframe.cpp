@@ -5,10 +5,14 @@
 
 #include "dummy_logger.h"
 
+#include "../lib/admissioncontroller.cpp"
 #include "../lib/ascreader.cpp"
+#include "../lib/asctokenizer.cpp"
 #include "../lib/canerror.cpp"
+#include "../lib/canfd.cpp"
 #include "../lib/canmessage.cpp"
 #include "../lib/cansignal.cpp"
+#include "../lib/clock.cpp"
 #include "../lib/cansimulatorcore.cpp"
 #include "../lib/cantransceiver.cpp"
 #include "../lib/configuration.cpp"
@@ -16,7 +20,13 @@
 #include "../lib/can-dbcparser/dbciterator.cpp"
 #include "../lib/can-dbcparser/message.cpp"
 #include "../lib/can-dbcparser/signal.cpp"
+#include "../lib/latencyhistogram.cpp"
+#include "../lib/messagesnapshot.cpp"
+#include "../lib/reactor.cpp"
+#include "../lib/sendscheduler.cpp"
+#include "../lib/signallayout.cpp"
 #include "../lib/stringtools.cpp"
+#include "../lib/threadconfig.cpp"
 #include "../lib/unitconversion.cpp"
 #include "../lib/value.cpp"
 #include <linux/can.h>
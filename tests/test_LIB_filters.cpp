@@ -6,9 +6,13 @@
 #include "dummy_logger.h"
 
 #include "../cli/flood.cpp"
+#include "../lib/admissioncontroller.cpp"
 #include "../lib/ascreader.cpp"
+#include "../lib/asctokenizer.cpp"
+#include "../lib/canfd.cpp"
 #include "../lib/canmessage.cpp"
 #include "../lib/cansignal.cpp"
+#include "../lib/clock.cpp"
 #include "../lib/cansimulatorcore.cpp"
 #include "../lib/cantransceiver.cpp"
 #include "../lib/can-dbcparser/attribute.cpp"
@@ -16,8 +20,14 @@
 #include "../lib/can-dbcparser/message.cpp"
 #include "../lib/can-dbcparser/signal.cpp"
 #include "../lib/configuration.cpp"
+#include "../lib/latencyhistogram.cpp"
+#include "../lib/messagesnapshot.cpp"
 #include "../lib/metrics.cpp"
+#include "../lib/reactor.cpp"
+#include "../lib/sendscheduler.cpp"
+#include "../lib/signallayout.cpp"
 #include "../lib/stringtools.cpp"
+#include "../lib/threadconfig.cpp"
 #include "../lib/unitconversion.cpp"
 #include "../lib/value.cpp"
 #include <gtest/gtest.h>
@@ -283,3 +293,70 @@ TEST(LIB_filters, test_filter_all) {
     input.push_back("13");
     ASSERT_FALSE(canSimulator->initializeMessageFilterList(&input, true));
 }
+
+static bool matchesCANFilters(const std::vector<can_filter> &filters, std::uint32_t id) {
+    for (auto it = filters.begin(); it != filters.end(); ++it) {
+        if ((id & it->can_mask) == (it->can_id & it->can_mask)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+TEST(LIB_filters, kernel_filters) {
+    std::set<std::uint32_t> ids;
+    ASSERT_EQ(0, buildCANFilters(ids).size());
+
+    // Aligned block of 0x100-0x107 is a single filter, 0x108 and 0x10a are separate
+    for (std::uint32_t id = 0x100; id <= 0x108; ++id) {
+        ids.insert(id);
+    }
+    ids.insert(0x10a);
+    ids.insert(0x1234 | CAN_EFF_FLAG);
+    std::vector<can_filter> filters = buildCANFilters(ids);
+    ASSERT_EQ(4, filters.size());
+    ASSERT_EQ(0x100, filters[0].can_id);
+    ASSERT_EQ(CAN_EFF_FLAG | CAN_RTR_FLAG | (CAN_SFF_MASK & ~0x7U), filters[0].can_mask);
+    for (std::uint32_t id = 0x0f0; id < 0x120; ++id) {
+        ASSERT_EQ(ids.count(id) > 0, matchesCANFilters(filters, id));
+    }
+    // Frame formats and remote frames are told apart
+    ASSERT_TRUE(matchesCANFilters(filters, 0x1234 | CAN_EFF_FLAG));
+    ASSERT_FALSE(matchesCANFilters(filters, 0x234));
+    ASSERT_FALSE(matchesCANFilters(filters, 0x100 | CAN_EFF_FLAG));
+    ASSERT_FALSE(matchesCANFilters(filters, 0x100 | CAN_RTR_FLAG));
+
+    // Limited filter count matches a superset, merging the closest IDs first
+    filters = buildCANFilters(ids, 3);
+    ASSERT_EQ(3, filters.size());
+    for (auto it = ids.begin(); it != ids.end(); ++it) {
+        ASSERT_TRUE(matchesCANFilters(filters, *it));
+    }
+    ASSERT_TRUE(matchesCANFilters(filters, 0x109));
+    ASSERT_TRUE(matchesCANFilters(filters, 0x10b));
+    ASSERT_FALSE(matchesCANFilters(filters, 0x10c));
+    ASSERT_FALSE(matchesCANFilters(filters, 0x0ff));
+    // Formats are never merged
+    filters = buildCANFilters(ids, 1);
+    ASSERT_EQ(2, filters.size());
+    ASSERT_FALSE(matchesCANFilters(filters, 0x1234));
+}
+
+TEST(LIB_filters, compact_frames) {
+    receivedCANFrame frames[4] = {};
+    struct mmsghdr messages[4] = {};
+    std::size_t lengths[4] = {CAN_MTU, 5, CANFD_MTU, CAN_MTU};
+    for (std::uint32_t index = 0; index < 4; ++index) {
+        frames[index].frame.can_id = 0x100 + index;
+        messages[index].msg_len = lengths[index];
+    }
+    // Frames of other programs of this host are kept, incomplete frames are dropped
+    messages[3].msg_hdr.msg_flags = MSG_DONTROUTE;
+    ASSERT_EQ(3, compactCANFrames(frames, messages, 4));
+    ASSERT_EQ(0x100, frames[0].frame.can_id);
+    ASSERT_FALSE(frames[0].canfd);
+    ASSERT_EQ(0x102, frames[1].frame.can_id);
+    ASSERT_TRUE(frames[1].canfd);
+    ASSERT_EQ(0x103, frames[2].frame.can_id);
+    ASSERT_FALSE(frames[2].canfd);
+}
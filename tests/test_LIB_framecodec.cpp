@@ -0,0 +1,118 @@
+/*!
+* \file
+* \brief test_LIB_framecodec.cpp foo
+*/
+
+#include "dummy_logger.h"
+
+#include "../lib/admissioncontroller.cpp"
+#include "../lib/ascreader.cpp"
+#include "../lib/asctokenizer.cpp"
+#include "../lib/canfd.cpp"
+#include "../lib/canmessage.cpp"
+#include "../lib/cansignal.cpp"
+#include "../lib/clock.cpp"
+#include "../lib/cansimulatorcore.cpp"
+#include "../lib/cantransceiver.cpp"
+#include "../lib/configuration.cpp"
+#include "../lib/can-dbcparser/attribute.cpp"
+#include "../lib/can-dbcparser/dbciterator.cpp"
+#include "../lib/can-dbcparser/message.cpp"
+#include "../lib/can-dbcparser/signal.cpp"
+#include "../lib/latencyhistogram.cpp"
+#include "../lib/messagesnapshot.cpp"
+#include "../lib/reactor.cpp"
+#include "../lib/sendscheduler.cpp"
+#include "../lib/signallayout.cpp"
+#include "../lib/stringtools.cpp"
+#include "../lib/threadconfig.cpp"
+#include "../lib/unitconversion.cpp"
+#include "../lib/value.cpp"
+#include "framecodecs.h"
+#include <linux/can.h>
+#include <gtest/gtest.h>
+
+void random_canframe(canfd_frame &frame, std::uint32_t id) {
+    memset(&frame, 0, sizeof(struct canfd_frame));
+    frame.can_id = id;
+    for (int i = 0; i < 8; ++i) {
+        frame.data[i] = rand() & 0xff;
+    }
+}
+
+TEST(LIB_framecodec, test_load) {
+    Configuration *config = NULL;
+    ASSERT_NO_THROW(config = new Configuration("tests.cfg", "tests.dbc"));
+    ASSERT_EQ(config->getMessages().size(), GENERATED_FRAME_CODEC_COUNT);
+    ASSERT_EQ(GENERATED_FRAME_CODEC_COUNT, config->loadCodecs(generatedFrameCodecs, GENERATED_FRAME_CODEC_COUNT));
+    delete config;
+
+    // Codecs not matching the configuration are rejected
+    ASSERT_NO_THROW(config = new Configuration("tests.cfg", "tests.dbc"));
+    FrameCodec codec = generatedFrameCodecs[0];
+    codec.dlc = codec.dlc - 1;
+    ASSERT_EQ(0, config->loadCodecs(&codec, 1));
+    codec = generatedFrameCodecs[0];
+    codec.signalCount = codec.signalCount - 1;
+    ASSERT_EQ(0, config->loadCodecs(&codec, 1));
+    delete config;
+}
+
+TEST(LIB_framecodec, test_parse_assemble) {
+    srand(testing::UnitTest::GetInstance()->random_seed());
+    Configuration *generic = NULL;
+    Configuration *generated = NULL;
+    ASSERT_NO_THROW(generic = new Configuration("tests.cfg", "tests.dbc"));
+    ASSERT_NO_THROW(generated = new Configuration("tests.cfg", "tests.dbc"));
+    generated->loadCodecs(generatedFrameCodecs, GENERATED_FRAME_CODEC_COUNT);
+
+    for (auto it = generic->getMessages().begin(); it != generic->getMessages().end(); ++it) {
+        for (int round = 0; round < 100; ++round) {
+            canfd_frame frame;
+            random_canframe(frame, it->getId());
+            ASSERT_EQ(generic->getMessage(it->getId())->parseCANFrame(&frame, false),
+                      generated->getMessage(it->getId())->parseCANFrame(&frame, false));
+
+            std::map<std::string, CANSignal> &signals = generated->getMessage(it->getId())->getSignals();
+            for (auto sig = signals.begin(); sig != signals.end(); ++sig) {
+                ASSERT_EQ(generic->getMessage(it->getId())->getSignal(sig->first)->getValue().toDouble(),
+                          sig->second.getValue().toDouble());
+            }
+
+            canfd_frame frame_generic;
+            canfd_frame frame_generated;
+            generic->getMessage(it->getId())->assembleCANFrame(&frame_generic);
+            generated->getMessage(it->getId())->assembleCANFrame(&frame_generated);
+            ASSERT_EQ(frame_generic.can_id, frame_generated.can_id);
+            ASSERT_EQ(frame_generic.len, frame_generated.len);
+            ASSERT_EQ(0, memcmp(frame_generic.data, frame_generated.data, sizeof(frame_generic.data)));
+        }
+    }
+    delete generated;
+    delete generic;
+}
+
+TEST(LIB_framecodec, test_physical) {
+    canfd_frame frame;
+    memset(&frame, 0, sizeof(struct canfd_frame));
+    frame.data[0] = 0x80;
+    frame.data[1] = 0x00;
+    frame.data[2] = 0x80;
+    frame.data[5] = 0x80;
+    frame.data[6] = 0x00;
+    frame.data[7] = 0x80;
+
+    // Signals of TEST_3 in name order
+    double values[5];
+    dbc2cpp::TEST_3::decodePhysical(frame.data, values);
+    ASSERT_DOUBLE_EQ(-128, values[0]);
+    ASSERT_DOUBLE_EQ(-32768, values[1]);
+    ASSERT_DOUBLE_EQ(0, values[2]);
+    ASSERT_DOUBLE_EQ(-12.8, values[3]);
+    ASSERT_DOUBLE_EQ(-3276.8, values[4]);
+
+    canfd_frame frame_out;
+    memset(&frame_out, 0, sizeof(struct canfd_frame));
+    dbc2cpp::TEST_3::encodePhysical(values, frame_out.data);
+    ASSERT_EQ(0, memcmp(frame.data, frame_out.data, sizeof(frame.data)));
+}
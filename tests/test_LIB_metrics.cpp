@@ -4,20 +4,30 @@
  */
 
 #include "../lib/metrics.cpp"
+#include "../lib/admissioncontroller.cpp"
 #include "../lib/ascreader.cpp"
+#include "../lib/asctokenizer.cpp"
 #include "../lib/can-dbcparser/attribute.cpp"
 #include "../lib/can-dbcparser/dbciterator.cpp"
 #include "../lib/can-dbcparser/message.cpp"
 #include "../lib/can-dbcparser/signal.cpp"
 #include "../lib/canerror.cpp"
+#include "../lib/canfd.cpp"
 #include "../lib/canmessage.cpp"
 #include "../lib/cansignal.cpp"
+#include "../lib/clock.cpp"
 #include "../lib/cansimulatorcore.cpp"
 #include "../lib/cantransceiver.cpp"
 #include "../cli/commandlineparser.cpp"
 #include "../lib/configuration.cpp"
 #include "../lib/logger.cpp"
+#include "../lib/latencyhistogram.cpp"
+#include "../lib/messagesnapshot.cpp"
+#include "../lib/reactor.cpp"
+#include "../lib/sendscheduler.cpp"
+#include "../lib/signallayout.cpp"
 #include "../lib/stringtools.cpp"
+#include "../lib/threadconfig.cpp"
 #include "../lib/unitconversion.cpp"
 #include "../lib/value.cpp"
 #include <gtest/gtest.h>
@@ -120,6 +130,29 @@ TEST(LIB_metrics, idle_congestion) {
     ASSERT_EQ(msg->idleTotal, 16200);
 }
 
+TEST(LIB_metrics, canfd_message) {
+    CANSimulatorCore *canSimulator = NULL;
+    MetricsCollector *metrics = NULL;
+    struct messageMetrics *msg = NULL;
+
+    ASSERT_NO_THROW(canSimulator = new CANSimulatorCore("tests_canfd.cfg", "tests.dbc", "", ""));
+    ASSERT_NO_THROW(metrics = new MetricsCollector(canSimulator));
+
+    metrics->initRateSend(5);
+    metrics->forceBitrate(500000, 2000000);
+    CANMessage *message = new CANMessage(*canSimulator->getMessage("test15sig1"));
+    for (int i = 0; i < 50; ++i) {
+        message->updateTransfer(true);
+    }
+    metrics->updateMessage(message);
+    msg = metrics->getSingleMessageMetrics(15, true);
+    ASSERT_EQ(msg->successful, 50);
+    ASSERT_EQ(msg->messageSize, 576);
+    ASSERT_EQ(msg->messageTime, 328);
+    ASSERT_EQ(msg->timeTotal, msg->messageTime * 50);
+    ASSERT_EQ(msg->idleTime, 493);
+}
+
 TEST(LIB_metrics, idle_delay) {
     CANSimulatorCore *canSimulator = NULL;
     MetricsCollector *metrics = NULL;
@@ -244,3 +277,50 @@ TEST(LIB_metrics, fileWriting) {
 
     ASSERT_TRUE(metrics->writeToFile("./metricsTestRun.txt", true));
 }
+
+TEST(LIB_metrics, latency_histogram) {
+    LatencyHistogram histogram;
+    ASSERT_EQ(0, histogram.getCount());
+    ASSERT_EQ(0, histogram.getPercentile(50));
+    // Small values are exact
+    for (std::uint64_t value = 1; value <= 50; ++value) {
+        histogram.record(value);
+    }
+    ASSERT_EQ(50, histogram.getCount());
+    ASSERT_EQ(25, histogram.getPercentile(50));
+    ASSERT_EQ(50, histogram.getPercentile(99));
+    ASSERT_EQ(50, histogram.getMax());
+
+    // Larger values are within the bucket precision
+    histogram.reset();
+    for (int i = 0; i < 990; ++i) {
+        histogram.record(100000);
+    }
+    for (int i = 0; i < 10; ++i) {
+        histogram.record(5000000 + i);
+    }
+    ASSERT_EQ(1000, histogram.getCount());
+    ASSERT_GE(histogram.getPercentile(50), 100000);
+    ASSERT_LE(histogram.getPercentile(50), 100000 + 100000 / 32);
+    ASSERT_LE(histogram.getPercentile(99), 100000 + 100000 / 32);
+    ASSERT_GE(histogram.getPercentile(99.9), 5000000);
+    ASSERT_EQ(5000009, histogram.getPercentile(99.9));
+    ASSERT_EQ(5000009, histogram.getMax());
+    // Values beyond the range are counted in the last bucket
+    histogram.record(UINT64_MAX);
+    ASSERT_EQ((1ULL << LATENCY_MAX_BITS) - 1, histogram.getMax());
+
+    CANSimulatorCore *canSimulator = NULL;
+    MetricsCollector *metrics = NULL;
+    ASSERT_NO_THROW(canSimulator = new CANSimulatorCore("tests.cfg", "tests.dbc", "", ""));
+    ASSERT_NO_THROW(metrics = new MetricsCollector(canSimulator));
+    struct latencyMetrics lateness = metrics->getSchedulingLateness();
+    ASSERT_EQ(0, lateness.count);
+    ASSERT_FALSE(metrics->getPeriodError(1, lateness));
+    struct latencyMetrics latency = MetricsCollector::summarize(histogram);
+    ASSERT_EQ(1001, latency.count);
+    ASSERT_EQ(histogram.getPercentile(50), latency.p50);
+    ASSERT_EQ(histogram.getMax(), latency.max);
+    delete metrics;
+    delete canSimulator;
+}
@@ -5,9 +5,13 @@
 
 #include "dummy_logger.h"
 
+#include "../lib/admissioncontroller.cpp"
 #include "../lib/ascreader.cpp"
+#include "../lib/asctokenizer.cpp"
+#include "../lib/canfd.cpp"
 #include "../lib/canmessage.cpp"
 #include "../lib/cansignal.cpp"
+#include "../lib/clock.cpp"
 #include "../lib/configuration.cpp"
 #include "../lib/cansimulatorcore.cpp"
 #include "../lib/cantransceiver.cpp"
@@ -15,8 +19,14 @@
 #include "../lib/can-dbcparser/dbciterator.cpp"
 #include "../lib/can-dbcparser/message.cpp"
 #include "../lib/can-dbcparser/signal.cpp"
+#include "../lib/latencyhistogram.cpp"
+#include "../lib/messagesnapshot.cpp"
 #include "../lib/queue.h"
+#include "../lib/reactor.cpp"
+#include "../lib/sendscheduler.cpp"
+#include "../lib/signallayout.cpp"
 #include "../lib/stringtools.cpp"
+#include "../lib/threadconfig.cpp"
 #include "../lib/unitconversion.cpp"
 #include "../lib/value.cpp"
 #include <linux/can.h>
@@ -72,3 +82,102 @@ TEST(LIB_queue, test_queue) {
   ASSERT_EQ(2, out_message2.get()->getId());
   ASSERT_EQ(2, out_message2.get()->getSignal("TEST_2_SIG_1")->getValue().toInt());
 }
+
+TEST(LIB_queue, test_snapshot_queue) {
+  Configuration *config = NULL;
+  ASSERT_NO_THROW(config = new Configuration("tests.cfg", "tests.dbc"));
+  CANMessage *msg = config->getMessage(1);
+  MessageSnapshotPool pool(1);
+  Queue<MessageSnapshot *> messageQueue;
+  canfd_frame frame;
+  memset(&frame, 0, sizeof(frame));
+  frame.can_id = 1;
+  frame.len = 8;
+  frame.data[0] = 0x01;
+  msg->parseCANFrame(&frame, false);
+  MessageSnapshot *snapshot1 = pool.acquire();
+  msg->takeSnapshot(*snapshot1, std::chrono::system_clock::now());
+  messageQueue.push(snapshot1);
+  // Change only TEST_1_SIG_2
+  frame.data[0] = 0x05;
+  ASSERT_TRUE(msg->parseCANFrame(&frame, false));
+  // Pool is exhausted, snapshot is allocated instead
+  MessageSnapshot *snapshot2 = pool.acquire();
+  ASSERT_NE(snapshot1, snapshot2);
+  msg->takeSnapshot(*snapshot2, std::chrono::system_clock::now());
+  messageQueue.push(snapshot2);
+  ASSERT_FALSE(msg->getSignal("TEST_1_SIG_2")->isModified());
+
+  // Snapshots keep the payload they were taken from
+  MessageSnapshot *out1 = messageQueue.pop();
+  MessageSnapshot *out2 = messageQueue.pop();
+  ASSERT_EQ(msg, out1->getMessage());
+  ASSERT_EQ(1, out1->getId());
+  ASSERT_EQ(8, out1->getLength());
+  ASSERT_EQ(0, out1->getValue(*msg->getSignal("TEST_1_SIG_2")).toInt());
+  ASSERT_EQ(1, out2->getValue(*msg->getSignal("TEST_1_SIG_2")).toInt());
+  ASSERT_EQ(1, out2->getValue(*msg->getSignal("TEST_1_SIG_1")).toInt());
+  ASSERT_FALSE(out2->isChanged(0));
+  ASSERT_TRUE(out2->isChanged(1));
+  ASSERT_FALSE(out2->isChanged(2));
+  ASSERT_FALSE(out2->isChanged(3));
+  ASSERT_TRUE(out2->getTimestamp() >= out1->getTimestamp());
+  pool.release(out2);
+  pool.release(out1);
+  ASSERT_EQ(snapshot1, pool.acquire());
+
+  // Payload past the message length is zero, also before the first frame
+  CANMessage *msg4 = config->getMessage(4);
+  msg4->takeSnapshot(*snapshot1, std::chrono::system_clock::now());
+  for (std::size_t index = 0; index < SIGNAL_LAYOUT_PAYLOAD_SIZE; ++index) {
+    ASSERT_EQ(0, snapshot1->getPayload()[index]);
+  }
+  frame.can_id = 4;
+  frame.len = 4;
+  memset(frame.data, 0xff, sizeof(frame.data));
+  ASSERT_TRUE(msg4->parseCANFrame(&frame, false));
+  msg4->takeSnapshot(*snapshot1, std::chrono::system_clock::now());
+  ASSERT_EQ(4, snapshot1->getLength());
+  for (std::size_t index = 0; index < SIGNAL_LAYOUT_PAYLOAD_SIZE; ++index) {
+    ASSERT_EQ(index < 4 ? 0xff : 0, snapshot1->getPayload()[index]);
+  }
+  pool.release(snapshot1);
+  delete config;
+}
+
+TEST(LIB_queue, test_reactor) {
+  Reactor reactor;
+  Queue<int> queue;
+  int handled = 0;
+  int popped = 0;
+  int queueFd = queue.getEventFd();
+  ASSERT_TRUE(reactor.add(queueFd, EPOLLIN, [&](std::uint32_t events) {
+    ASSERT_TRUE(events & EPOLLIN);
+    uint64_t val;
+    ASSERT_EQ((ssize_t)sizeof(val), read(queueFd, &val, sizeof(val)));
+    ++handled;
+    while (!queue.empty()) {
+      popped += queue.pop();
+    }
+  }));
+  // Nothing to handle
+  ASSERT_EQ(0, reactor.dispatch(10));
+  queue.push(1);
+  queue.push(2);
+  ASSERT_EQ(1, reactor.dispatch(10));
+  ASSERT_EQ(1, handled);
+  ASSERT_EQ(3, popped);
+  // Edge triggered, consumed input is not reported again
+  ASSERT_EQ(0, reactor.dispatch(10));
+  // Stop wakes up waiting thread
+  std::thread stopper([&reactor]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    reactor.stop();
+  });
+  ASSERT_TRUE(reactor.run());
+  stopper.join();
+  ASSERT_TRUE(reactor.isStopped());
+  ASSERT_EQ(-1, reactor.dispatch(0));
+  ASSERT_TRUE(reactor.remove(queueFd));
+  ASSERT_FALSE(reactor.remove(queueFd));
+}
@@ -0,0 +1,375 @@
+/*!
+* \file
+* \brief ascbench.cpp foo
+*/
+
+#include "ascreader.h"
+#include "canfd.h"
+#include "logger.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <getopt.h>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+// Default number of frames of a generated log
+#define ASCBENCH_DEFAULT_FRAMES 1000000
+
+/*!
+ * Totals of parsed frames, equal totals mean both parsers read the same frames
+ */
+struct benchResult {
+    std::uint64_t frames;       // Number of parsed frames
+    std::uint64_t checksum;     // Sum over timestamps, directions, IDs and data
+    std::uint64_t bytes;        // Size of the parsed files
+    double seconds;             // Parse time
+};
+
+/*!
+ * \brief printHelp
+ * Print program help
+ */
+void printHelp()
+{
+    LOG(LOG_OUT,
+"Usage: ascbench [-f FILE | -n NUM]\n\
+Compare ASC parsing speed of the istringstream reference parser and the mmap tokenizer\n\
+  -f, --file=FILE               ASC file to parse, continuous logs are followed only when streaming\n\
+  -n, --frames=NUM              Number of frames of a generated log (default: 1000000)\n");
+}
+
+/*!
+ * \brief addFrame
+ * Add parsed frame to totals
+ * \param result: Totals
+ * \param item: Parsed frame
+ */
+static void addFrame(benchResult &result, const canFrameQueueItem &item)
+{
+    ++result.frames;
+    result.checksum += item.timestamp * 31 + item.in + item.frame.can_id + item.frame.len + item.frame.flags;
+    for (unsigned int index = 0; index < item.frame.len; ++index) {
+        result.checksum += (std::uint64_t)item.frame.data[index] << (index % 8);
+    }
+}
+
+/*!
+ * \brief referenceParseMessage
+ * Parse message line with istringstream, the parser used before the tokenizer
+ * \param line: Input string
+ * \param format: Format of the file, cumulative timestamp is updated
+ * \param item: Set to the parsed frame
+ * \return True if a frame was parsed, false otherwise.
+ */
+static bool referenceParseMessage(const std::string &line, ascFormat &format, canFrameQueueItem &item)
+{
+    std::istringstream input;
+    input.str(line);
+    int bus = 0;
+    unsigned int dlc = 0, length = 0, brs = 0, esi = 0;
+    float timestamp = 0;
+    uint32_t id = 0;
+    std::string dir, type;
+    unsigned int data[CANFD_MAX_DLEN];
+    bool canfd = false;
+
+    input >> timestamp;
+    if (!input.good()) {
+        return false;
+    }
+    input >> std::ws;
+    if (input.peek() == 'C') {
+        input >> type;
+        if (type != "CANFD") {
+            return false;
+        }
+        canfd = true;
+    }
+    input >> bus;
+    if (!input.good()) {
+        return false;
+    }
+    if (canfd) {
+        input >> dir;
+    }
+    if (format.hexId) {
+        input >> std::hex >> id;
+    } else {
+        input >> std::dec >> id;
+    }
+    if (!input.good()) {
+        return false;
+    }
+    if (input.peek() == 'x') {
+        input.ignore();
+        id |= CAN_EFF_FLAG;
+    }
+    if (canfd) {
+        std::string field;
+        input >> field;
+        if (!field.empty() && !isdigit(field[0])) {
+            input >> field;
+        }
+        brs = (field == "1");
+        input >> std::dec >> esi >> std::hex >> dlc >> std::dec >> length;
+        if (input.fail() || dlc > CANFD_MAX_DLC || length != canfdDlcToLength(dlc)) {
+            return false;
+        }
+    } else {
+        input >> dir;
+        input >> type;
+        if (type != "d") {
+            return false;
+        }
+        input >> std::hex >> dlc;
+        length = (dlc > CAN_MAX_DLEN) ? CAN_MAX_DLEN : dlc;
+    }
+    input >> std::hex;
+    for (unsigned int d = 0; d < length; ++d) {
+        input >> data[d];
+    }
+    if (input.fail()) {
+        return false;
+    }
+    if (!format.absoluteTimestamps) {
+        timestamp += format.oldTimestamp;
+        format.oldTimestamp = timestamp;
+    }
+    item.timestamp = llround(timestamp * 1000);
+    item.in = (dir == "Rx");
+    memset(&item.frame, 0, sizeof(struct canfd_frame));
+    item.frame.can_id = id;
+    item.frame.len = length;
+    if (canfd) {
+        item.frame.flags = CANFD_FDF | (brs ? CANFD_BRS : 0) | (esi ? CANFD_ESI : 0);
+    }
+    for (unsigned int d = 0; d < length; ++d) {
+        item.frame.data[d] = data[d];
+    }
+    return true;
+}
+
+/*!
+ * \brief readFormat
+ * Read ID number base and timestamp format from the second header line
+ * \param fileName: ASC file
+ * \param format: Set to format of the file
+ * \return True if successful, false otherwise.
+ */
+static bool readFormat(const std::string &fileName, ascFormat &format)
+{
+    std::ifstream file(fileName);
+    std::string line;
+    if (!std::getline(file, line) || !std::getline(file, line)) {
+        return false;
+    }
+    format.hexId = line.find(" hex") != std::string::npos;
+    format.absoluteTimestamps = line.find("absolute") != std::string::npos;
+    format.oldTimestamp = 0;
+    return true;
+}
+
+/*!
+ * \brief benchReference
+ * Parse all lines with getline and the reference parser
+ * \param fileName: ASC file
+ * \param result: Totals
+ * \return True if successful, false otherwise.
+ */
+static bool benchReference(const std::string &fileName, benchResult &result)
+{
+    ascFormat format;
+    if (!readFormat(fileName, format)) {
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::ifstream file(fileName);
+    std::string line;
+    canFrameQueueItem item;
+    while (std::getline(file, line)) {
+        result.bytes += line.size() + 1;
+        if (referenceParseMessage(line, format, item)) {
+            addFrame(result, item);
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+/*!
+ * \brief benchTokenizer
+ * Parse all lines of the mapped file with the tokenizer
+ * \param fileName: ASC file
+ * \param result: Totals
+ * \return True if successful, false otherwise.
+ */
+static bool benchTokenizer(const std::string &fileName, benchResult &result)
+{
+    ascFormat format;
+    if (!readFormat(fileName, format)) {
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    ASCTokenizer file(fileName);
+    if (!file.isOpen()) {
+        return false;
+    }
+    const char *begin, *end;
+    canFrameQueueItem item;
+    while (file.nextLine(begin, end)) {
+        result.bytes += end - begin + 1;
+        if (ASCTokenizer::parseFrame(begin, end, format, item)) {
+            addFrame(result, item);
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+/*!
+ * \brief benchStreaming
+ * Read all frames through the ASCReader prefetch thread
+ * \param fileName: ASC file
+ * \param result: Totals
+ * \return True if successful, false otherwise.
+ */
+static bool benchStreaming(const std::string &fileName, benchResult &result)
+{
+    auto start = std::chrono::steady_clock::now();
+    try {
+        ASCReader reader(fileName);
+        canFrameQueueItem item;
+        reader.startStreaming();
+        while (reader.readFrame(item)) {
+            addFrame(result, item);
+        }
+    }
+    catch (ASCReaderException &) {
+        return false;
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+/*!
+ * \brief generateLog
+ * Write ASC log of classic and CAN FD frames with relative timestamps
+ * \param fileName: Output file
+ * \param frames: Number of frames
+ * \return True if successful, false otherwise.
+ */
+static bool generateLog(const std::string &fileName, unsigned long frames)
+{
+    FILE *file = fopen(fileName.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+    fprintf(file, "date Tue May 9 12:00:00 2020\nbase hex  timestamps relative\ninternal events logged\n"
+                  "Begin Triggerblock Tue May 9 12:00:00 pm 2020\n0.0000 Start measurement\n");
+    for (unsigned long index = 0; index < frames; ++index) {
+        unsigned int id = 0x100 + index % 64;
+        if (index % 4 == 3) {
+            fprintf(file, "0.0005 CANFD   1 %s        %x  FD_%x                          1 0 d 32",
+                    index % 2 ? "Tx" : "Rx", id, id);
+            for (unsigned int byte = 0; byte < 32; ++byte) {
+                fprintf(file, " %02x", (unsigned int)(index + byte) & 0xff);
+            }
+            fprintf(file, "   130000  130 303000 d4b2a  46500250  460a0250  20011736  20010205\n");
+        } else {
+            fprintf(file, "0.0005 1  %x%s             Rx   d 8", id, index % 8 ? "" : "x");
+            for (unsigned int byte = 0; byte < 8; ++byte) {
+                fprintf(file, " %02x", (unsigned int)(index * 7 + byte) & 0xff);
+            }
+            fprintf(file, "\n");
+        }
+    }
+    fprintf(file, "End TriggerBlock\n");
+    return fclose(file) == 0;
+}
+
+/*!
+ * \brief printResult
+ * Print parse speed
+ * \param name: Parser name
+ * \param result: Totals
+ * \param bytes: Size of the parsed files
+ */
+static void printResult(const char *name, const benchResult &result, std::uint64_t bytes)
+{
+    LOG(LOG_OUT, "%-12s %10llu frames %8.3f s %9.1f MB/s %11.0f frames/s\n", name,
+        (unsigned long long)result.frames, result.seconds, bytes / result.seconds / 1e6, result.frames / result.seconds);
+}
+
+/*!
+ * \brief main
+ * Main function of ASC parser benchmark
+ * \param argc: number of command line parameters
+ * \param argv: command line parameters
+ * \return Exit code, 1 if the parsers disagree
+ */
+int main(int argc, char *argv[])
+{
+    std::string fileName;
+    unsigned long frames = ASCBENCH_DEFAULT_FRAMES;
+    static struct option long_options[] = {
+        {"file", required_argument, 0, 'f'},
+        {"frames", required_argument, 0, 'n'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "f:n:h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'f':
+            fileName = optarg;
+            break;
+        case 'n':
+            frames = strtoul(optarg, NULL, 10);
+            break;
+        default:
+            printHelp();
+            return 1;
+        }
+    }
+    bool generated = fileName.empty();
+    if (generated) {
+        char path[] = "/tmp/ascbenchXXXXXX";
+        int fd = mkstemp(path);
+        if (fd < 0) {
+            LOG(LOG_ERR, "error=2 Unable to create temporary file.\n");
+            return 2;
+        }
+        close(fd);
+        fileName = path;
+        if (!generateLog(fileName, frames)) {
+            LOG(LOG_ERR, "error=2 Unable to write generated log.\n");
+            unlink(fileName.c_str());
+            return 2;
+        }
+    }
+
+    benchResult reference = {}, tokenizer = {}, streaming = {};
+    bool ok = benchReference(fileName, reference) && benchTokenizer(fileName, tokenizer) &&
+              benchStreaming(fileName, streaming);
+    if (generated) {
+        unlink(fileName.c_str());
+    }
+    if (!ok) {
+        LOG(LOG_ERR, "error=1 Unable to parse ASC file.\n");
+        return 2;
+    }
+    printResult("istringstream", reference, reference.bytes);
+    printResult("tokenizer", tokenizer, reference.bytes);
+    printResult("streaming", streaming, reference.bytes);
+    LOG(LOG_OUT, "tokenizer speedup %.1fx\n", reference.seconds / tokenizer.seconds);
+    if (reference.frames != tokenizer.frames || reference.checksum != tokenizer.checksum) {
+        LOG(LOG_ERR, "error=4 Parsers read different frames.\n");
+        return 1;
+    }
+    return 0;
+}
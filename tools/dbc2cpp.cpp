@@ -0,0 +1,373 @@
+/*!
+* \file
+* \brief dbc2cpp.cpp foo
+*/
+
+#include "configuration.h"
+#include "logger.h"
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <getopt.h>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+
+/*!
+ * \brief printHelp
+ * Print program help
+ */
+void printHelp()
+{
+    LOG(LOG_OUT,
+"Usage: dbc2cpp -c FILE -d FILE -o FILE\n\
+Generate specialised frame codecs for configured CAN messages\n\
+  -c, --cfg=FILE                cfg file\n\
+  -d, --dbc=FILE                dbc file\n\
+  -o, --output=FILE             Output header file\n");
+}
+
+/*!
+ * \brief identifier
+ * Convert name to valid C++ identifier
+ * \param name: Name from dbc file
+ * \return Identifier
+ */
+std::string identifier(const std::string &name)
+{
+    std::string id = name;
+    for (auto it = id.begin(); it != id.end(); ++it) {
+        if (!isalnum(*it)) {
+            *it = '_';
+        }
+    }
+    if (id.empty() || isdigit(id[0])) {
+        id.insert(0, "_");
+    }
+    return id;
+}
+
+/*!
+ * \brief namespaceNames
+ * Assign unique namespace names to messages, names which are equal after conversion
+ * to identifiers get suffix _2, _3 and so on in message order
+ * \param messages: Configured CAN messages
+ * \return Namespace name of each CAN ID
+ */
+std::map<std::uint32_t, std::string> namespaceNames(const std::vector<CANMessage> &messages)
+{
+    std::map<std::uint32_t, std::string> names;
+    std::set<std::string> used;
+    for (auto it = messages.begin(); it != messages.end(); ++it) {
+        std::string base = identifier(it->getName());
+        std::string name = base;
+        for (unsigned int suffix = 2; used.count(name); ++suffix) {
+            name = base + "_" + std::to_string(suffix);
+        }
+        used.insert(name);
+        names[it->getId()] = name;
+    }
+    return names;
+}
+
+/*!
+ * \brief literal
+ * Format floating point constant without losing precision
+ * \param value: Value to format
+ * \return Floating point literal
+ */
+std::string literal(double value)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.17g", value);
+    std::string str(buffer);
+    if (str.find_first_of(".en") == std::string::npos) {
+        str += ".0";
+    }
+    return str;
+}
+
+/*!
+ * \brief layoutArguments
+ * Format template arguments of a single word signal layout
+ * \param layout: Signal layout
+ * \return Template argument list
+ */
+std::string layoutArguments(const SignalLayout &layout)
+{
+    std::stringstream sstream;
+    sstream << ((layout.order == ByteOrder::INTEL) ? "ByteOrder::INTEL" : "ByteOrder::MOTOROLA") << ", "
+            << (unsigned int)layout.wordOffset << ", " << (unsigned int)layout.shift << ", "
+            << "0x" << std::hex << layout.mask << "ULL";
+    return sstream.str();
+}
+
+/*!
+ * \brief layoutConstructor
+ * Format construction of a signal layout for signals which span over nine bytes
+ * \param signal: CAN signal
+ * \param index: Index of the signal in the message
+ * \return Static SignalLayout declaration
+ */
+std::string layoutConstructor(const CANSignal &signal, std::size_t index)
+{
+    std::stringstream sstream;
+    sstream << "    static const SignalLayout layout" << index << "("
+            << ((signal.getByteOrder() == ByteOrder::INTEL) ? "ByteOrder::INTEL" : "ByteOrder::MOTOROLA") << ", "
+            << signal.getStartbit() << ", " << signal.getLength() << ", "
+            << ((signal.getSign() == Sign::SIGNED) ? "Sign::SIGNED" : "Sign::UNSIGNED") << ");\n";
+    return sstream.str();
+}
+
+/*!
+ * \brief extractExpression
+ * Format expression extracting sign extended raw value of a signal
+ * \param signal: CAN signal
+ * \param index: Index of the signal in the message
+ * \return Expression
+ */
+std::string extractExpression(const CANSignal &signal, std::size_t index)
+{
+    const SignalLayout &layout = signal.getLayout();
+    std::stringstream sstream;
+    if (layout.length == 0) {
+        return "0";
+    }
+    if (layout.singleWord) {
+        sstream << "frameCodecExtract<" << layoutArguments(layout) << ">(data)";
+    } else {
+        sstream << "layout" << index << ".extract(data)";
+    }
+    if (layout.signBits) {
+        return "frameCodecSignExtend<" + std::to_string(layout.signBits) + ">(" + sstream.str() + ")";
+    }
+    return sstream.str();
+}
+
+/*!
+ * \brief insertStatement
+ * Format statement inserting raw value of a signal
+ * \param signal: CAN signal
+ * \param index: Index of the signal in the message
+ * \param value: Expression of the raw value
+ * \return Statement
+ */
+std::string insertStatement(const CANSignal &signal, std::size_t index, const std::string &value)
+{
+    const SignalLayout &layout = signal.getLayout();
+    if (layout.length == 0) {
+        return "";
+    }
+    if (layout.singleWord) {
+        return "    frameCodecInsert<" + layoutArguments(layout) + ">(data, " + value + ");\n";
+    }
+    return "    layout" + std::to_string(index) + ".insert(data, " + value + ");\n";
+}
+
+/*!
+ * \brief isMultiplexed
+ * Check whether message contains multiplexed signals
+ * \param message: CAN message
+ * \return True if message is multiplexed, false otherwise.
+ */
+bool isMultiplexed(CANMessage &message)
+{
+    std::map<std::string, CANSignal> &signals = message.getSignals();
+    for (auto it = signals.begin(); it != signals.end(); ++it) {
+        if (it->second.getMultiplexor() != Multiplexor::NONE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * \brief writeMessage
+ * Write codec functions of a single message
+ * \param out: Output stream
+ * \param message: CAN message
+ * \param name: Namespace name of the message
+ */
+void writeMessage(std::ostream &out, CANMessage &message, const std::string &name)
+{
+    std::map<std::string, CANSignal> &signals = message.getSignals();
+    std::string wideLayouts;
+    std::size_t index = 0;
+    for (auto it = signals.begin(); it != signals.end(); ++it, ++index) {
+        if (it->second.getLayout().length && !it->second.getLayout().singleWord) {
+            wideLayouts += layoutConstructor(it->second, index);
+        }
+    }
+
+    out << "// " << message.getName() << ": id " << message.getId() << ", dlc " << (unsigned int)message.getDlc() << "\n";
+    out << "namespace " << name << " {\n\n";
+
+    out << "static const char *const signalNames[] = {\n";
+    for (auto it = signals.begin(); it != signals.end(); ++it) {
+        out << "    \"" << it->first << "\",\n";
+    }
+    out << "    NULL\n};\n\n";
+
+    // Raw value codec
+    out << "inline void encode(const std::uint64_t *rawValues, std::uint8_t *data)\n{\n" << wideLayouts;
+    index = 0;
+    for (auto it = signals.begin(); it != signals.end(); ++it, ++index) {
+        out << insertStatement(it->second, index, "rawValues[" + std::to_string(index) + "]");
+    }
+    out << "}\n\n";
+    out << "inline void decode(const std::uint8_t *data, std::uint64_t *rawValues)\n{\n" << wideLayouts;
+    index = 0;
+    for (auto it = signals.begin(); it != signals.end(); ++it, ++index) {
+        out << "    rawValues[" << index << "] = " << extractExpression(it->second, index) << ";\n";
+    }
+    out << "}\n\n";
+
+    // Physical value codec
+    out << "inline void encodePhysical(const double *values, std::uint8_t *data)\n{\n" << wideLayouts;
+    index = 0;
+    for (auto it = signals.begin(); it != signals.end(); ++it, ++index) {
+        const CANSignal &signal = it->second;
+        out << "    // " << signal.getName() << ": " << signal.getStartbit() << "|" << signal.getLength()
+            << "@" << ((signal.getByteOrder() == ByteOrder::INTEL) ? "1" : "0")
+            << ((signal.getSign() == Sign::SIGNED) ? "-" : "+")
+            << " (" << literal(signal.getFactor()) << "," << literal(signal.getOffset()) << ")\n";
+        out << insertStatement(signal, index, "(std::uint64_t)llround((values[" + std::to_string(index) + "] - "
+                               + literal(signal.getOffset()) + ") / " + literal(signal.getFactor()) + ")");
+    }
+    out << "}\n\n";
+    out << "inline void decodePhysical(const std::uint8_t *data, double *values)\n{\n" << wideLayouts;
+    index = 0;
+    for (auto it = signals.begin(); it != signals.end(); ++it, ++index) {
+        const CANSignal &signal = it->second;
+        std::string raw = extractExpression(signal, index);
+        if (signal.getSign() == Sign::SIGNED) {
+            raw = "(std::int64_t)" + raw;
+        }
+        out << "    values[" << index << "] = " << raw << " * " << literal(signal.getFactor())
+            << " + " << literal(signal.getOffset()) << ";\n";
+    }
+    out << "}\n\n";
+
+    out << "} // namespace " << name << "\n\n";
+}
+
+/*!
+ * \brief writeCodecs
+ * Write header containing codecs of all configured messages
+ * \param out: Output stream
+ * \param config: Loaded configuration
+ * \param cfg: Path to cfg file
+ * \param dbc: Path to dbc file
+ */
+void writeCodecs(std::ostream &out, Configuration &config, const std::string &cfg, const std::string &dbc)
+{
+    const std::vector<CANMessage> &messages = config.getMessages();
+    std::map<std::uint32_t, std::string> names = namespaceNames(messages);
+
+    out << "/*!\n"
+        << "* \\file\n"
+        << "* \\brief Frame codecs generated by dbc2cpp, do not edit\n"
+        << "* cfg: " << cfg << " (" << config.getCfgVersion() << ")\n"
+        << "* dbc: " << dbc << " (" << config.getDBCVersion() << ")\n"
+        << "*/\n\n"
+        << "#ifndef GENERATED_FRAMECODECS_H\n"
+        << "#define GENERATED_FRAMECODECS_H\n\n"
+        << "#include \"framecodec.h\"\n"
+        << "#include \"signallayout.h\"\n"
+        << "#include <cmath>\n"
+        << "#include <cstdint>\n\n"
+        << "namespace dbc2cpp {\n\n";
+    // Multiplexed messages are left to the generic codec which decodes only the active page
+    for (auto it = messages.begin(); it != messages.end(); ++it) {
+        if (isMultiplexed(*config.getMessage(it->getId()))) {
+            out << "// " << it->getName() << ": id " << it->getId() << ", multiplexed, not generated\n\n";
+        } else {
+            writeMessage(out, *config.getMessage(it->getId()), names[it->getId()]);
+        }
+    }
+    out << "} // namespace dbc2cpp\n\n";
+
+    std::stringstream table;
+    std::size_t count = 0;
+    for (auto it = messages.begin(); it != messages.end(); ++it) {
+        if (isMultiplexed(*config.getMessage(it->getId()))) {
+            continue;
+        }
+        std::string ns = "dbc2cpp::" + names[it->getId()] + "::";
+        table << "    {" << it->getId() << ", " << (unsigned int)it->getDlc() << ", \"" << it->getName() << "\", "
+              << config.getMessage(it->getId())->getSignals().size() << ", "
+              << ns << "signalNames, " << ns << "encode, " << ns << "decode},\n";
+        ++count;
+    }
+    if (count) {
+        out << "static const FrameCodec generatedFrameCodecs[] = {\n" << table.str() << "};\n\n";
+    } else {
+        out << "static const FrameCodec *const generatedFrameCodecs = NULL;\n\n";
+    }
+    out << "#define GENERATED_FRAME_CODEC_COUNT " << count << "U\n\n"
+        << "#endif // GENERATED_FRAMECODECS_H\n";
+}
+
+/*!
+ * \brief main
+ * Main function of dbc2cpp code generator
+ * \param argc: number of command line parameters
+ * \param argv: command line parameters
+ * \return Exit code
+ */
+int main(int argc, char *argv[])
+{
+    std::string cfg;
+    std::string dbc;
+    std::string output;
+    static struct option long_options[] = {
+        {"cfg", required_argument, 0, 'c'},
+        {"dbc", required_argument, 0, 'd'},
+        {"output", required_argument, 0, 'o'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "c:d:o:h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'c':
+            cfg = optarg;
+            break;
+        case 'd':
+            dbc = optarg;
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        default:
+            printHelp();
+            return 1;
+        }
+    }
+    if (cfg.empty() || dbc.empty() || output.empty()) {
+        LOG(LOG_ERR, "error=1 'dbc', 'cfg' and 'output' options are required.\n");
+        printHelp();
+        return 1;
+    }
+
+    Configuration *config = NULL;
+    try {
+        config = new Configuration(cfg, dbc);
+    }
+    catch (ConfigurationException&) {
+        return 2;
+    }
+
+    int retval = 0;
+    std::ofstream file(output.c_str());
+    if (file.is_open()) {
+        writeCodecs(file, *config, cfg, dbc);
+    }
+    if (!file.is_open() || !file.good()) {
+        LOG(LOG_ERR, "error=1 Unable to write output file '%s'\n", output.c_str());
+        retval = 1;
+    }
+    delete config;
+    return retval;
+}